@@ -10,22 +10,39 @@ struct Region
 	/// <summary>
 	/// The identifier of the region.
 	/// </summary>
-	int id;	
+	int id = 0;
+	/// <summary>
+	/// The number of pixels covered by the region.
+	/// </summary>
+	unsigned long long pixels = 0;
 	/// <summary>
 	/// The cumulative altimetry gained.
 	/// </summary>
-	float gained;
+	double gained = 0;
 	/// <summary>
 	/// The cumulative altimetry lost.
 	/// </summary>
-	float lost;
+	double lost = 0;
 	/// <summary>
 	/// The cumulative altimetry moved (gained + lost).
 	/// </summary>
-	float moved;
+	double moved = 0;
 	/// <summary>
 	/// The cumulative altimetry difference (gained - lost).
 	/// </summary>
-	float difference;
+	double difference = 0;
+
+	/// <summary>
+	/// Adds the altimetry changes of another part of the region.
+	/// </summary>
+	Region& operator+=(const Region& other)
+	{
+		pixels += other.pixels;
+		gained += other.gained;
+		lost += other.lost;
+		moved += other.moved;
+		difference += other.difference;
+		return *this;
+	}
 };
 } // AHN
@@ -0,0 +1,35 @@
+#include <algorithm>
+#include <utility>
+
+#include "RegionIndex.h"
+
+namespace AHN
+{
+RegionIndex::RegionIndex(std::vector<int> ids)
+	: _ids(std::move(ids)), _minId(0)
+{
+	std::sort(_ids.begin(), _ids.end());
+	_ids.erase(std::unique(_ids.begin(), _ids.end()), _ids.end());
+	if (_ids.empty())
+		return;
+
+	// Limit the size of the lookup table for sparse identifiers.
+	const long long maxLookup = 1 << 24;
+	long long range = static_cast<long long>(_ids.back()) - _ids.front() + 1;
+	if (range <= maxLookup)
+	{
+		_minId = _ids.front();
+		_lookup.assign(static_cast<std::size_t>(range), NoIndex);
+		for (std::size_t i = 0; i < _ids.size(); ++i)
+			_lookup[static_cast<std::size_t>(static_cast<long long>(_ids[i]) - _minId)] = static_cast<int>(i);
+	}
+}
+
+int RegionIndex::search(int id) const
+{
+	auto it = std::lower_bound(_ids.begin(), _ids.end(), id);
+	return it != _ids.end() && *it == id
+		? static_cast<int>(it - _ids.begin())
+		: NoIndex;
+}
+} // AHN
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace AHN
+{
+/// <summary>
+/// Represents a mapping of administrative region identifiers to dense indices.
+/// </summary>
+/// <remarks>
+/// The indices are assigned in the ascending order of the identifiers.
+/// When the identifiers are within a moderate range, a direct lookup table is used,
+/// otherwise the identifiers are binary searched.
+/// The index is immutable after construction, therefore concurrent lookups are safe.
+/// </remarks>
+class RegionIndex
+{
+public:
+	/// <summary>
+	/// The index of an unknown identifier.
+	/// </summary>
+	static const int NoIndex = -1;
+
+private:
+	std::vector<int> _ids;
+	std::vector<int> _lookup;
+	int _minId;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class.
+	/// </summary>
+	/// <param name="ids">The identifiers of the regions, duplicates are allowed.</param>
+	explicit RegionIndex(std::vector<int> ids);
+
+	/// <summary>
+	/// Gets the number of distinct regions.
+	/// </summary>
+	std::size_t size() const { return _ids.size(); }
+
+	/// <summary>
+	/// Gets the identifier of a region by its index.
+	/// </summary>
+	int id(std::size_t index) const { return _ids[index]; }
+
+	/// <summary>
+	/// Gets the index of a region by its identifier.
+	/// </summary>
+	/// <returns>The index of the region if it is known; otherwise <see cref="NoIndex" />.</returns>
+	int index(int id) const
+	{
+		if (!_lookup.empty())
+		{
+			long long offset = static_cast<long long>(id) - _minId;
+			return offset >= 0 && offset < static_cast<long long>(_lookup.size())
+				? _lookup[static_cast<std::size_t>(offset)]
+				: NoIndex;
+		}
+		return search(id);
+	}
+
+private:
+	int search(int id) const;
+};
+} // AHN
@@ -0,0 +1,60 @@
+#include <cmath>
+#include <algorithm>
+
+#include <ogrsf_frmts.h>
+
+#include <CloudTools.DEM/ScanlineFill.h>
+#include "SpanIndex.h"
+
+using namespace CloudTools::DEM;
+
+namespace AHN
+{
+SpanIndex::SpanIndex(OGRLayer* layer, const std::string& fieldName,
+                     const RegionIndex& regions, const RasterMetadata& grid)
+	: _grid(grid), _rowStarts(std::max(grid.rasterSizeY(), 0) + 1, 0)
+{
+	// Collecting the polygons of the regions
+	ScanlineFill fill(_grid);
+	std::vector<int> featureRegions;
+	OGRFeature* feature;
+	layer->ResetReading();
+	while ((feature = layer->GetNextFeature()) != nullptr)
+	{
+		int region = regions.index(feature->GetFieldAsInteger(fieldName.c_str()));
+		if (region != RegionIndex::NoIndex)
+		{
+			fill.add(feature->GetGeometryRef());
+			featureRegions.push_back(region);
+		}
+		OGRFeature::DestroyFeature(feature);
+	}
+
+	// Collecting the runs row by row, ordered by their first column
+	int rowY = 0;
+	auto completeRow = [this, &rowY]()
+	{
+		std::sort(_spans.begin() + _rowStarts[rowY], _spans.end(),
+			[](const Span& a, const Span& b) { return a.x0 < b.x0; });
+		_rowStarts[++rowY] = _spans.size();
+	};
+	fill.runs(0, _grid.rasterSizeY(), [this, &rowY, &completeRow, &featureRegions](int y, const ScanlineFill::Run& run)
+	{
+		while (rowY < y)
+			completeRow();
+		_spans.push_back({ run.x0, run.x1, featureRegions[run.feature] });
+	});
+	while (rowY < _grid.rasterSizeY())
+		completeRow();
+}
+
+int SpanIndex::offsetX(const RasterMetadata& raster) const
+{
+	return static_cast<int>(std::lround((raster.originX() - _grid.originX()) / std::abs(_grid.pixelSizeX())));
+}
+
+int SpanIndex::offsetY(const RasterMetadata& raster) const
+{
+	return static_cast<int>(std::lround((_grid.originY() - raster.originY()) / std::abs(_grid.pixelSizeY())));
+}
+} // AHN
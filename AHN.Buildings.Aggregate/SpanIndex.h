@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <CloudTools.DEM/Metadata.h>
+#include "RegionIndex.h"
+
+class OGRLayer;
+
+namespace AHN
+{
+/// <summary>
+/// Represents a horizontal run of pixels covered by an administrative region.
+/// </summary>
+struct Span
+{
+	/// <summary>
+	/// The first column of the run (inclusive).
+	/// </summary>
+	int x0;
+	/// <summary>
+	/// The last column of the run (exclusive).
+	/// </summary>
+	int x1;
+	/// <summary>
+	/// The dense index of the region.
+	/// </summary>
+	int region;
+};
+
+/// <summary>
+/// Represents the administrative regions as pixel runs on the rows of a raster grid.
+/// </summary>
+/// <remarks>
+/// The runs are computed by a scanline fill (<see cref="CloudTools::DEM::ScanlineFill" />).
+/// Overlapping regions all contain the overlapping pixels.
+/// The runs are stored row by row (compressed rows), ordered by their first column.
+/// The index is immutable after construction, therefore concurrent queries are safe.
+/// </remarks>
+class SpanIndex
+{
+private:
+	CloudTools::DEM::RasterMetadata _grid;
+	std::vector<std::size_t> _rowStarts;
+	std::vector<Span> _spans;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class.
+	/// </summary>
+	/// <param name="layer">The layer of the administrative regions.</param>
+	/// <param name="fieldName">The attribute field of the region identifiers.</param>
+	/// <param name="regions">The dense indices of the regions.</param>
+	/// <param name="grid">The raster grid of the runs.</param>
+	SpanIndex(OGRLayer* layer, const std::string& fieldName,
+	          const RegionIndex& regions, const CloudTools::DEM::RasterMetadata& grid);
+
+	/// <summary>
+	/// Gets the raster grid of the runs.
+	/// </summary>
+	const CloudTools::DEM::RasterMetadata& grid() const { return _grid; }
+
+	/// <summary>
+	/// Gets the number of runs.
+	/// </summary>
+	std::size_t size() const { return _spans.size(); }
+
+	/// <summary>
+	/// Gets the first run of a row of the grid.
+	/// </summary>
+	const Span* rowBegin(int y) const { return _spans.data() + _rowStarts[y]; }
+
+	/// <summary>
+	/// Gets the end of the runs of a row of the grid.
+	/// </summary>
+	const Span* rowEnd(int y) const { return _spans.data() + _rowStarts[y + 1]; }
+
+	/// <summary>
+	/// Gets the column of the grid where a raster aligned to the grid starts.
+	/// </summary>
+	int offsetX(const CloudTools::DEM::RasterMetadata& raster) const;
+
+	/// <summary>
+	/// Gets the row of the grid where a raster aligned to the grid starts.
+	/// </summary>
+	int offsetY(const CloudTools::DEM::RasterMetadata& raster) const;
+};
+} // AHN
@@ -2,12 +2,18 @@
 #include <iomanip>
 #include <string>
 #include <vector>
-#include <map>
+#include <set>
 #include <utility>
 #include <chrono>
 #include <ctime>
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <memory>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
@@ -17,9 +23,9 @@
 #include <CloudTools.Common/IO/IO.h>
 #include <CloudTools.Common/IO/Reporter.h>
 #include <CloudTools.DEM/Metadata.h>
-#include <CloudTools.DEM/Rasterize.h>
-#include <CloudTools.DEM/SweepLineCalculation.hpp>
 #include "Region.h"
+#include "RegionIndex.h"
+#include "SpanIndex.h"
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
@@ -34,15 +40,41 @@ const char* LabelMoved = "ALT_MOVED";
 const char* LabelDifference = "ALT_DIFF";
 const char* ResultFile = "/vsimem/out.shp";
 
+/// <summary>
+/// Selects the layer of the administrative units.
+/// </summary>
+/// <param name="dataset">The vector dataset of the administrative units.</param>
+/// <param name="layerName">The name of the layer, empty if the dataset has a single layer.</param>
+/// <returns>The selected layer.</returns>
+OGRLayer* selectLayer(GDALDataset* dataset, const std::string& layerName);
+
+/// <summary>
+/// Determines the common grid of the AHN tiles.
+/// </summary>
+/// <param name="tiles">The metadata of the tiles.</param>
+/// <returns>The metadata of the grid covering all tiles.</returns>
+RasterMetadata commonGrid(const std::vector<RasterMetadata>& tiles);
+
+/// <summary>
+/// Aggregates the altimetry changes of an AHN tile into the regions.
+/// </summary>
+/// <param name="ahnPath">The path of the AHN tile.</param>
+/// <param name="ahnMetadata">The metadata of the AHN tile.</param>
+/// <param name="spans">The pixel runs of the regions.</param>
+/// <param name="regions">The regions to accumulate into.</param>
+/// <param name="touched">The dense indices of the regions first covered by the tile are appended to it.</param>
+void aggregateTile(const fs::path& ahnPath, const RasterMetadata& ahnMetadata,
+                   const SpanIndex& spans, std::vector<Region>& regions, std::vector<int>& touched);
+
 int main(int argc, char* argv[]) try
 {
 	std::string ahnDir;
 	std::string adminVectorFile;
-	std::string adminRasterDir = fs::current_path().string();
 	std::string outputFile = (fs::current_path() / "out.shp").string();
 	std::string webFile = (fs::current_path() / "out.json").string();
 	std::string adminLayer;
 	std::string adminField;
+	unsigned short maxJobs = std::thread::hardware_concurrency();
 
 	bool webEnable = false;
 	float webTolerance = 5.f;
@@ -55,9 +87,9 @@ int main(int argc, char* argv[]) try
 		("admin-vector", po::value<std::string>(&adminVectorFile), "file path for vector administrative unit file")
 		("admin-layer", po::value<std::string>(&adminLayer), "layer name for administrative units")
 		("admin-field", po::value<std::string>(&adminField), "attribute field name for unit identifier")
-		("admin-raster", po::value<std::string>(&adminRasterDir), "directory path for raster administrative unit tiles")
 		("output-file", po::value<std::string>(&outputFile)->default_value(outputFile), "output vector file path (Shapefile)")
-		("force,f", "regenerates the raster tiles even when they exist")
+		("jobs,j", po::value<unsigned short>(&maxJobs)->default_value(maxJobs),
+			"number of tiles processed simultaneously")
 		("web-output,w", "generates GeoJSON output for web support")
 		("web-tolerance", po::value<float>(&webTolerance)->default_value(webTolerance),
 			"tolerance for web output polygon generalization")
@@ -110,20 +142,15 @@ int main(int argc, char* argv[]) try
 		argumentError = true;
 	}
 
-	if (fs::exists(adminRasterDir) && !fs::is_directory(adminRasterDir))
-	{
-		std::cerr << "The given administrative unit raster tile path exists but not a directory." << std::endl;
-		argumentError = true;
-	}
-	else if (!fs::exists(adminRasterDir) && !fs::create_directory(adminRasterDir))
+	if (!vm.count("admin-field"))
 	{
-		std::cerr << "Failed to create administrative unit raster tile directory." << std::endl;
+		std::cerr << "The attribute field name for administrative unit identifier is mandatory." << std::endl;
 		argumentError = true;
 	}
 
-	if (!vm.count("admin-field"))
+	if (maxJobs == 0)
 	{
-		std::cerr << "The attribute field name for administrative unit identifier is mandatory." << std::endl;
+		std::cerr << "The number of jobs must be positive." << std::endl;
 		argumentError = true;
 	}
 
@@ -141,85 +168,124 @@ int main(int argc, char* argv[]) try
 	BarReporter reporter;
 	GDALAllRegister();
 
-	// Calculating aggregated altimetry change data
-	std::map<int, Region> results;
+	// Reading the AHN tiles
+	std::vector<fs::path> ahnPaths;
 	for (fs::directory_iterator ahnFile(ahnDir); ahnFile != fs::directory_iterator(); ++ahnFile)
-	{
 		if (fs::is_regular_file(ahnFile->status()) && ahnFile->path().extension() == ".tif")
-		{
-			fs::path ahnPath = ahnFile->path();
-			fs::path adminRasterPath = adminRasterDir / ahnPath.filename();
-			std::cout << std::endl
-				      << "Processing tile: " << ahnPath.stem() << std::endl;
-			reporter.reset();
+			ahnPaths.push_back(ahnFile->path());
+	std::sort(ahnPaths.begin(), ahnPaths.end());
+
+	std::vector<RasterMetadata> ahnMetadata;
+	for (const fs::path& ahnPath : ahnPaths)
+	{
+		GDALDataset* ahnDataset = static_cast<GDALDataset*>(GDALOpen(ahnPath.string().c_str(), GA_ReadOnly));
+		if (ahnDataset == nullptr)
+			throw std::runtime_error("Error at opening the AHN tile.");
+		ahnMetadata.emplace_back(ahnDataset);
+		GDALClose(ahnDataset);
+	}
+
+	// Indexing the administrative units on the grid of the AHN tiles
+	std::cout << "Indexing administrative units ... ";
+	std::unique_ptr<RegionIndex> regionIndex;
+	std::unique_ptr<SpanIndex> spanIndex;
+	{
+		GDALDataset* adminDataset = static_cast<GDALDataset*>(GDALOpenEx(adminVectorFile.c_str(),
+		                                                                 GDAL_OF_VECTOR, nullptr, nullptr, nullptr));
+		if (adminDataset == nullptr)
+			throw std::runtime_error("Error at opening the admin vector file.");
 
-			if (!fs::exists(adminRasterPath) || vm.count("force"))
+		try
+		{
+			OGRLayer* layer = selectLayer(adminDataset, adminLayer);
+			if (layer->FindFieldIndex(adminField.c_str(), true) < 0)
+				throw std::invalid_argument("The attribute field name for administrative unit identifier was not found.");
+
+			std::vector<int> adminIds;
+			OGRFeature* feature;
+			layer->ResetReading();
+			while ((feature = layer->GetNextFeature()) != nullptr)
 			{
-				// Create the admin raster tile for the AHN tile
-				Rasterize rasterizer(adminVectorFile, adminRasterPath.string(), 
-					!adminLayer.empty() ? std::vector<std::string> { adminLayer } : std::vector<std::string>());
-				rasterizer.targetField = adminField;
-				rasterizer.targetType = GDALDataType::GDT_Int32;
-				rasterizer.createOptions.insert(std::make_pair("COMPRESS", "DEFLATE"));
-				rasterizer.progress = [&reporter](float complete, const std::string &message)
-				{
-					reporter.report(complete / 2, message);
-					return true;
-				};
-
-				// Define clipping for raster filter
-				GDALDataset* ahnDataset = static_cast<GDALDataset*>(GDALOpen(ahnPath.string().c_str(), GA_ReadOnly));
-				if (ahnDataset == nullptr)
-					throw std::runtime_error("Error at opening the AHN tile.");
-
-				RasterMetadata ahnMetadata(ahnDataset);
-				rasterizer.pixelSizeX = ahnMetadata.pixelSizeX();
-				rasterizer.pixelSizeY = ahnMetadata.pixelSizeY();
-				rasterizer.clip(ahnMetadata.originX(), ahnMetadata.originY(),
-				                ahnMetadata.rasterSizeX(), ahnMetadata.rasterSizeY());
-				GDALClose(ahnDataset);
-
-				// Execute operation
-				rasterizer.execute();
+				adminIds.push_back(feature->GetFieldAsInteger(adminField.c_str()));
+				OGRFeature::DestroyFeature(feature);
 			}
-			else // Raster tile already exists
-				reporter.report(.5f, std::string());
+			regionIndex.reset(new RegionIndex(std::move(adminIds)));
+			spanIndex.reset(new SpanIndex(layer, adminField, *regionIndex, commonGrid(ahnMetadata)));
+		}
+		catch (...)
+		{
+			GDALClose(adminDataset);
+			throw;
+		}
+		GDALClose(adminDataset);
+	}
+	std::cout << "done." << std::endl;
 
-			// Altimetry change aggregation
-			SweepLineCalculation<double> calculation({ ahnPath.string(), adminRasterPath.string() },
-				[&results](int x, int y, const std::vector<Window<double>>& data) // NOT float
+	// Calculating aggregated altimetry change data
+	// The tiles are processed in parallel, each worker accumulates a tile into its own dense array of regions,
+	// then keeps the regions covered by the tile as the partial result of the tile.
+	std::size_t workerCount = std::max<std::size_t>(1, std::min<std::size_t>(maxJobs, ahnPaths.size()));
+	std::vector<std::vector<std::pair<int, Region>>> partials(ahnPaths.size());
+	std::atomic<std::size_t> nextTile(0);
+	std::atomic<std::size_t> counter(0);
+	std::exception_ptr error;
+	std::mutex errorMutex;
+
+	reporter.reset();
+	reporter.report(0.f, "Aggregation");
+	auto aggregateTiles = [&](bool reportProgress)
+	{
+		std::vector<Region> regions(regionIndex->size());
+		std::vector<int> touched;
+		std::size_t tile;
+		while ((tile = nextTile++) < ahnPaths.size())
+		{
+			try
 			{
-				const auto& ahn = data[0];
-				const auto& admin = data[1];
+				touched.clear();
+				aggregateTile(ahnPaths[tile], ahnMetadata[tile], *spanIndex, regions, touched);
 
-				if (admin.hasData())
+				std::sort(touched.begin(), touched.end());
+				partials[tile].reserve(touched.size());
+				for (int index : touched)
 				{
-					int id = static_cast<int>(admin.data());
-					if (results.find(id) == results.end())
-						results[id].id = id;
-
-					if (!ahn.hasData()) return;
-					float change = static_cast<float>(ahn.data());
-
-					if (change > 0)
-						results[id].gained += change;
-					if (change < 0)
-						results[id].lost -= change;
-					results[id].moved += std::abs(change);
-					results[id].difference += change;
+					partials[tile].emplace_back(index, regions[index]);
+					regions[index] = Region();
 				}
-			}, 
-				[&reporter](float complete, const std::string &message)
+			}
+			catch (...)
 			{
-				reporter.report(.5f + complete / 2, message);
-				return true;
-			});
-			calculation.spatialReference = "EPSG:28992";
-			
-			// Execute operation
-			calculation.execute();
+				// The remaining tiles are skipped after a failure
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error)
+					error = std::current_exception();
+				nextTile = ahnPaths.size();
+			}
+
+			std::size_t processed = ++counter;
+			if (reportProgress)
+				reporter.report(processed * 1.f / ahnPaths.size(), "Aggregation");
 		}
-	}
+	};
+
+	std::vector<std::thread> workers;
+	for (std::size_t i = 1; i < workerCount; ++i)
+		workers.emplace_back(aggregateTiles, false);
+	aggregateTiles(true);
+	for (std::thread& worker : workers)
+		worker.join();
+	if (error)
+		std::rethrow_exception(error);
+
+	// Merge the partial results in the order of the tiles,
+	// so the sums do not depend on the scheduling of the workers
+	std::vector<Region> regions(regionIndex->size());
+	for (std::size_t i = 0; i < regions.size(); ++i)
+		regions[i].id = regionIndex->id(i);
+	for (const std::vector<std::pair<int, Region>>& partial : partials)
+		for (const std::pair<int, Region>& region : partial)
+			regions[region.first] += region.second;
+	partials.clear();
 
 	// Creating output Shapefile 
 	std::cout << std::endl << "Generating output ... ";
@@ -236,17 +302,7 @@ int main(int argc, char* argv[]) try
 		throw std::runtime_error("Error at creating result dataset.");
 
 	// Selecting layer
-	OGRLayer *layer;
-	if (vm.count("admin-layer"))
-	{
-		layer = resultDataset->GetLayerByName(adminLayer.c_str());
-		if (layer == nullptr)
-			throw std::invalid_argument("The selected layer does not exist.");
-	}
-	else if (resultDataset->GetLayerCount() == 1)
-		layer = resultDataset->GetLayer(0);
-	else
-		throw std::invalid_argument("No layer selected and there are more than 1 layers.");
+	OGRLayer *layer = selectLayer(resultDataset, adminLayer);
 
 	// Checking admin attribute field and removing conflicting result attribute fields
 	{
@@ -281,13 +337,14 @@ int main(int argc, char* argv[]) try
 	while ((feature = layer->GetNextFeature()) != nullptr)
 	{
 		int id = feature->GetFieldAsInteger(adminField.c_str());
-		auto result = results.find(id);
-		if (result != results.end())
+		int index = regionIndex->index(id);
+		if (index != RegionIndex::NoIndex && regions[index].pixels > 0)
 		{
-			feature->SetField(LabelGained, std::round(result->second.gained));
-			feature->SetField(LabelLost, std::round(result->second.lost));
-			feature->SetField(LabelMoved, std::round(result->second.moved));
-			feature->SetField(LabelDifference, std::round(result->second.difference));
+			const Region& region = regions[index];
+			feature->SetField(LabelGained, std::round(region.gained));
+			feature->SetField(LabelLost, std::round(region.lost));
+			feature->SetField(LabelMoved, std::round(region.moved));
+			feature->SetField(LabelDifference, std::round(region.difference));
 			featureError = static_cast<OGRErr>(featureError |
 				layer->SetFeature(feature));
 		}
@@ -383,3 +440,114 @@ catch (std::exception &ex)
 	std::cerr << "ERROR: " << ex.what() << std::endl;
 	return UnexcpectedError;
 }
+
+OGRLayer* selectLayer(GDALDataset* dataset, const std::string& layerName)
+{
+	OGRLayer *layer;
+	if (!layerName.empty())
+	{
+		layer = dataset->GetLayerByName(layerName.c_str());
+		if (layer == nullptr)
+			throw std::invalid_argument("The selected layer does not exist.");
+	}
+	else if (dataset->GetLayerCount() == 1)
+		layer = dataset->GetLayer(0);
+	else
+		throw std::invalid_argument("No layer selected and there are more than 1 layers.");
+	return layer;
+}
+
+RasterMetadata commonGrid(const std::vector<RasterMetadata>& tiles)
+{
+	RasterMetadata grid;
+	if (tiles.empty())
+		return grid;
+
+	double pixelSizeX = tiles.front().pixelSizeX();
+	double pixelSizeY = tiles.front().pixelSizeY();
+	double minX = tiles.front().originX(), maxY = tiles.front().originY();
+	double maxX = minX, minY = maxY;
+	for (const RasterMetadata& tile : tiles)
+	{
+		if (tile.pixelSizeX() != pixelSizeX || tile.pixelSizeY() != pixelSizeY)
+			throw std::runtime_error("The AHN tiles have different pixel sizes.");
+		minX = std::min(minX, tile.originX());
+		maxY = std::max(maxY, tile.originY());
+		maxX = std::max(maxX, tile.originX() + tile.extentX());
+		minY = std::min(minY, tile.originY() - tile.extentY());
+	}
+
+	grid.setPixelSizeX(pixelSizeX);
+	grid.setPixelSizeY(pixelSizeY);
+	grid.setOriginX(minX);
+	grid.setOriginY(maxY);
+	grid.setRasterSizeX(static_cast<int>(std::lround((maxX - minX) / std::abs(pixelSizeX))));
+	grid.setRasterSizeY(static_cast<int>(std::lround((maxY - minY) / std::abs(pixelSizeY))));
+
+	// The tiles must be aligned to the pixels of the grid
+	for (const RasterMetadata& tile : tiles)
+	{
+		double offsetX = (tile.originX() - minX) / std::abs(pixelSizeX);
+		double offsetY = (maxY - tile.originY()) / std::abs(pixelSizeY);
+		if (std::abs(offsetX - std::round(offsetX)) > 1e-3 || std::abs(offsetY - std::round(offsetY)) > 1e-3)
+			throw std::runtime_error("The AHN tiles are not aligned to a common grid.");
+	}
+	return grid;
+}
+
+void aggregateTile(const fs::path& ahnPath, const RasterMetadata& ahnMetadata,
+                   const SpanIndex& spans, std::vector<Region>& regions, std::vector<int>& touched)
+{
+	std::shared_ptr<GDALDataset> ahnDataset(
+		static_cast<GDALDataset*>(GDALOpen(ahnPath.string().c_str(), GA_ReadOnly)),
+		[](GDALDataset* dataset) { if (dataset != nullptr) GDALClose(dataset); });
+	if (ahnDataset == nullptr)
+		throw std::runtime_error("Error at opening the AHN tile.");
+
+	GDALRasterBand* band = ahnDataset->GetRasterBand(1);
+	double nodataValue = band->GetNoDataValue();
+	int sizeX = ahnMetadata.rasterSizeX();
+	int offsetX = spans.offsetX(ahnMetadata);
+	int offsetY = spans.offsetY(ahnMetadata);
+
+	std::vector<double> scanline(sizeX);
+	for (int y = 0; y < ahnMetadata.rasterSizeY(); ++y)
+	{
+		// Rows not covered by any region are not read
+		const Span* begin = spans.rowBegin(offsetY + y);
+		const Span* end = spans.rowEnd(offsetY + y);
+		if (begin == end || begin->x0 >= offsetX + sizeX)
+			continue;
+
+		if (band->RasterIO(GF_Read, 0, y, sizeX, 1,
+		                   scanline.data(), sizeX, 1,
+		                   GDALDataType::GDT_Float64, 0, 0) != CE_None)
+			throw std::runtime_error("Source read error occured.");
+
+		for (const Span* span = begin; span != end; ++span)
+		{
+			int x0 = std::max(span->x0 - offsetX, 0);
+			int x1 = std::min(span->x1 - offsetX, sizeX);
+			if (x0 >= x1)
+				continue;
+
+			Region& region = regions[span->region];
+			if (region.pixels == 0)
+				touched.push_back(span->region);
+			region.pixels += x1 - x0;
+			for (int x = x0; x < x1; ++x)
+			{
+				double change = scanline[x];
+				if (change == nodataValue)
+					continue;
+
+				if (change > 0)
+					region.gained += change;
+				if (change < 0)
+					region.lost -= change;
+				region.moved += std::abs(change);
+				region.difference += change;
+			}
+		}
+	}
+}
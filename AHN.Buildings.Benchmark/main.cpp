@@ -0,0 +1,727 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <gdal_priv.h>
+
+#include <CloudTools.Common/IO/IO.h>
+#include <CloudTools.Common/Metrics.h>
+#include <CloudTools.Benchmarks/SyntheticDem.h>
+#include <AHN.Buildings/IOMode.h>
+#include <AHN.Buildings/Process.h>
+#include <AHN.Buildings.Parallel/TileScheduler.h>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+namespace pt = boost::property_tree;
+
+using namespace CloudTools::IO;
+using namespace AHN::Buildings;
+using CloudTools::Benchmarks::SyntheticDem;
+
+/// <summary>
+/// Represents a set of synthetic AHN-2 and AHN-3 tiles of the same size.
+/// </summary>
+/// <remarks>
+/// The surface and terrain DEMs are stored in separate directories (<c>ahn2_surface</c>, <c>ahn3_surface</c>,
+/// <c>ahn2_terrain</c>, <c>ahn3_terrain</c>), the streamed inputs with all 4 DEMs as bands in the <c>stream</c> directory.
+/// </remarks>
+struct TileSet
+{
+	/// <summary>
+	/// The number of columns and rows of the tiles.
+	/// </summary>
+	int tileSize = 0;
+	/// <summary>
+	/// The names of the tiles.
+	/// </summary>
+	std::vector<std::string> names;
+	/// <summary>
+	/// The root directory of the tile set.
+	/// </summary>
+	fs::path directory;
+
+	/// <summary>
+	/// Gets the path of a tile in a dataset of the set.
+	/// </summary>
+	std::string path(const std::string& dataset, const std::string& name) const
+	{
+		return (directory / dataset / (name + ".tif")).string();
+	}
+
+	/// <summary>
+	/// Gets the number of pixels of all tiles.
+	/// </summary>
+	std::uint64_t pixelCount() const
+	{
+		return static_cast<std::uint64_t>(tileSize) * tileSize * names.size();
+	}
+};
+
+/// <summary>
+/// Represents the measurements of the pipeline in a configuration.
+/// </summary>
+struct PipelineResult
+{
+	IOMode mode = IOMode::Unknown;
+	int tileSize = 0;
+	int tileCount = 0;
+	int jobs = 0;
+	int repetitions = 0;
+
+	/// <summary>
+	/// The number of tile pixels processed by a repetition.
+	/// </summary>
+	std::uint64_t pixels = 0;
+	/// <summary>
+	/// The fastest and the mean wall time of a repetition in seconds.
+	/// </summary>
+	double minTime = std::numeric_limits<double>::max();
+	double meanTime = 0;
+	/// <summary>
+	/// The highest resident memory of the process during the repetitions in bytes.
+	/// </summary>
+	std::size_t peakMemory = 0;
+	/// <summary>
+	/// The throughput relative to the smallest job count measured, divided by the relative job count.
+	/// </summary>
+	double scalingEfficiency = 1;
+	/// <summary>
+	/// The metrics of the stages aggregated over the tiles of all repetitions.
+	/// </summary>
+	CloudTools::MetricsSummary stages;
+
+	/// <summary>
+	/// Gets the throughput of the fastest repetition.
+	/// </summary>
+	double pixelsPerSecond() const
+	{
+		return minTime > 0 ? pixels / minTime : 0;
+	}
+
+	/// <summary>
+	/// Gets the unique key of the configuration.
+	/// </summary>
+	std::string key() const
+	{
+		std::ostringstream key;
+		key << mode << " size=" << tileSize << " tiles=" << tileCount << " jobs=" << jobs;
+		return key.str();
+	}
+};
+
+/// <summary>
+/// The streamed AHN Building Filter operation reading its input from a file and discarding its output.
+/// </summary>
+/// <remarks>
+/// Measures the same in-memory pipeline as a streaming worker, without the pipes of the host.
+/// </remarks>
+class FileStreamedProcess : public StreamedProcess
+{
+private:
+	std::string _inputPath;
+
+public:
+	FileStreamedProcess(const std::string& id, const std::string& inputPath)
+		: StreamedProcess(id), _inputPath(inputPath)
+	{ }
+
+protected:
+	std::vector<GByte>& readInput() override
+	{
+		std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(_inputPath.c_str(), "rb"), &std::fclose);
+		if (!file)
+			throw std::runtime_error("Failed to open the streamed input.");
+		readStream(file.get(), _buffer);
+		return _buffer;
+	}
+
+	void writeOutput(const GByte*, std::size_t) override
+	{ }
+};
+
+/// <summary>
+/// Samples the resident memory of the process on a background thread and keeps its maximum.
+/// </summary>
+/// <remarks>
+/// The peak memory reported by the system only grows during the lifetime of the process,
+/// hence it cannot separate the configurations measured one after another.
+/// </remarks>
+class MemorySampler
+{
+private:
+	std::atomic<bool> _isRunning;
+	std::atomic<std::size_t> _peak;
+	std::thread _thread;
+
+public:
+	MemorySampler()
+		: _isRunning(true), _peak(CloudTools::Metrics::residentMemory())
+	{
+		_thread = std::thread([this]()
+		{
+			while (_isRunning)
+			{
+				update();
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+		});
+	}
+
+	~MemorySampler()
+	{
+		stop();
+	}
+
+	MemorySampler(const MemorySampler&) = delete;
+	MemorySampler& operator=(const MemorySampler&) = delete;
+
+	/// <summary>
+	/// Stops sampling.
+	/// </summary>
+	/// <returns>The highest resident memory sampled in bytes.</returns>
+	std::size_t stop()
+	{
+		if (_thread.joinable())
+		{
+			_isRunning = false;
+			_thread.join();
+			update();
+		}
+		return _peak;
+	}
+
+private:
+	void update()
+	{
+		_peak = std::max<std::size_t>(_peak, CloudTools::Metrics::residentMemory());
+	}
+};
+
+/// <summary>
+/// Generates a set of synthetic tiles.
+/// </summary>
+/// <param name="tileSize">The number of columns and rows of the tiles.</param>
+/// <param name="tileCount">The number of tiles.</param>
+/// <param name="seed">The seed of the generation.</param>
+/// <param name="directory">The directory to create the set in.</param>
+/// <returns>The generated tile set.</returns>
+TileSet generateTiles(int tileSize, int tileCount, unsigned int seed, const fs::path& directory);
+
+/// <summary>
+/// Writes the streamed input of a tile, a raster file with the DEMs as bands.
+/// </summary>
+/// <param name="sources">The AHN-2 surface, AHN-3 surface, AHN-2 terrain and AHN-3 terrain DEMs.</param>
+/// <param name="path">The path of the file.</param>
+void writeStreamInput(const std::vector<GDALDataset*>& sources, const std::string& path);
+
+/// <summary>
+/// Processes a tile.
+/// </summary>
+/// <param name="mode">The I/O mode of the process.</param>
+/// <param name="tiles">The tile set.</param>
+/// <param name="tileName">Name of the tile.</param>
+/// <param name="outputDir">Result directory path.</param>
+/// <param name="isParallel"><c>true</c> if the tiles are processed concurrently, otherwise <c>false</c>.</param>
+void processTile(IOMode mode, const TileSet& tiles, const std::string& tileName,
+                 const std::string& outputDir, bool isParallel);
+
+/// <summary>
+/// Measures the pipeline in a configuration.
+/// </summary>
+/// <remarks>
+/// The measured repetitions are preceded by a warm-up run.
+/// </remarks>
+/// <param name="mode">The I/O mode of the processes.</param>
+/// <param name="tiles">The tile set to process.</param>
+/// <param name="jobs">The number of tiles processed concurrently.</param>
+/// <param name="repetitions">The number of measured repetitions.</param>
+/// <param name="outputDir">Result directory path, cleaned before each repetition.</param>
+/// <returns>The measurements.</returns>
+PipelineResult measurePipeline(IOMode mode, const TileSet& tiles, int jobs, int repetitions, const fs::path& outputDir);
+
+/// <summary>
+/// Writes the measurements into a JSON file.
+/// </summary>
+/// <param name="path">The path of the file.</param>
+/// <param name="results">The measurements.</param>
+void writeJson(const std::string& path, const std::vector<PipelineResult>& results);
+
+/// <summary>
+/// Compares the throughput of the measurements with a baseline.
+/// </summary>
+/// <param name="path">The results file of an earlier run.</param>
+/// <param name="results">The measurements.</param>
+/// <param name="threshold">The tolerated relative slowdown.</param>
+/// <returns>The number of configurations slower than the baseline beyond the threshold.</returns>
+std::size_t compareBaseline(const std::string& path, const std::vector<PipelineResult>& results, double threshold);
+
+int main(int argc, char* argv[]) try
+{
+	std::vector<int> tileSizes = { 500, 1000 };
+	std::vector<int> jobCounts = { 1, 2, 4 };
+	std::vector<IOMode> modes = { IOMode::Files, IOMode::Memory, IOMode::Stream };
+	int tileCount = 4;
+	int repetitions = 3;
+	unsigned int seed = 42;
+	std::string workDir = (fs::temp_directory_path() / "ahn_buildings_bench").string();
+	std::string outputFile = "pipeline_benchmarks.json";
+	std::string baselineFile;
+	double threshold = 0.1;
+
+	// Read console arguments
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("mode,m", po::value<std::vector<IOMode>>(&modes)->multitoken()->default_value(modes, "FILES MEMORY STREAM"),
+			"I/O modes to measure, supported\n"
+			"FILES, MEMORY, STREAM")
+		("tile-size", po::value<std::vector<int>>(&tileSizes)->multitoken()->default_value(tileSizes, "500 1000"),
+			"sizes of the synthetic square tiles in pixels")
+		("tiles", po::value<int>(&tileCount)->default_value(tileCount),
+			"number of tiles of each size")
+		("jobs,j", po::value<std::vector<int>>(&jobCounts)->multitoken()->default_value(jobCounts, "1 2 4"),
+			"numbers of tiles processed concurrently\n"
+			"STREAM mode is only measured on 1 job")
+		("repetitions", po::value<int>(&repetitions)->default_value(repetitions),
+			"number of measured repetitions of each configuration")
+		("seed", po::value<unsigned int>(&seed)->default_value(seed),
+			"seed of the synthetic tile generation")
+		("work-dir", po::value<std::string>(&workDir)->default_value(workDir),
+			"directory of the generated tiles and the results\n"
+			"the generated files are removed at the end")
+		("output", po::value<std::string>(&outputFile)->default_value(outputFile),
+			"JSON file to write the results in")
+		("baseline", po::value<std::string>(&baselineFile),
+			"results file of an earlier run to compare the throughput with\n"
+			"a slowdown beyond the threshold fails the run")
+		("threshold", po::value<double>(&threshold)->default_value(threshold),
+			"tolerated relative slowdown compared to the baseline")
+		("help,h", "produce help message")
+		;
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	// Argument validation
+	if (vm.count("help"))
+	{
+		std::cout << "Measures the throughput of the AHN Building Filter pipeline on synthetic tiles." << std::endl;
+		std::cout << desc << std::endl;
+		return Success;
+	}
+
+	bool argumentError = false;
+	for (IOMode mode : modes)
+		if (mode != IOMode::Files && mode != IOMode::Memory && mode != IOMode::Stream)
+		{
+			std::cerr << "Unsupported I/O mode given." << std::endl;
+			argumentError = true;
+			break;
+		}
+
+	for (int size : tileSizes)
+		if (size <= 0)
+		{
+			std::cerr << "The tile sizes must be positive." << std::endl;
+			argumentError = true;
+			break;
+		}
+
+	for (int jobs : jobCounts)
+		if (jobs < 1)
+		{
+			std::cerr << "The job counts must be positive." << std::endl;
+			argumentError = true;
+			break;
+		}
+
+	if (tileCount < 1)
+	{
+		std::cerr << "At least 1 tile must be generated." << std::endl;
+		argumentError = true;
+	}
+
+	if (repetitions < 1)
+	{
+		std::cerr << "At least 1 repetition must be measured." << std::endl;
+		argumentError = true;
+	}
+
+	if (vm.count("baseline") && !fs::is_regular_file(baselineFile))
+	{
+		std::cerr << "The given baseline file does not exist." << std::endl;
+		argumentError = true;
+	}
+
+	if (threshold < 0)
+	{
+		std::cerr << "The threshold must be non-negative." << std::endl;
+		argumentError = true;
+	}
+
+	if (fs::exists(workDir) && !fs::is_directory(workDir))
+	{
+		std::cerr << "The given work path exists but is not a directory." << std::endl;
+		argumentError = true;
+	}
+
+	if (argumentError)
+	{
+		std::cerr << "Use the --help option for description." << std::endl;
+		return InvalidInput;
+	}
+
+	// Program
+	std::cout << "=== AHN Building Filter Benchmark ===" << std::endl;
+	GDALAllRegister();
+
+	std::sort(jobCounts.begin(), jobCounts.end());
+	jobCounts.erase(std::unique(jobCounts.begin(), jobCounts.end()), jobCounts.end());
+
+	std::vector<PipelineResult> results;
+	for (int tileSize : tileSizes)
+	{
+		std::cout << "Generating " << tileCount << " tiles of " << tileSize << "x" << tileSize << " pixels." << std::endl;
+		TileSet tiles = generateTiles(tileSize, tileCount, seed, workDir);
+
+		for (IOMode mode : modes)
+		{
+			// The streamed input is exposed on a single virtual path, hence streamed tiles cannot be processed concurrently
+			std::vector<int> modeJobCounts = mode == IOMode::Stream ? std::vector<int>{ 1 } : jobCounts;
+
+			std::size_t first = results.size();
+			for (int jobs : modeJobCounts)
+			{
+				results.push_back(measurePipeline(mode, tiles, jobs, repetitions, fs::path(workDir) / "output"));
+				PipelineResult& result = results.back();
+
+				// Scaling efficiency compared to the smallest job count
+				const PipelineResult& reference = results[first];
+				if (reference.pixelsPerSecond() > 0)
+					result.scalingEfficiency = result.pixelsPerSecond() / reference.pixelsPerSecond()
+						* reference.jobs / result.jobs;
+
+				std::cout << std::left << std::setw(40) << result.key() << std::right << std::fixed
+					<< std::setprecision(3) << std::setw(10) << result.minTime << " s"
+					<< std::setprecision(2) << std::setw(10) << result.pixelsPerSecond() / 1e6 << " Mpx/s"
+					<< std::setw(10) << result.peakMemory / 1024 / 1024 << " MB peak"
+					<< std::setw(8) << result.scalingEfficiency * 100 << " % efficiency" << std::endl;
+
+				// Stages directly below the process
+				for (const auto& item : result.stages.entries())
+				{
+					const std::string& path = item.first;
+					const CloudTools::MetricsSummary::Entry& entry = item.second;
+					if (std::count(path.begin(), path.end(), '/') != 1 || entry.pixels == 0 || entry.wallTime <= 0)
+						continue;
+
+					std::cout << "  " << std::left << std::setw(38) << path << std::right
+						<< std::setprecision(3) << std::setw(10) << entry.wallTime / entry.count << " s"
+						<< std::setprecision(2) << std::setw(10) << entry.pixels / entry.wallTime / 1e6 << " Mpx/s" << std::endl;
+				}
+			}
+		}
+
+		fs::remove_all(tiles.directory);
+	}
+
+	writeJson(outputFile, results);
+	std::cout << results.size() << " configurations measured, results written to '" << outputFile << "'." << std::endl;
+
+	if (vm.count("baseline"))
+	{
+		std::size_t regressionCount = compareBaseline(baselineFile, results, threshold);
+		if (regressionCount > 0)
+		{
+			std::cerr << regressionCount << " configurations are slower than the baseline by more than "
+				<< std::fixed << std::setprecision(0) << threshold * 100 << "%." << std::endl;
+			return Regression;
+		}
+		std::cout << "No regression compared to the baseline." << std::endl;
+	}
+	return Success;
+}
+catch (std::exception& ex)
+{
+	std::cerr << "ERROR: " << ex.what() << std::endl;
+	return UnexcpectedError;
+}
+
+TileSet generateTiles(int tileSize, int tileCount, unsigned int seed, const fs::path& directory)
+{
+	TileSet tiles;
+	tiles.tileSize = tileSize;
+	tiles.directory = directory / ("tiles_" + std::to_string(tileSize));
+	for (const char* dataset : { "ahn2_surface", "ahn3_surface", "ahn2_terrain", "ahn3_terrain", "stream" })
+		fs::create_directories(tiles.directory / dataset);
+
+	for (int i = 0; i < tileCount; ++i)
+	{
+		std::string tileName = "tile" + std::to_string(i + 1);
+		SyntheticDem dem;
+		dem.sizeX = dem.sizeY = tileSize;
+		dem.originX += i * tileSize * dem.pixelSize;
+		dem.seed = seed + i;
+
+		// AHN-2 is the first epoch, AHN-3 is the second one
+		std::vector<GDALDataset*> datasets =
+		{
+			dem.create(SyntheticDem::Surface, 0, tiles.path("ahn2_surface", tileName), "GTiff"),
+			dem.create(SyntheticDem::Surface, 1, tiles.path("ahn3_surface", tileName), "GTiff"),
+			dem.create(SyntheticDem::Terrain, 0, tiles.path("ahn2_terrain", tileName), "GTiff"),
+			dem.create(SyntheticDem::Terrain, 1, tiles.path("ahn3_terrain", tileName), "GTiff")
+		};
+		try
+		{
+			writeStreamInput(datasets, tiles.path("stream", tileName));
+		}
+		catch (...)
+		{
+			for (GDALDataset* dataset : datasets)
+				GDALClose(dataset);
+			throw;
+		}
+		for (GDALDataset* dataset : datasets)
+			GDALClose(dataset);
+
+		tiles.names.push_back(tileName);
+	}
+	return tiles;
+}
+
+void writeStreamInput(const std::vector<GDALDataset*>& sources, const std::string& path)
+{
+	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+	if (driver == nullptr)
+		throw std::invalid_argument("Target output format unrecognized.");
+
+	int sizeX = sources.front()->GetRasterXSize();
+	int sizeY = sources.front()->GetRasterYSize();
+	GDALDataset* target = driver->Create(path.c_str(), sizeX, sizeY, static_cast<int>(sources.size()), GDT_Float32, nullptr);
+	if (target == nullptr)
+		throw std::runtime_error("Target file creation failed.");
+
+	double geoTransform[6];
+	sources.front()->GetGeoTransform(geoTransform);
+	target->SetGeoTransform(geoTransform);
+	target->SetProjection(sources.front()->GetProjectionRef());
+
+	std::vector<float> data(static_cast<std::size_t>(sizeX) * sizeY);
+	for (std::size_t i = 0; i < sources.size(); ++i)
+	{
+		GDALRasterBand* source = sources[i]->GetRasterBand(1);
+		GDALRasterBand* band = target->GetRasterBand(static_cast<int>(i) + 1);
+		band->SetNoDataValue(source->GetNoDataValue());
+		if (source->RasterIO(GF_Read, 0, 0, sizeX, sizeY, &data[0], sizeX, sizeY, GDT_Float32, 0, 0) != CE_None ||
+		    band->RasterIO(GF_Write, 0, 0, sizeX, sizeY, &data[0], sizeX, sizeY, GDT_Float32, 0, 0) != CE_None)
+		{
+			GDALClose(target);
+			throw std::runtime_error("Target write error occured.");
+		}
+	}
+	GDALClose(target);
+}
+
+void processTile(IOMode mode, const TileSet& tiles, const std::string& tileName,
+                 const std::string& outputDir, bool isParallel)
+{
+	// Process configuration
+	std::unique_ptr<Process> process;
+	switch (mode)
+	{
+	case IOMode::Files:
+		process.reset(new FileBasedProcess(tileName,
+		                                   tiles.path("ahn2_surface", tileName), tiles.path("ahn3_surface", tileName),
+		                                   tiles.path("ahn2_terrain", tileName), tiles.path("ahn3_terrain", tileName),
+		                                   outputDir));
+		break;
+	case IOMode::Memory:
+		process.reset(new InMemoryProcess(tileName,
+		                                  tiles.path("ahn2_surface", tileName), tiles.path("ahn3_surface", tileName),
+		                                  tiles.path("ahn2_terrain", tileName), tiles.path("ahn3_terrain", tileName),
+		                                  outputDir));
+		break;
+	case IOMode::Stream:
+		process.reset(new FileStreamedProcess(tileName, tiles.path("stream", tileName)));
+		break;
+	default:
+		throw std::invalid_argument("Unsupported I/O mode given.");
+	}
+
+	// Concurrent tiles are configured as by the parallel tool, a single job as the standalone tool
+	if (isParallel)
+	{
+		process->concurrentBranches = false;
+		process->output.threadCount = 1;
+	}
+
+	// Execute process
+	process->execute();
+}
+
+PipelineResult measurePipeline(IOMode mode, const TileSet& tiles, int jobs, int repetitions, const fs::path& outputDir)
+{
+	PipelineResult result;
+	result.mode = mode;
+	result.tileSize = tiles.tileSize;
+	result.tileCount = static_cast<int>(tiles.names.size());
+	result.jobs = jobs;
+	result.repetitions = repetitions;
+	result.pixels = tiles.pixelCount();
+
+	double totalTime = 0;
+	for (int i = 0; i <= repetitions; ++i)
+	{
+		fs::remove_all(outputDir);
+		fs::create_directories(outputDir);
+
+		std::mutex metricsMutex;
+		CloudTools::MetricsSummary stages;
+		TileScheduler scheduler(jobs);
+		for (const std::string& tileName : tiles.names)
+			scheduler.add(tileName, 0,
+				[&, tileName]()
+				{
+					CloudTools::MetricsRecorder recorder(tileName);
+					processTile(mode, tiles, tileName, outputDir.string(), jobs > 1);
+					recorder.stop();
+
+					std::lock_guard<std::mutex> lock(metricsMutex);
+					stages.add(recorder.metrics());
+				});
+
+		MemorySampler sampler;
+		auto start = std::chrono::steady_clock::now();
+		std::vector<TileResult> tileResults = scheduler.run();
+		double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::size_t peakMemory = sampler.stop();
+
+		for (const TileResult& tileResult : tileResults)
+			if (!tileResult.error.empty())
+				throw std::runtime_error("Processing tile '" + tileResult.name + "' failed: " + tileResult.error);
+
+		// The first run is a warm-up, e.g. for the file system cache
+		if (i == 0)
+			continue;
+
+		result.minTime = std::min(result.minTime, time);
+		totalTime += time;
+		result.peakMemory = std::max(result.peakMemory, peakMemory);
+		result.stages.merge(stages);
+	}
+	result.meanTime = totalTime / repetitions;
+	fs::remove_all(outputDir);
+	return result;
+}
+
+void writeJson(const std::string& path, const std::vector<PipelineResult>& results)
+{
+	std::time_t now = std::time(nullptr);
+	std::ofstream out(path);
+	out << std::setprecision(6)
+	    << "{\n"
+	    << "\t\"suite\": \"pipeline\",\n"
+	    << "\t\"timestamp\": \"" << std::put_time(std::gmtime(&now), "%Y-%m-%dT%H:%M:%SZ") << "\",\n"
+	    << "\t\"results\": [";
+	for (std::size_t i = 0; i < results.size(); ++i)
+	{
+		const PipelineResult& result = results[i];
+		out << (i == 0 ? "\n" : ",\n")
+		    << "\t\t{\n"
+		    << "\t\t\t\"mode\": \"" << result.mode << "\",\n"
+		    << "\t\t\t\"tileSize\": " << result.tileSize << ",\n"
+		    << "\t\t\t\"tiles\": " << result.tileCount << ",\n"
+		    << "\t\t\t\"jobs\": " << result.jobs << ",\n"
+		    << "\t\t\t\"repetitions\": " << result.repetitions << ",\n"
+		    << "\t\t\t\"pixels\": " << result.pixels << ",\n"
+		    << "\t\t\t\"minTime\": " << result.minTime << ",\n"
+		    << "\t\t\t\"meanTime\": " << result.meanTime << ",\n"
+		    << "\t\t\t\"pixelsPerSecond\": " << result.pixelsPerSecond() << ",\n"
+		    << "\t\t\t\"peakMemory\": " << result.peakMemory << ",\n"
+		    << "\t\t\t\"scalingEfficiency\": " << result.scalingEfficiency << ",\n"
+		    << "\t\t\t\"stages\": {";
+		bool isFirst = true;
+		for (const auto& item : result.stages.entries())
+		{
+			const CloudTools::MetricsSummary::Entry& entry = item.second;
+			out << (isFirst ? "\n" : ",\n")
+			    << "\t\t\t\t\"" << escapeJson(item.first) << "\": { "
+			    << "\"count\": " << entry.count << ", "
+			    << "\"wallTime\": " << entry.wallTime << ", "
+			    << "\"cpuTime\": " << entry.cpuTime << ", "
+			    << "\"bytesRead\": " << entry.bytesRead << ", "
+			    << "\"bytesWritten\": " << entry.bytesWritten << ", "
+			    << "\"pixels\": " << entry.pixels << ", "
+			    << "\"pixelsPerSecond\": " << (entry.wallTime > 0 ? entry.pixels / entry.wallTime : 0) << " }";
+			isFirst = false;
+		}
+		if (!isFirst)
+			out << "\n\t\t\t";
+		out << "}\n"
+		    << "\t\t}";
+	}
+	if (!results.empty())
+		out << "\n\t";
+	out << "]\n}" << std::endl;
+	if (!out)
+		throw std::runtime_error("Failed to write the benchmark results.");
+}
+
+std::size_t compareBaseline(const std::string& path, const std::vector<PipelineResult>& results, double threshold)
+{
+	pt::ptree baseline;
+	pt::read_json(path, baseline);
+
+	// Throughput of the baseline configurations by their key
+	std::map<std::string, double> throughputs;
+	for (const auto& item : baseline.get_child("results"))
+	{
+		const pt::ptree& entry = item.second;
+		std::ostringstream key;
+		key << entry.get<std::string>("mode")
+		    << " size=" << entry.get<int>("tileSize")
+		    << " tiles=" << entry.get<int>("tiles")
+		    << " jobs=" << entry.get<int>("jobs");
+		throughputs[key.str()] = entry.get<double>("pixelsPerSecond");
+	}
+
+	std::size_t regressionCount = 0;
+	for (const PipelineResult& result : results)
+	{
+		auto match = throughputs.find(result.key());
+		if (match == throughputs.end())
+		{
+			std::cout << "WARNING: no baseline for '" << result.key() << "'." << std::endl;
+			continue;
+		}
+
+		double ratio = result.pixelsPerSecond() / match->second;
+		if (ratio < 1 - threshold)
+		{
+			std::cerr << "REGRESSION: '" << result.key() << "' "
+				<< std::fixed << std::setprecision(2) << result.pixelsPerSecond() / 1e6 << " Mpx/s, baseline "
+				<< match->second / 1e6 << " Mpx/s (" << (ratio - 1) * 100 << "%)." << std::endl;
+			++regressionCount;
+		}
+	}
+	return regressionCount;
+}
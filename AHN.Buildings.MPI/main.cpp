@@ -1,7 +1,9 @@
 #include <string>
+#include <vector>
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <memory>
 #include <chrono>
 #include <ctime>
 #include <stdexcept>
@@ -9,9 +11,12 @@
 #include <mpi.h>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/regex.hpp>
 
 #include <CloudTools.Common/IO/IO.h>
+#include <CloudTools.Common/IO/TileCatalog.h>
+#include <CloudTools.Common/Metrics.h>
+#include <CloudTools.Common/Trace.h>
+#include <CloudTools.DEM/ColorRelief.h>
 #include <AHN.Buildings/Process.h>
 
 namespace po = boost::program_options;
@@ -21,14 +26,64 @@ using namespace CloudTools::IO;
 using namespace AHN::Buildings;
 
 const std::string pattern = "[[:digit:]]{2}[[:alpha:]]{2}[[:digit:]]";
+const std::string tileFilePattern = ".*\\.tif";
 
 /// <summary>
-/// Looks for the given tile input file in the specified directory.
+/// MPI message tags of the dynamic distribution.
 /// </summary>
-/// <param name="directory">Directory path.</param>
-/// <param name="tileName">Name of the tile.</param>
-/// <returns>Path for the found entry or exception is thrown when non found.</returns>
-fs::path lookupFile(const std::string& directory, const std::string& tileName);
+enum MessageTag
+{
+	/// <summary>
+	/// A worker requests a new tile, reporting its previous one.
+	/// </summary>
+	RequestTag = 1,
+	/// <summary>
+	/// The master assigns a tile to a worker (or -1 to stop).
+	/// </summary>
+	AssignTag = 2
+};
+
+/// <summary>
+/// The outcome of a tile process.
+/// </summary>
+enum TileStatus
+{
+	Processed = 0,
+	Failed = 1,
+	Skipped = 2
+};
+
+/// <summary>
+/// Represents the report of a processed tile.
+/// </summary>
+/// <remarks>
+/// Transferred through MPI as an array of <see cref="TileReport::Size" /> doubles.
+/// </remarks>
+struct TileReport
+{
+	static const int Size = 4;
+
+	int index = -1;
+	int rank = 0;
+	int status = Processed;
+	double duration = 0;
+
+	void pack(double* buffer) const
+	{
+		buffer[0] = index;
+		buffer[1] = rank;
+		buffer[2] = status;
+		buffer[3] = duration;
+	}
+
+	void unpack(const double* buffer)
+	{
+		index = static_cast<int>(buffer[0]);
+		rank = static_cast<int>(buffer[1]);
+		status = static_cast<int>(buffer[2]);
+		duration = buffer[3];
+	}
+};
 
 /// <summary>
 /// Processes a tile.
@@ -39,10 +94,55 @@ fs::path lookupFile(const std::string& directory, const std::string& tileName);
 /// <param name="ahn2Terrain">AHN-2 terrain DEM directory path.</param>
 /// <param name="ahn3Terrain">AHN-3 terrain DEM directory path.</param>
 /// <param name="outputDir">Result directory path.</param>
+/// <param name="colorRelief">Color relief of the results, none if empty.</param>
 void processTile(const std::string& tileName,
 				 const std::string& ahn2Surface, const std::string& ahn3Surface,
 				 const std::string& ahn2Terrain, const std::string& ahn3Terrain,
-				 const std::string& outputDir, const std::string& colorFile);
+				 const std::string& outputDir,
+				 const std::shared_ptr<const CloudTools::DEM::ColorRelief>& colorRelief);
+
+/// <summary>
+/// Distributes the tiles to the workers on request and collects their reports.
+/// </summary>
+/// <param name="tileCount">The number of tiles.</param>
+/// <param name="procCount">The number of processes, including the master.</param>
+/// <returns>The reports of the tiles.</returns>
+std::vector<TileReport> distributeTiles(int tileCount, int procCount);
+
+/// <summary>
+/// Gathers the reports of all processes to the master.
+/// </summary>
+/// <param name="reports">The reports of the current process.</param>
+/// <param name="procId">The rank of the current process.</param>
+/// <param name="procCount">The number of processes.</param>
+/// <returns>The reports of all processes on the master, otherwise the reports of the current process.</returns>
+std::vector<TileReport> gatherReports(const std::vector<TileReport>& reports, int procId, int procCount);
+
+/// <summary>
+/// Gathers a text of every process to the master.
+/// </summary>
+/// <param name="text">The text of the current process.</param>
+/// <param name="procId">The rank of the current process.</param>
+/// <param name="procCount">The number of processes.</param>
+/// <returns>The texts of all processes by rank on the master, otherwise empty.</returns>
+std::vector<std::string> gatherText(const std::string& text, int procId, int procCount);
+
+/// <summary>
+/// Gathers the performance metrics summaries of all processes to the master.
+/// </summary>
+/// <param name="summary">The summary of the current process.</param>
+/// <param name="procId">The rank of the current process.</param>
+/// <param name="procCount">The number of processes.</param>
+/// <returns>The merged summary of all processes on the master, otherwise the summary of the current process.</returns>
+CloudTools::MetricsSummary gatherMetrics(const CloudTools::MetricsSummary& summary, int procId, int procCount);
+
+/// <summary>
+/// Prints the summary of the processed tiles.
+/// </summary>
+/// <param name="tiles">The AHN-3 surface tiles.</param>
+/// <param name="reports">The reports of the tiles.</param>
+/// <param name="procCount">The number of processes.</param>
+void printSummary(const std::vector<TileEntry>& tiles, const std::vector<TileReport>& reports, int procCount);
 
 int main(int argc, char *argv[]) try
 {
@@ -53,6 +153,10 @@ int main(int argc, char *argv[]) try
 		ahn3TerrainDir,
 		outputDir;
 	std::string colorFile;
+	std::string catalogDir;
+	std::string metricsDir;
+	std::string traceFile;
+	std::string mode = "dynamic";
 
 	// Initalize MPI
 	MPI_Init(&argc, &argv);
@@ -75,6 +179,17 @@ int main(int argc, char *argv[]) try
 		("color-file", po::value<std::string>(&colorFile),
 			"map file for color relief; see:\n"
 			"http://www.gdal.org/gdaldem.html")
+		("catalog-dir", po::value<std::string>(&catalogDir),
+			"directory to persist the catalogs of the input directories in")
+		("metrics-dir", po::value<std::string>(&metricsDir),
+			"directory to write the performance metrics reports of the tiles (<tile>_metrics.json)\n"
+			"and their summary over all processes (summary.json) in")
+		("trace", po::value<std::string>(&traceFile),
+			"file to write the timeline of all processes in (Chrome trace format)")
+		("mode", po::value<std::string>(&mode)->default_value(mode),
+			"tile distribution mode:\n"
+			"static: contiguous blocks of tiles per process\n"
+			"dynamic: process #0 hands out tiles on request")
 		("help,h", "produce help message")
 		;
 
@@ -138,6 +253,18 @@ int main(int argc, char *argv[]) try
 		argumentError = true;
 	}
 
+	if (vm.count("metrics-dir") && !fs::is_directory(metricsDir) && !fs::create_directories(metricsDir))
+	{
+		std::cerr << "Failed to create metrics directory." << std::endl;
+		argumentError = true;
+	}
+
+	if (mode != "static" && mode != "dynamic")
+	{
+		std::cerr << "The given distribution mode is invalid." << std::endl;
+		argumentError = true;
+	}
+
 	if (argumentError)
 	{
 		std::cerr << "Use the --help option for description." << std::endl;
@@ -149,82 +276,153 @@ int main(int argc, char *argv[]) try
 	std::clock_t clockStart = std::clock();
 	auto timeStart = std::chrono::high_resolution_clock::now();
 	GDALAllRegister();
+	if (vm.count("trace"))
+	{
+		CloudTools::Trace::start();
+		CloudTools::Trace::setThreadName("Main");
+	}
+
+	std::shared_ptr<const CloudTools::DEM::ColorRelief> colorRelief;
+	if (vm.count("color-file"))
+		colorRelief = std::make_shared<CloudTools::DEM::ColorRelief>(colorFile);
 
-	// Count input files
-	int fileCount = 0;
-	for (fs::directory_iterator item(ahn3SurfaceDir); item != fs::directory_iterator(); ++item)
+	// Catalog input directories (tiles are ordered by path, so the same on all processes)
+	bool hasTerrain = vm.count("ahn2-terrain") && vm.count("ahn3-terrain");
+	TileCatalog ahn3SurfaceCatalog(ahn3SurfaceDir, tileFilePattern, pattern, TileCatalog::NoExtent, std::string(), catalogDir);
+	TileCatalog ahn2SurfaceCatalog(ahn2SurfaceDir, tileFilePattern, pattern, TileCatalog::NoExtent, std::string(), catalogDir);
+	std::unique_ptr<TileCatalog> ahn3TerrainCatalog, ahn2TerrainCatalog;
+	if (hasTerrain)
 	{
-		if (fs::is_regular_file(item->status()) && item->path().extension() == ".tif")
-		{
-			boost::regex tilePattern(pattern);
-			boost::smatch tileMatch;
+		ahn3TerrainCatalog.reset(new TileCatalog(ahn3TerrainDir, tileFilePattern, pattern, TileCatalog::NoExtent, std::string(), catalogDir));
+		ahn2TerrainCatalog.reset(new TileCatalog(ahn2TerrainDir, tileFilePattern, pattern, TileCatalog::NoExtent, std::string(), catalogDir));
+	}
+	const std::vector<TileEntry>& tiles = ahn3SurfaceCatalog.entries();
+	int fileCount = static_cast<int>(tiles.size());
+	CloudTools::MetricsSummary metricsSummary;
+
+	// Processes a tile and reports its outcome.
+	auto processFile = [&](int index)
+	{
+		TileReport report;
+		report.index = index;
+		report.rank = procId;
 
-			if (boost::regex_search(item->path().filename().string(), tileMatch, tilePattern))
+		const std::string& tileName = tiles[index].name;
+		std::string ahn3SurfaceFile = tiles[index].path,
+					ahn2SurfaceFile,
+					ahn3TerrainFile,
+					ahn2TerrainFile;
+
+		try
+		{
+			ahn2SurfaceFile = ahn2SurfaceCatalog.lookup(tileName);
+		}
+		catch (std::exception&)
+		{
+			std::cerr << "WARNING: skipped tile '" << tileName << "' because not all surface DEM files were present." << std::endl;
+			report.status = Skipped;
+			return report;
+		}
+		if (hasTerrain)
+		{
+			try
 			{
-				++fileCount;
+				ahn3TerrainFile = ahn3TerrainCatalog->lookup(tileName);
+				ahn2TerrainFile = ahn2TerrainCatalog->lookup(tileName);
+			}
+			catch (std::exception&)
+			{
+				std::cerr << "WARNING: skipped tile '" << tileName << "' because not all terrain DEM files were present." << std::endl;
+				report.status = Skipped;
+				return report;
 			}
 		}
-	}
 
-	// Select block of files to process.
-	int blockSize = fileCount / procCount;
-	int fileRemainder = fileCount - procCount * blockSize;
-	int blockStart = procId * blockSize + std::min(fileRemainder, procId);
-	if (fileRemainder > procId)	++blockSize;
-	int blockEnd = blockStart + blockSize;
-	std::cout << "[Process #" << procId << "] Found " << fileCount << " files, will work on files " << blockStart << ". - " << (blockEnd - 1) << "." << std::endl;
-
-	// Sequential process of selected tiles
-	int filePassed = 0;
-	for (fs::directory_iterator item(ahn3SurfaceDir); item != fs::directory_iterator(); ++item)
-	{
-		if (fs::is_regular_file(item->status()) && item->path().extension() == ".tif")
+		// Tile processing
+		std::cout << "[Process #" << procId << "] Started tile '" << tileName << "'" << std::endl;
+		auto tileStart = std::chrono::steady_clock::now();
+		try
 		{
-			boost::regex tilePattern(pattern);
-			boost::smatch tileMatch;
-
-			if (boost::regex_search(item->path().filename().string(), tileMatch, tilePattern))
+			CloudTools::Trace::Span span("tile", tileName);
+			std::unique_ptr<CloudTools::MetricsRecorder> recorder;
+			if (!metricsDir.empty())
+				recorder.reset(new CloudTools::MetricsRecorder(tileName));
+			processTile(tileName, ahn2SurfaceFile, ahn3SurfaceFile, ahn2TerrainFile, ahn3TerrainFile, outputDir, colorRelief);
+			if (recorder)
 			{
-				++filePassed;
-				if (filePassed <= blockStart) continue;
-				if (filePassed > blockEnd) break;
-
-				std::string tileName = tileMatch.str();
-				std::string ahn3SurfaceFile,
-							ahn2SurfaceFile,
-							ahn3TerrainFile,
-							ahn2TerrainFile;
-
-				try
-				{
-					ahn3SurfaceFile = item->path().string();
-					ahn2SurfaceFile = lookupFile(ahn2SurfaceDir, tileName).string();
-				}
-				catch (std::exception&)
-				{
-					std::cerr << "WARNING: skipped tile '" << tileName << "' because not all surface DEM files were present." << std::endl;
-					continue;
-				}
-				if (vm.count("ahn2-terrain") && vm.count("ahn3-terrain"))
-				{
-					try
-					{
-						ahn3TerrainFile = lookupFile(ahn3TerrainDir, tileName).string();
-						ahn2TerrainFile = lookupFile(ahn2TerrainDir, tileName).string();
-					}
-					catch (std::exception&)
-					{
-						std::cerr << "WARNING: skipped tile '" << tileName << "' because not all terrain DEM files were present." << std::endl;
-						continue;
-					}
-				}
-
-				// Tile processing
-				std::cout << "[Process #" << procId << "] Started tile '" << tileName << "'" << std::endl;
-				processTile(tileName, ahn2SurfaceFile, ahn3SurfaceFile, ahn2TerrainFile, ahn3TerrainFile, outputDir, colorFile);
-				std::cout << "[Process #" << procId << "] Finished tile '" << tileName << "'" << std::endl;
+				recorder->stop();
+				recorder->writeJson((fs::path(metricsDir) / (tileName + "_metrics.json")).string());
+				metricsSummary.add(recorder->metrics());
 			}
+			std::cout << "[Process #" << procId << "] Finished tile '" << tileName << "'" << std::endl;
+		}
+		catch (std::exception& ex)
+		{
+			std::cerr << "ERROR processing tile '" << tileName << "' " << std::endl
+					  << "ERROR: " << ex.what() << std::endl;
+			report.status = Failed;
 		}
+		report.duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - tileStart).count();
+		return report;
+	};
+
+	std::vector<TileReport> reports;
+	if (mode == "static" || procCount == 1)
+	{
+		// Select block of files to process.
+		int blockSize = fileCount / procCount;
+		int fileRemainder = fileCount - procCount * blockSize;
+		int blockStart = procId * blockSize + std::min(fileRemainder, procId);
+		if (fileRemainder > procId)	++blockSize;
+		int blockEnd = blockStart + blockSize;
+		std::cout << "[Process #" << procId << "] Found " << fileCount << " files, will work on files " << blockStart << ". - " << (blockEnd - 1) << "." << std::endl;
+
+		// Sequential process of selected tiles
+		for (int index = blockStart; index < blockEnd; ++index)
+			reports.push_back(processFile(index));
+		reports = gatherReports(reports, procId, procCount);
+	}
+	else if (procId == 0)
+	{
+		std::cout << "[Process #" << procId << "] Found " << fileCount << " files, distributing them on request." << std::endl;
+		reports = distributeTiles(fileCount, procCount);
+	}
+	else
+	{
+		// Request tiles until the master stops the worker, reporting the previous one.
+		TileReport report;
+		report.rank = procId;
+		double buffer[TileReport::Size];
+		while (true)
+		{
+			report.pack(buffer);
+			MPI_Send(buffer, TileReport::Size, MPI_DOUBLE, 0, RequestTag, MPI_COMM_WORLD);
+
+			int index;
+			MPI_Recv(&index, 1, MPI_INT, 0, AssignTag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			if (index < 0)
+				break;
+			report = processFile(index);
+		}
+	}
+
+	if (procId == 0)
+		printSummary(tiles, reports, procCount);
+
+	if (!metricsDir.empty())
+	{
+		metricsSummary = gatherMetrics(metricsSummary, procId, procCount);
+		if (procId == 0)
+			metricsSummary.writeJson((fs::path(metricsDir) / "summary.json").string());
+	}
+
+	// The timelines of the processes are merged on the master
+	if (vm.count("trace"))
+	{
+		CloudTools::Trace::stop();
+		std::vector<std::string> events = gatherText(CloudTools::Trace::events(procId), procId, procCount);
+		if (procId == 0)
+			CloudTools::Trace::writeJson(traceFile, events);
 	}
 
 	// Execution time measurement
@@ -248,49 +446,150 @@ catch (std::exception& ex)
 	return UnexcpectedError;
 }
 
-fs::path lookupFile(const std::string& directory, const std::string& tileName)
-{
-	fs::directory_iterator result = std::find_if(fs::directory_iterator(directory), fs::directory_iterator(),
-		[&tileName](fs::directory_entry entry)
-	{
-		if (!fs::is_regular_file(entry.status()) || entry.path().extension() != ".tif")
-			return false;
-
-		boost::regex pattern(".*" + tileName + ".*");
-		return boost::regex_match(entry.path().stem().string(), pattern);
-	});
-
-	if (result == fs::directory_iterator())
-		throw std::runtime_error("No input found in directory '" + directory + "' for tile '" + tileName + "'.");
-	return result->path();
-}
-
 void processTile(const std::string& tileName,
 				 const std::string& ahn2Surface, const std::string& ahn3Surface,
 				 const std::string& ahn2Terrain, const std::string& ahn3Terrain,
-				 const std::string& outputDir, const std::string& colorFile)
+				 const std::string& outputDir,
+				 const std::shared_ptr<const CloudTools::DEM::ColorRelief>& colorRelief)
 {
 	// Process configuration
-	InMemoryProcess* process;
+	std::unique_ptr<InMemoryProcess> process;
 	if (ahn2Terrain.empty() || ahn3Terrain.empty())
-		process = new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, outputDir);
+		process.reset(new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, outputDir));
 	else
-		process = new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, ahn2Terrain, ahn3Terrain, outputDir);
+		process.reset(new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, ahn2Terrain, ahn3Terrain, outputDir));
 	process->progress = [](float complete, const std::string &message)
 	{
 		return true;
 	};
-	process->colorFile = colorFile;
+	process->colorRelief = colorRelief;
 
 	// Execute process
-	try
+	process->execute();
+}
+
+std::vector<TileReport> distributeTiles(int tileCount, int procCount)
+{
+	std::vector<TileReport> reports;
+	reports.reserve(tileCount);
+
+	int nextTile = 0;
+	int activeWorkers = procCount - 1;
+	double buffer[TileReport::Size];
+	while (activeWorkers > 0)
+	{
+		MPI_Status status;
+		MPI_Recv(buffer, TileReport::Size, MPI_DOUBLE, MPI_ANY_SOURCE, RequestTag, MPI_COMM_WORLD, &status);
+
+		TileReport report;
+		report.unpack(buffer);
+		if (report.index >= 0)
+			reports.push_back(report);
+
+		int index = -1;
+		if (nextTile < tileCount)
+			index = nextTile++;
+		else
+			--activeWorkers;
+		MPI_Send(&index, 1, MPI_INT, status.MPI_SOURCE, AssignTag, MPI_COMM_WORLD);
+	}
+	return reports;
+}
+
+std::vector<TileReport> gatherReports(const std::vector<TileReport>& reports, int procId, int procCount)
+{
+	int count = static_cast<int>(reports.size());
+	std::vector<int> counts(procId == 0 ? procCount : 0);
+	MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	std::vector<double> buffer(reports.size() * TileReport::Size);
+	for (std::size_t i = 0; i < reports.size(); ++i)
+		reports[i].pack(&buffer[i * TileReport::Size]);
+
+	std::vector<int> sizes, offsets;
+	std::vector<double> gathered;
+	if (procId == 0)
+	{
+		int total = 0;
+		for (int rank = 0; rank < procCount; ++rank)
+		{
+			sizes.push_back(counts[rank] * TileReport::Size);
+			offsets.push_back(total);
+			total += sizes.back();
+		}
+		gathered.resize(total);
+	}
+	MPI_Gatherv(buffer.data(), static_cast<int>(buffer.size()), MPI_DOUBLE,
+	            gathered.data(), sizes.data(), offsets.data(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+	if (procId != 0)
+		return reports;
+
+	std::vector<TileReport> result(gathered.size() / TileReport::Size);
+	for (std::size_t i = 0; i < result.size(); ++i)
+		result[i].unpack(&gathered[i * TileReport::Size]);
+	return result;
+}
+
+std::vector<std::string> gatherText(const std::string& text, int procId, int procCount)
+{
+	int length = static_cast<int>(text.size());
+	std::vector<int> lengths(procId == 0 ? procCount : 0);
+	MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	std::vector<int> offsets;
+	std::vector<char> gathered;
+	if (procId == 0)
 	{
-		process->execute();
+		int total = 0;
+		for (int rank = 0; rank < procCount; ++rank)
+		{
+			offsets.push_back(total);
+			total += lengths[rank];
+		}
+		gathered.resize(total);
 	}
-	catch (std::exception& ex)
+	MPI_Gatherv(const_cast<char*>(text.data()), length, MPI_CHAR,
+	            gathered.data(), lengths.data(), offsets.data(), MPI_CHAR, 0, MPI_COMM_WORLD);
+
+	std::vector<std::string> result;
+	if (procId == 0)
+		for (int rank = 0; rank < procCount; ++rank)
+			result.emplace_back(gathered.data() + offsets[rank], lengths[rank]);
+	return result;
+}
+
+CloudTools::MetricsSummary gatherMetrics(const CloudTools::MetricsSummary& summary, int procId, int procCount)
+{
+	std::vector<std::string> texts = gatherText(summary.serialize(), procId, procCount);
+	if (procId != 0)
+		return summary;
+
+	CloudTools::MetricsSummary result;
+	for (const std::string& text : texts)
+		result.merge(CloudTools::MetricsSummary::deserialize(text));
+	return result;
+}
+
+void printSummary(const std::vector<TileEntry>& tiles, const std::vector<TileReport>& reports, int procCount)
+{
+	const char* statusNames[] = { "processed", "failed", "skipped" };
+	std::vector<double> rankDurations(procCount, 0);
+	int statusCounts[3] = { 0, 0, 0 };
+
+	std::cout << std::endl << "Summary:" << std::endl << std::fixed << std::setprecision(2);
+	for (const TileReport& report : reports)
 	{
-		std::cerr << "ERROR processing tile '" << tileName << "' " << std::endl
-				  << "ERROR: " << ex.what() << std::endl;
+		std::cout << "Tile '" << tiles[report.index].name << "': "
+			<< statusNames[report.status] << " by process #" << report.rank
+			<< " in " << report.duration << " s" << std::endl;
+		rankDurations[report.rank] += report.duration;
+		++statusCounts[report.status];
 	}
-	delete process;
+
+	std::cout << "Processed: " << statusCounts[Processed]
+		<< ", failed: " << statusCounts[Failed]
+		<< ", skipped: " << statusCounts[Skipped] << std::endl;
+	for (int rank = 0; rank < procCount; ++rank)
+		std::cout << "Process #" << rank << " busy for " << rankDurations[rank] / 60 << " min" << std::endl;
 }
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <chrono>
+#include <exception>
+#include <string>
+
+#include <CloudTools.Common/ThreadPool.h>
+#include <CloudTools.Common/Trace.h>
+#include "TileScheduler.h"
+
+namespace AHN
+{
+namespace Buildings
+{
+TileScheduler::TileScheduler(std::size_t workerCount, std::size_t memoryBudget)
+	: _workerCount(std::max<std::size_t>(1, workerCount)), _memoryBudget(memoryBudget)
+{ }
+
+void TileScheduler::add(const std::string& name, std::size_t memory, TaskType task)
+{
+	_tiles.push_back({ name, memory, std::move(task) });
+}
+
+std::vector<TileResult> TileScheduler::run()
+{
+	// Largest tiles first
+	std::stable_sort(_tiles.begin(), _tiles.end(),
+		[](const Tile& a, const Tile& b)
+		{
+			return a.memory > b.memory;
+		});
+
+	std::vector<TileResult> results;
+	results.reserve(_tiles.size());
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<bool> isTaken(_tiles.size(), false);
+	std::size_t nextTile = 0; // the first tile not taken yet
+	std::size_t runningCount = 0;
+	std::size_t usedMemory = 0;
+
+	auto worker = [&]()
+	{
+		if (CloudTools::Trace::isEnabled())
+			CloudTools::Trace::setThreadName("Tile worker");
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			// Find the largest tile fitting into the remaining budget.
+			std::size_t index = _tiles.size();
+			std::int64_t waitStart = CloudTools::Trace::now();
+			bool hasWaited = false;
+			condition.wait(lock, [&]
+			{
+				while (nextTile < _tiles.size() && isTaken[nextTile])
+					++nextTile;
+				if (nextTile == _tiles.size())
+					return true;
+
+				for (index = nextTile; index < _tiles.size(); ++index)
+					if (!isTaken[index] &&
+					    (_memoryBudget == 0 || runningCount == 0 ||
+					     usedMemory + _tiles[index].memory <= _memoryBudget))
+						return true;
+				hasWaited = true;
+				return false;
+			});
+			if (hasWaited)
+				CloudTools::Trace::complete("scheduler", "wait", waitStart, "memory budget exhausted");
+			if (nextTile == _tiles.size())
+				return;
+
+			Tile& tile = _tiles[index];
+			isTaken[index] = true;
+			usedMemory += tile.memory;
+			++runningCount;
+			if (started)
+				started(tile.name, tile.memory);
+			if (CloudTools::Trace::isEnabled())
+				CloudTools::Trace::instant("scheduler", "start " + tile.name,
+					"memory: " + std::to_string(tile.memory / 1024 / 1024) + " MB, " +
+					"used: " + std::to_string(usedMemory / 1024 / 1024) + " MB, " +
+					"running: " + std::to_string(runningCount));
+			lock.unlock();
+
+			TileResult result;
+			result.name = tile.name;
+			auto start = std::chrono::steady_clock::now();
+			try
+			{
+				CloudTools::Trace::Span span("tile", tile.name);
+				tile.task();
+			}
+			catch (std::exception& ex)
+			{
+				result.error = ex.what();
+			}
+			catch (...)
+			{
+				result.error = "Unknown error.";
+			}
+			result.duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			lock.lock();
+			usedMemory -= tile.memory;
+			--runningCount;
+			if (finished)
+				finished(result);
+			results.push_back(std::move(result));
+			condition.notify_all();
+		}
+	};
+
+	{
+		CloudTools::ThreadPool pool(std::min(_workerCount, _tiles.size()));
+		std::vector<std::future<void>> futures;
+		for (std::size_t i = 0; i < pool.size(); ++i)
+			futures.push_back(pool.submit(worker));
+		for (std::future<void>& future : futures)
+			future.get();
+	}
+
+	_tiles.clear();
+	return results;
+}
+} // Buildings
+} // AHN
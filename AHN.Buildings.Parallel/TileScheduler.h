@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace AHN
+{
+namespace Buildings
+{
+/// <summary>
+/// Represents the outcome of a processed tile.
+/// </summary>
+struct TileResult
+{
+	/// <summary>
+	/// The name of the tile.
+	/// </summary>
+	std::string name;
+	/// <summary>
+	/// The wall clock duration of the processing in seconds.
+	/// </summary>
+	double duration = 0;
+	/// <summary>
+	/// The error message if the processing failed, otherwise empty.
+	/// </summary>
+	std::string error;
+};
+
+/// <summary>
+/// Represents a scheduler processing tiles on a fixed pool of workers.
+/// </summary>
+/// <remarks>
+/// The workers share a single queue of tiles ordered by their estimated memory footprint, largest first,
+/// so the longest jobs are not left to the end. A tile is only started when its footprint fits into the
+/// memory budget beside the running tiles; a tile exceeding the complete budget is started alone.
+/// </remarks>
+class TileScheduler
+{
+public:
+	typedef std::function<void()> TaskType;
+
+	/// <summary>
+	/// Callback function called when a tile is started.
+	/// </summary>
+	/// <remarks>
+	/// Calls are serialized, but may come from any of the worker threads.
+	/// </remarks>
+	std::function<void(const std::string& name, std::size_t memory)> started;
+
+	/// <summary>
+	/// Callback function called when a tile is finished or failed.
+	/// </summary>
+	/// <remarks>
+	/// Calls are serialized, but may come from any of the worker threads.
+	/// </remarks>
+	std::function<void(const TileResult& result)> finished;
+
+private:
+	struct Tile
+	{
+		std::string name;
+		std::size_t memory;
+		TaskType task;
+	};
+
+	std::vector<Tile> _tiles;
+	std::size_t _workerCount;
+	std::size_t _memoryBudget;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class.
+	/// </summary>
+	/// <param name="workerCount">The number of workers, at least 1.</param>
+	/// <param name="memoryBudget">The memory budget of the concurrently processed tiles in bytes, 0 for unlimited.</param>
+	TileScheduler(std::size_t workerCount, std::size_t memoryBudget = 0);
+
+	TileScheduler(const TileScheduler&) = delete;
+	TileScheduler& operator=(const TileScheduler&) = delete;
+
+	/// <summary>
+	/// Adds a tile to the queue.
+	/// </summary>
+	/// <param name="name">The name of the tile.</param>
+	/// <param name="memory">The estimated memory footprint of the tile in bytes.</param>
+	/// <param name="task">The callback function processing the tile.</param>
+	void add(const std::string& name, std::size_t memory, TaskType task);
+
+	/// <summary>
+	/// Gets the number of queued tiles.
+	/// </summary>
+	std::size_t size() const { return _tiles.size(); }
+
+	/// <summary>
+	/// Processes the queued tiles and waits for all of them to finish.
+	/// </summary>
+	/// <remarks>
+	/// A failing tile does not stop the processing of the others.
+	/// </remarks>
+	/// <returns>The results of the tiles in their order of completion.</returns>
+	std::vector<TileResult> run();
+};
+} // Buildings
+} // AHN
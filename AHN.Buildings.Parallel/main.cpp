@@ -1,50 +1,47 @@
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
-#include <future>
+#include <functional>
 #include <chrono>
-#include <unordered_map>
-#include <utility>
 #include <algorithm>
 #include <ctime>
 #include <stdexcept>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/regex.hpp>
+#include <gdal_priv.h>
 
 #include <CloudTools.Common/IO/IO.h>
-#include <CloudTools.Common/IO/Reporter.h>
+#include <CloudTools.Common/IO/TileCatalog.h>
+#include <CloudTools.Common/Metrics.h>
+#include <CloudTools.Common/ThreadPool.h>
+#include <CloudTools.Common/Trace.h>
+#include <CloudTools.DEM/Mosaic.h>
+#include <CloudTools.DEM/ColorRelief.h>
 #include <AHN.Buildings/Process.h>
+#include "TileScheduler.h"
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
 using namespace CloudTools::IO;
+using namespace CloudTools::DEM;
 using namespace AHN::Buildings;
 
 /// <summary>
-/// Mutex for guarding the starting of a new tile process.
+/// The estimated peak memory usage of a tile process per pixel in bytes.
 /// </summary>
-std::mutex initMutex;
-/// <summary>
-/// Condition variable for guarding the starting of a new tile process.
-/// </summary>
-std::condition_variable initCondition;
-/// <summary>
-/// <c>true</c> if a tile is under initialization; otherwise <c>false</c>.
-/// </summary>
-bool isInitializing = false;
+/// <remarks>
+/// At most 4 single precision intermediate rasters are alive at once, with the bookkeeping of the cluster filter on top of it.
+/// </remarks>
+const std::size_t BytesPerPixel = 24;
 
 /// <summary>
-/// Looks for the given tile input file in the specified directory.
+/// File pattern of the input tiles.
 /// </summary>
-/// <param name="directory">Directory path.</param>
-/// <param name="tileName">Name of the tile.</param>
-/// <returns>Path for the found entry or exception is thrown when non found.</returns>
-fs::path lookupFile(const std::string& directory, const std::string& tileName);
+const std::string tileFilePattern = ".*\\.tif";
 
 /// <summary>
 /// Processes a tile.
@@ -55,10 +52,24 @@ fs::path lookupFile(const std::string& directory, const std::string& tileName);
 /// <param name="ahn2Terrain">AHN-2 terrain DEM directory path.</param>
 /// <param name="ahn3Terrain">AHN-3 terrain DEM directory path.</param>
 /// <param name="outputDir">Result directory path.</param>
+/// <param name="colorRelief">Color relief of the results, none if empty.</param>
+/// <param name="stagePool">The thread pool executing the stages of all tiles.</param>
+/// <param name="resultExtent">The extent to crop the results to, no cropping if uninitialized.</param>
 void processTile(const std::string& tileName,
                  const std::string& ahn2Surface, const std::string& ahn3Surface,
                  const std::string& ahn2Terrain, const std::string& ahn3Terrain,
-                 const std::string& outputDir, const std::string& colorFile);
+                 const std::string& outputDir,
+                 const std::shared_ptr<const ColorRelief>& colorRelief,
+                 CloudTools::ThreadPool& stagePool,
+                 const OGREnvelope& resultExtent = OGREnvelope());
+
+/// <summary>
+/// Estimates the peak memory usage of processing a tile.
+/// </summary>
+/// <param name="surface">The catalog entry of a surface DEM file of the tile.</param>
+/// <param name="halo">The size of the halo read from the neighbouring tiles in pixels.</param>
+/// <returns>The estimated memory usage in bytes.</returns>
+std::size_t estimateMemory(const TileEntry& surface, int halo);
 
 int main(int argc, char* argv[]) try
 {
@@ -68,8 +79,13 @@ int main(int argc, char* argv[]) try
 	            ahn3TerrainDir;
 	std::string outputDir = fs::current_path().string();
 	std::string colorFile;
+	std::string catalogDir;
+	std::string metricsDir;
+	std::string traceFile;
 	std::string pattern = "[[:digit:]]{2}[[:alpha:]]{2}[[:digit:]]";
 	unsigned short maxJobs = std::thread::hardware_concurrency();
+	std::size_t memoryBudget = 0;
+	int halo = 16;
 
 	// Read console arguments
 	po::options_description desc("Allowed options");
@@ -86,11 +102,24 @@ int main(int argc, char* argv[]) try
 		 "result directory path")
 		("pattern", po::value<std::string>(&pattern)->default_value(pattern),
 		 "tile name pattern")
+		("catalog-dir", po::value<std::string>(&catalogDir),
+		 "directory to persist the catalogs of the input directories in")
+		("metrics-dir", po::value<std::string>(&metricsDir),
+		 "directory to write the performance metrics reports of the tiles (<tile>_metrics.json) "
+		 "and their summary (summary.json) in")
+		("trace", po::value<std::string>(&traceFile),
+		 "file to write the timeline of the jobs in (Chrome trace format)")
 		("color-file", po::value<std::string>(&colorFile),
 		 "map file for color relief; see:\n"
 		 "http://www.gdal.org/gdaldem.html")
 		("jobs,j", po::value<unsigned short>(&maxJobs)->default_value(maxJobs),
 		 "number of maximum jobs to execute simultaneously")
+		("memory-budget", po::value<std::size_t>(&memoryBudget)->default_value(memoryBudget),
+		 "memory budget of the simultaneous jobs in MB (0 for unlimited)")
+		("mosaic", "process the tiles as a seamless mosaic, "
+		 "reading the borders of the neighbouring tiles")
+		("halo", po::value<int>(&halo)->default_value(halo),
+		 "size of the border read from the neighbouring tiles in mosaic mode (in pixels)")
 		("help,h", "produce help message");
 
 	po::variables_map vm;
@@ -148,6 +177,18 @@ int main(int argc, char* argv[]) try
 		argumentError = true;
 	}
 
+	if (vm.count("metrics-dir") && !fs::is_directory(metricsDir) && !fs::create_directories(metricsDir))
+	{
+		std::cerr << "Failed to create metrics directory." << std::endl;
+		argumentError = true;
+	}
+
+	if (halo < 0)
+	{
+		std::cerr << "The halo size must not be negative." << std::endl;
+		argumentError = true;
+	}
+
 	if (argumentError)
 	{
 		std::cerr << "Use the --help option for description." << std::endl;
@@ -159,111 +200,201 @@ int main(int argc, char* argv[]) try
 	std::clock_t clockStart = std::clock();
 	auto timeStart = std::chrono::high_resolution_clock::now();
 	GDALAllRegister();
+	if (vm.count("trace"))
+	{
+		CloudTools::Trace::start();
+		CloudTools::Trace::setThreadName("Main");
+	}
+
+	// The color file is parsed once for all tiles
+	std::shared_ptr<const ColorRelief> colorRelief;
+	if (vm.count("color-file"))
+		colorRelief = std::make_shared<ColorRelief>(colorFile);
+
+	// The stages of all tiles are executed on a shared pool, so the number of
+	// working threads is limited globally, while the scheduler threads only wait for their tiles.
+	CloudTools::ThreadPool stagePool(maxJobs);
 
 	// Parallel process of tiles
-	std::unordered_map<std::string, std::future<void>> futures;
-	futures.reserve(maxJobs);
+	TileScheduler scheduler(maxJobs, memoryBudget * 1024 * 1024);
+	scheduler.started = [](const std::string& tileName, std::size_t memory)
+	{
+		std::cout << "Tile '" << tileName << "' started (estimated memory: "
+			<< memory / 1024 / 1024 << " MB)." << std::endl;
+	};
+	scheduler.finished = [](const TileResult& result)
+	{
+		if (result.error.empty())
+			std::cout << "Tile '" << result.name << "' ready in "
+				<< std::fixed << std::setprecision(2) << result.duration << " s." << std::endl;
+		else
+			std::cerr << "ERROR processing tile '" << result.name << "' " << std::endl
+				<< "ERROR: " << result.error << std::endl;
+	};
+
+	// Performance metrics of the tiles, the failed ones are not reported
+	std::mutex metricsMutex;
+	CloudTools::MetricsSummary metricsSummary;
+	auto recordTile = [&metricsDir, &metricsMutex, &metricsSummary](const std::string& tileName, const std::function<void()>& task)
+	{
+		if (metricsDir.empty())
+		{
+			task();
+			return;
+		}
+
+		CloudTools::MetricsRecorder recorder(tileName);
+		task();
+		recorder.stop();
+		recorder.writeJson((fs::path(metricsDir) / (tileName + "_metrics.json")).string());
+
+		std::lock_guard<std::mutex> lock(metricsMutex);
+		metricsSummary.add(recorder.metrics());
+	};
+
+	// Catalog input directories
+	bool hasTerrain = vm.count("ahn2-terrain") && vm.count("ahn3-terrain");
+	TileCatalog ahn3SurfaceCatalog(ahn3SurfaceDir, tileFilePattern, pattern, TileCatalog::RasterExtent, std::string(), catalogDir);
+	TileCatalog ahn2SurfaceCatalog(ahn2SurfaceDir, tileFilePattern, pattern, TileCatalog::NoExtent, std::string(), catalogDir);
+	std::unique_ptr<TileCatalog> ahn3TerrainCatalog, ahn2TerrainCatalog;
+	if (hasTerrain)
+	{
+		ahn3TerrainCatalog.reset(new TileCatalog(ahn3TerrainDir, tileFilePattern, pattern, TileCatalog::NoExtent, std::string(), catalogDir));
+		ahn2TerrainCatalog.reset(new TileCatalog(ahn2TerrainDir, tileFilePattern, pattern, TileCatalog::NoExtent, std::string(), catalogDir));
+	}
 
-	for (fs::directory_iterator item(ahn3SurfaceDir); item != fs::directory_iterator(); ++item)
+	// Virtual mosaics of the input directories
+	bool isMosaic = vm.count("mosaic") > 0;
+	std::unique_ptr<Mosaic> ahn2SurfaceMosaic, ahn3SurfaceMosaic,
+	                        ahn2TerrainMosaic, ahn3TerrainMosaic;
+	if (isMosaic)
 	{
-		if (fs::is_regular_file(item->status()) && item->path().extension() == ".tif")
+		auto buildMosaic = [](const TileCatalog& catalog, const std::string& name)
 		{
-			boost::regex tilePattern(pattern);
-			boost::smatch tileMatch;
+			std::vector<std::string> paths;
+			for (const TileEntry& entry : catalog.entries())
+				paths.push_back(entry.path);
+			return std::unique_ptr<Mosaic>(new Mosaic(paths, "/vsimem/" + name + ".vrt"));
+		};
 
-			if (boost::regex_search(item->path().filename().string(), tileMatch, tilePattern))
+		ahn2SurfaceMosaic = buildMosaic(ahn2SurfaceCatalog, "ahn2_surface");
+		ahn3SurfaceMosaic = buildMosaic(ahn3SurfaceCatalog, "ahn3_surface");
+		if (hasTerrain)
+		{
+			ahn2TerrainMosaic = buildMosaic(*ahn2TerrainCatalog, "ahn2_terrain");
+			ahn3TerrainMosaic = buildMosaic(*ahn3TerrainCatalog, "ahn3_terrain");
+		}
+	}
+
+	// Tiles are visited along a space-filling curve, so that neighbours sharing halos are processed close in time
+	// (the scheduler keeps this order among tiles of equal size).
+	for (const TileEntry* tilePointer : ahn3SurfaceCatalog.spatialOrder())
+	{
+		const TileEntry& tile = *tilePointer;
+		const std::string& tileName = tile.name;
+		std::string ahn3SurfaceFile = tile.path,
+		            ahn2SurfaceFile,
+		            ahn3TerrainFile,
+		            ahn2TerrainFile;
+
+		try
+		{
+			ahn2SurfaceFile = ahn2SurfaceCatalog.lookup(tileName);
+		}
+		catch (std::exception&)
+		{
+			std::cerr << "WARNING: skipped tile '" << tileName << "' because not all surface DEM files were present." << std::endl;
+			continue;
+		}
+		if (hasTerrain)
+		{
+			try
 			{
-				std::string tileName = tileMatch.str();
-				std::string ahn3SurfaceFile,
-				            ahn2SurfaceFile,
-				            ahn3TerrainFile,
-				            ahn2TerrainFile;
+				ahn3TerrainFile = ahn3TerrainCatalog->lookup(tileName);
+				ahn2TerrainFile = ahn2TerrainCatalog->lookup(tileName);
+			}
+			catch (std::exception&)
+			{
+				std::cerr << "WARNING: skipped tile '" << tileName << "' because not all terrain DEM files were present." << std::endl;
+				continue;
+			}
+		}
 
-				try
-				{
-					ahn3SurfaceFile = item->path().string();
-					ahn2SurfaceFile = lookupFile(ahn2SurfaceDir, tileName).string();
-				}
-				catch (std::exception&)
-				{
-					std::cerr << "WARNING: skipped tile '" << tileName << "' because not all surface DEM files were present." << std::endl;
-					continue;
-				}
-				if (vm.count("ahn2-terrain") && vm.count("ahn3-terrain"))
+		if (!isMosaic)
+		{
+			scheduler.add(tileName, estimateMemory(tile, 0),
+				[=, &stagePool]()
 				{
-					try
-					{
-						ahn3TerrainFile = lookupFile(ahn3TerrainDir, tileName).string();
-						ahn2TerrainFile = lookupFile(ahn2TerrainDir, tileName).string();
-					}
-					catch (std::exception&)
+					recordTile(tileName, [&]()
 					{
-						std::cerr << "WARNING: skipped tile '" << tileName << "' because not all terrain DEM files were present." << std::endl;
-						continue;
-					}
-				}
+						processTile(tileName,
+						            ahn2SurfaceFile, ahn3SurfaceFile,
+						            ahn2TerrainFile, ahn3TerrainFile,
+						            outputDir, colorRelief, stagePool);
+					});
+				});
+			continue;
+		}
 
-				// New tile process can be started if none is under initialization and there is a free job slot.
-				std::unique_lock<std::mutex> lock(initMutex);
-				initCondition.wait(lock,
-				                   [maxJobs, &futures]
-				                   {
-					                   if (!isInitializing && futures.size() > 0)
-					                   {
-						                   std::cout << std::endl << "Job status:" << std::endl;
-						                   for (auto it = futures.begin(); it != futures.end();)
-						                   {
-											   const auto item = it++;
-							                   std::cout << "Tile '" << item->first << "': ";
-							                   if (item->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
-							                   {
-								                   std::cout << "ready" << std::endl;
-								                   futures.erase(item);
-							                   }
-							                   else
-								                   std::cout << "processing" << std::endl;
-						                   };
-						                   if (futures.size() == maxJobs)
-							                   std::cout << "All job slots are busy, waiting." << std::endl;
-					                   }
-
-					                   return !isInitializing && futures.size() < maxJobs;
-				                   });
-				isInitializing = true;
-				lock.unlock();
-
-				// Start tile processing.
-				std::cout << std::endl
-					<< "Tile '" << tileName << "' is being initialized ..." << std::endl;
-				futures.insert(
-					std::make_pair(tileName,
-					               std::async(std::launch::async,
-					                          processTile, tileName,
-					                          ahn2SurfaceFile, ahn3SurfaceFile,
-					                          ahn2TerrainFile, ahn3TerrainFile,
-					                          outputDir, colorFile)));
-			}
+		if (!tile.hasExtent)
+		{
+			std::cerr << "WARNING: skipped tile '" << tileName << "' because its extent is unknown." << std::endl;
+			continue;
 		}
-	}
 
-	// Waiting for remaining jobs to finish.
-	std::unique_lock<std::mutex> lock(initMutex);
-	initCondition.wait(lock, [maxJobs]
-	                   {
-		                   return !isInitializing;
-	                   });
-	lock.unlock();
+		OGREnvelope extent;
+		extent.MinX = tile.minX;
+		extent.MinY = tile.minY;
+		extent.MaxX = tile.maxX;
+		extent.MaxY = tile.maxY;
+		scheduler.add(tileName, estimateMemory(tile, halo),
+			[&, tileName, extent]()
+			{
+				// Virtual cut-outs of the tile with the halo
+				std::string prefix = "/vsimem/" + tileName + "_";
+				std::vector<std::string> cutouts;
+				auto cutout = [&](const std::unique_ptr<Mosaic>& mosaic, const std::string& name)
+				{
+					if (!mosaic)
+						return std::string();
+					cutouts.push_back(prefix + name + ".vrt");
+					mosaic->cutout(cutouts.back(), extent.MinX, extent.MinY, extent.MaxX, extent.MaxY, halo);
+					return cutouts.back();
+				};
 
-	std::cout << std::endl
-		<< "All jobs started." << std::endl
-		<< "Waiting for remaing tasks to finish: " << std::endl;
-	for (const auto& item : futures)
-	{
-		std::cout << "Tile '" << item.first << "': ";
-		item.second.wait();
-		std::cout << "ready" << std::endl;
+				try
+				{
+					recordTile(tileName, [&]()
+					{
+						processTile(tileName,
+						            cutout(ahn2SurfaceMosaic, "ahn2_surface"), cutout(ahn3SurfaceMosaic, "ahn3_surface"),
+						            cutout(ahn2TerrainMosaic, "ahn2_terrain"), cutout(ahn3TerrainMosaic, "ahn3_terrain"),
+						            outputDir, colorRelief, stagePool, extent);
+					});
+				}
+				catch (...)
+				{
+					for (const std::string& path : cutouts)
+						VSIUnlink(path.c_str());
+					throw;
+				}
+				for (const std::string& path : cutouts)
+					VSIUnlink(path.c_str());
+			});
 	}
-	futures.clear();
+
+	std::cout << scheduler.size() << " tiles found, processing on "
+		<< std::min<std::size_t>(maxJobs, scheduler.size()) << " jobs." << std::endl;
+	std::vector<TileResult> results = scheduler.run();
+	std::size_t failedCount = std::count_if(results.begin(), results.end(),
+		[](const TileResult& result)
+		{
+			return !result.error.empty();
+		});
+	if (!metricsDir.empty())
+		metricsSummary.writeJson((fs::path(metricsDir) / "summary.json").string());
+	if (vm.count("trace"))
+		CloudTools::Trace::writeJson(traceFile);
 
 	// Execution time measurement
 	std::clock_t clockEnd = std::clock();
@@ -271,6 +402,7 @@ int main(int argc, char* argv[]) try
 
 	std::cout << std::endl
 		<< "All completed!" << std::endl << std::fixed << std::setprecision(2)
+		<< "Tiles processed: " << results.size() - failedCount << ", failed: " << failedCount << std::endl
 		<< "CPU time used: "
 		<< 1.f * (clockEnd - clockStart) / CLOCKS_PER_SEC / 60 << " min" << std::endl
 		<< "Wall clock time passed: "
@@ -284,82 +416,34 @@ catch (std::exception& ex)
 	return UnexcpectedError;
 }
 
-fs::path lookupFile(const std::string& directory, const std::string& tileName)
-{
-	fs::directory_iterator result = std::find_if(fs::directory_iterator(directory), fs::directory_iterator(),
-		[&tileName](fs::directory_entry entry)
-	{
-		if (!fs::is_regular_file(entry.status()) || entry.path().extension() != ".tif")
-			return false;
-
-		boost::regex pattern(".*" + tileName + ".*");
-		return boost::regex_match(entry.path().stem().string(), pattern);
-	});
-
-	if (result == fs::directory_iterator())
-		throw std::runtime_error("No input found in directory '" + directory + "' for tile '" + tileName + "'.");
-	return result->path();
-}
-
 void processTile(const std::string& tileName,
                  const std::string& ahn2Surface, const std::string& ahn3Surface,
                  const std::string& ahn2Terrain, const std::string& ahn3Terrain,
-                 const std::string& outputDir, const std::string& colorFile)
+                 const std::string& outputDir,
+                 const std::shared_ptr<const ColorRelief>& colorRelief,
+                 CloudTools::ThreadPool& stagePool,
+                 const OGREnvelope& resultExtent)
 {
-	// Variable for the detection of the end of initialization
-	BarReporter reporter;
-	std::string lastStatus;
-	unsigned int statusNumber = 0;
-	bool isInitialized = false;
-
 	// Process configuration
-	InMemoryProcess* process;
+	std::unique_ptr<InMemoryProcess> process;
 	if (ahn2Terrain.empty() || ahn3Terrain.empty())
-		process = new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, outputDir);
+		process.reset(new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, outputDir));
 	else
-		process = new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, ahn2Terrain, ahn3Terrain, outputDir);
-	process->progress = [&reporter, &lastStatus, &statusNumber, &isInitialized]
-		(float complete, const std::string &message)
-		{
-			if (message != lastStatus)
-			{
-				lastStatus = message;
-				++statusNumber;
-			}
-
-			// The first 3 statuses are the initialization
-			if (statusNumber < 4)
-				reporter.report(complete / 3 + (statusNumber - 1) / 3.f, message);
-			else if (!isInitialized && statusNumber == 4)
-			{
-				reporter.report(1.f);
-				isInitialized = true;
-				std::lock_guard<std::mutex> lock(initMutex);
-				isInitializing = false;
-				initCondition.notify_all();
-			}
-			return true;
-		};
-	process->colorFile = colorFile;
+		process.reset(new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, ahn2Terrain, ahn3Terrain, outputDir));
+	// Tiles are already processed concurrently and the memory estimation assumes sequential branches,
+	// the results are compressed on the worker thread as well.
+	process->concurrentBranches = false;
+	process->pool = &stagePool;
+	process->output.threadCount = 1;
+	process->colorRelief = colorRelief;
+	process->resultExtent = resultExtent;
 
 	// Execute process
-	try
-	{
-		process->execute();
-	}
-	catch(std::exception& ex)
-	{
-		std::cerr << "ERROR processing tile '" << tileName << "' " << std::endl
-			      << "ERROR: " << ex.what() << std::endl;
-
-		if (!isInitialized)
-		{
-			isInitialized = true;
-			std::lock_guard<std::mutex> lock(initMutex);
-			isInitializing = false;
-		}
-	}
-	delete process;
+	process->execute();
+}
 
-	initCondition.notify_all();
+std::size_t estimateMemory(const TileEntry& surface, int halo)
+{
+	std::size_t pixelCount = static_cast<std::size_t>(surface.rasterSizeX + 2 * halo) * (surface.rasterSizeY + 2 * halo);
+	return pixelCount * BytesPerPixel;
 }
@@ -0,0 +1,53 @@
+#include <vector>
+#include <utility>
+
+#include "CoverageExpansion.h"
+
+void CoverageExpansion::initialize()
+{
+	this->nodataValue = Coverage::NoData;
+
+	this->computation = [this](int sizeX, int sizeY)
+	{
+		// The expansion starts from the accepted pixels next to a rejected one
+		std::vector<std::pair<int, int>> frontier, next;
+		for (int j = 0; j < sizeY; ++j)
+			for (int i = 0; i < sizeX; ++i)
+				this->setTargetData(i, j, this->sourceData(i, j));
+		for (int j = 0; j < sizeY; ++j)
+			for (int i = 0; i < sizeX; ++i)
+				if (this->targetData(i, j) == Coverage::Accept &&
+				    (this->targetData(i - 1, j) == Coverage::Reject ||
+				     this->targetData(i + 1, j) == Coverage::Reject ||
+				     this->targetData(i, j - 1) == Coverage::Reject ||
+				     this->targetData(i, j + 1) == Coverage::Reject))
+					frontier.emplace_back(i, j);
+		if (this->progress)
+			this->progress(.5f, "Collecting coverage boundary");
+
+		// Breadth-first expansion over the rejected 4-neighbours,
+		// the pixels without data are never entered
+		auto expand = [this, &next](int i, int j)
+		{
+			if (this->targetData(i, j) == Coverage::Reject)
+			{
+				this->setTargetData(i, j, Coverage::Accept);
+				next.emplace_back(i, j);
+			}
+		};
+		for (unsigned int step = 0; step < distance && !frontier.empty(); ++step)
+		{
+			next.clear();
+			for (const auto& pixel : frontier)
+			{
+				expand(pixel.first - 1, pixel.second);
+				expand(pixel.first + 1, pixel.second);
+				expand(pixel.first, pixel.second - 1);
+				expand(pixel.first, pixel.second + 1);
+			}
+			frontier.swap(next);
+		}
+		if (this->progress)
+			this->progress(1.f, "Expanding coverage");
+	};
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <gdal_priv.h>
+
+#include <CloudTools.DEM/DatasetTransformation.hpp>
+#include "Coverage.h"
+
+/// <summary>
+/// Expands the accepted coverage over the rejected pixels within a distance.
+/// </summary>
+/// <remarks>
+/// The expansion is a breadth-first search from the accepted pixels over the rejected 4-neighbours,
+/// bounded by the distance, so each pixel is visited at most once regardless of the distance.
+/// The pixels without data are never entered, as with repeated 4-neighbour dilation steps.
+/// </remarks>
+class CoverageExpansion : public CloudTools::DEM::DatasetTransformation<GByte>
+{
+public:
+	/// <summary>
+	/// The maximal distance of the expansion in steps between 4-neighbours.
+	/// </summary>
+	unsigned int distance;
+
+	/// <summary>
+	/// Initializes a new instance of the class. Loads input metadata and defines computation.
+	/// </summary>
+	/// <remarks>
+	/// Target is in memory raster and can be retrieved by <see cref="target()"/>.
+	/// </remarks>
+	/// <param name="sourceDataset">The coverage dataset to expand.</param>
+	/// <param name="distance">The maximal distance of the expansion in steps between 4-neighbours.</param>
+	/// <param name="progress">The callback method to report progress.</param>
+	CoverageExpansion(GDALDataset* sourceDataset,
+	                  unsigned int distance,
+	                  CloudTools::Operation::ProgressType progress = nullptr)
+		: CloudTools::DEM::DatasetTransformation<GByte>({ sourceDataset }, nullptr, progress),
+		  distance(distance)
+	{
+		initialize();
+	}
+
+	CoverageExpansion(const CoverageExpansion&) = delete;
+	CoverageExpansion& operator=(const CoverageExpansion&) = delete;
+
+private:
+	/// <summary>
+	/// Initializes the new instance of the class.
+	/// </summary>
+	void initialize();
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+/// <summary>
+/// Represents the approved and rejected AHN altimetry changes of a verification.
+/// </summary>
+struct Verification
+{
+	/// <summary>
+	/// The number of approved and rejected changed pixels.
+	/// </summary>
+	unsigned long approvedCount = 0,
+	              rejectedCount = 0;
+	/// <summary>
+	/// The cumulative absolute altimetry change of the approved and rejected pixels.
+	/// </summary>
+	double approvedSum = 0,
+	       rejectedSum = 0;
+
+	/// <summary>
+	/// Adds the changes of another verification.
+	/// </summary>
+	Verification& operator+=(const Verification& other)
+	{
+		approvedCount += other.approvedCount;
+		rejectedCount += other.rejectedCount;
+		approvedSum += other.approvedSum;
+		rejectedSum += other.rejectedSum;
+		return *this;
+	}
+};
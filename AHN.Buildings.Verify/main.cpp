@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <algorithm>
 #include <chrono>
 #include <ctime>
@@ -16,11 +17,14 @@
 
 #include <CloudTools.Common/IO/IO.h>
 #include <CloudTools.Common/IO/Reporter.h>
+#include <CloudTools.Common/IO/TileCatalog.h>
 #include <CloudTools.DEM/Metadata.h>
 #include <CloudTools.DEM/Rasterize.h>
-#include <CloudTools.DEM/SweepLineCalculation.hpp>
+#include <CloudTools.DEM/SweepLineReduction.hpp>
 #include <CloudTools.DEM/SweepLineTransformation.hpp>
 #include "Coverage.h"
+#include "CoverageExpansion.h"
+#include "Verification.h"
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
@@ -41,6 +45,7 @@ int main(int argc, char* argv[]) try
 	std::vector<std::string> dirLayers;
 
 	unsigned int coverageExpansion = 2;
+	std::string catalogDir;
 
 	// Read console arguments
 	po::options_description desc("Allowed options");
@@ -61,6 +66,8 @@ int main(int argc, char* argv[]) try
 			"layer name for reference directories")
 		("coverage-expansion", po::value<unsigned int>(&coverageExpansion)->default_value(coverageExpansion),
 			"expansion of coverage in meters for overlay correction")
+		("catalog-dir", po::value<std::string>(&catalogDir),
+			"directory to persist the catalogs of the reference directories in")
 		("help,h", "produce help message")
 		;
 
@@ -127,14 +134,16 @@ int main(int argc, char* argv[]) try
 
 	BarReporter reporter;
 	GDALAllRegister();
-	unsigned long approvedBasicCount = 0,
-		          rejectedBasicCount = 0,
-		          approvedCorrectedCount = 0,
-		          rejectedCorrectedCount = 0;
-	double approvedBasicSum = 0,
-		   rejectedBasicSum = 0,
-		   approvedCorrectedSum = 0,
-		   rejectedCorrectedSum = 0;
+	Verification basic, corrected;
+
+	// Catalog reference directories
+	std::vector<std::unique_ptr<TileCatalog>> referenceCatalogs;
+	for (unsigned int i = 0; i < dirReferences.size(); ++i)
+		referenceCatalogs.emplace_back(new TileCatalog(dirReferences[i],
+			dirPatterns.size() > i ? dirPatterns[i] : ".*",
+			std::string(), TileCatalog::VectorExtent,
+			dirLayers.size() > i ? dirLayers[i] : std::string(),
+			catalogDir));
 
 	// For each AHN tile
 	boost::regex ahnRegex(ahnPattern);
@@ -162,46 +171,18 @@ int main(int argc, char* argv[]) try
 					listLayers.push_back(std::string());
 			}
 
-			// Look for files in reference directories
-			for (unsigned int i = 0; i < dirReferences.size(); ++i)
+			// Look for files in reference directories overlapping with AHN tile
+			for (unsigned int i = 0; i < referenceCatalogs.size(); ++i)
 			{
-				boost::regex referenceRegex(".*");
-				if (dirPatterns.size() > i)
-					referenceRegex.assign(dirPatterns[i]);
-
-				for (fs::directory_iterator referenceFile(dirReferences[i]);
-					referenceFile != fs::directory_iterator();
-					++referenceFile)
+				for (const TileEntry* reference : referenceCatalogs[i]->overlapping(
+					ahnMetadata.originX(), ahnMetadata.originY() - ahnMetadata.extentY(),
+					ahnMetadata.originX() + ahnMetadata.extentX(), ahnMetadata.originY()))
 				{
-					if (fs::is_regular_file(referenceFile->status()) &&
-						boost::regex_match(referenceFile->path().filename().string(), referenceRegex))
-					{
-						// Open reference file and read metadata
-						GDALDataset* referenceDataset = static_cast<GDALDataset*>(GDALOpenEx(referenceFile->path().string().c_str(), GDAL_OF_VECTOR | GDAL_OF_READONLY, nullptr, nullptr, nullptr));
-						if (referenceDataset == nullptr)
-							throw std::runtime_error("Error at opening a reference file.");
-						
-						try
-						{
-							VectorMetadata referenceMetadata(referenceDataset, dirLayers.size() > i ? std::vector<std::string> { dirLayers[i] } : std::vector<std::string>{});
-
-							// Add to list if overlapping with AHN tile
-							if (referenceMetadata.isOverlapping(ahnMetadata))
-							{
-								listReferences.push_back(referenceFile->path().string());
-								if (dirLayers.size() > i)
-									listLayers.push_back(dirLayers[i]);
-								else
-									listLayers.push_back(std::string());
-							}
-						}
-						catch (std::invalid_argument&)
-						{
-							// specified layer not available
-						}
-
-						GDALClose(referenceDataset);
-					}
+					listReferences.push_back(reference->path);
+					if (dirLayers.size() > i)
+						listLayers.push_back(dirLayers[i]);
+					else
+						listLayers.push_back(std::string());
 				}
 			}
 
@@ -215,7 +196,7 @@ int main(int argc, char* argv[]) try
 				{"correctedBinarization", listReferences.size() + 1},
 				{"correctedCoverage", listReferences.size() + 2},
 				{"correctedExpansion", listReferences.size() + 3},
-				{"correctedCalculation", listReferences.size() + 3 + 2 * coverageExpansion},
+				{"correctedCalculation", listReferences.size() + 4},
 			};
 			std::size_t computationSteps = std::max_element(computationMark.begin(), computationMark.end(),
 				[](const std::map<std::string, std::size_t>::value_type& a, const std::map<std::string, std::size_t>::value_type& b)
@@ -273,9 +254,8 @@ int main(int argc, char* argv[]) try
 #pragma region Basic AHN altimetry change location verification
 			{
 				// Operation definition
-				SweepLineCalculation<float> verification(sources, 0,
-					[&approvedBasicCount, &rejectedBasicCount, &approvedBasicSum, &rejectedBasicSum]
-				(int x, int y, const std::vector<Window<float>>& data)
+				SweepLineReduction<float, Verification> verification(sources, 0, Verification(),
+					[](int x, int y, const std::vector<Window<float>>& data, Verification& state)
 				{
 					const auto& ahn = data[0];
 					if (!ahn.hasData()) return;
@@ -283,12 +263,16 @@ int main(int argc, char* argv[]) try
 					for (int i = 1; i < data.size(); ++i)
 						if (data[i].hasData())
 						{
-							++approvedBasicCount;
-							approvedBasicSum += std::abs(ahn.data());
+							++state.approvedCount;
+							state.approvedSum += std::abs(ahn.data());
 							return;
 						}
-					++rejectedBasicCount;
-					rejectedBasicSum += std::abs(ahn.data());
+					++state.rejectedCount;
+					state.rejectedSum += std::abs(ahn.data());
+				},
+					[](Verification& target, const Verification& source)
+				{
+					target += source;
 				},
 					[&reporter, &computationMark, computationSteps](float complete, const std::string &message)
 				{
@@ -299,6 +283,7 @@ int main(int argc, char* argv[]) try
 
 				// Execute operation
 				verification.execute();
+				basic += verification.result();
 			}
 #pragma endregion
 
@@ -352,54 +337,28 @@ int main(int argc, char* argv[]) try
 				ahnCoverage = coverage.target();
 			}
 
-			// Iterative coverage expansion
-			unsigned int iterations = 0;
-			for(; iterations < 2 * coverageExpansion; ++iterations)
+			// Coverage expansion by distance transformation
+			if (coverageExpansion > 0)
 			{
-				unsigned int change = 0;
-				SweepLineTransformation<GByte> expansion({ ahnCoverage }, 1, 
-					[&change](int x, int y, const std::vector<Window<GByte>>& data)
-				{
-					const auto& coverage = data[0];
-					if (!coverage.hasData()) return Coverage::NoData;
-
-					if(coverage.data() == Coverage::Reject)
-					{
-						if (coverage.data(-1, 0) == Coverage::Accept ||
-							coverage.data(1, 0)  == Coverage::Accept ||
-							coverage.data(0, -1) == Coverage::Accept ||
-							coverage.data(0, 1)  == Coverage::Accept)
-						{
-							++change;
-							return Coverage::Accept;
-						}
-						else
-							return Coverage::Reject;
-					}
-					return Coverage::Accept;
-				},
-					[&reporter, &computationMark, computationSteps, iterations](float complete, const std::string &message)
+				CoverageExpansion expansion(ahnCoverage, 2 * coverageExpansion,
+					[&reporter, &computationMark, computationSteps](float complete, const std::string &message)
 				{
-					reporter.report(1.f * (computationMark["correctedExpansion"] + iterations) / computationSteps + complete / computationSteps, message);
+					reporter.report(1.f * (computationMark["correctedExpansion"]) / computationSteps + complete / computationSteps, message);
 					return true;
 				});
-				expansion.nodataValue = Coverage::NoData;
 				expansion.spatialReference = "EPSG:28992";
 
 				// Execute operation
 				expansion.execute();
 				GDALClose(ahnCoverage);
 				ahnCoverage = expansion.target();
-
-				// Break if no expansion
-				if (change == 0) break;
 			}
 
 			// Calculate corrected verification
 			{
-				SweepLineCalculation<float> calculation(std::vector<GDALDataset*>{ ahnDataset, ahnCoverage }, 0,
-					[&approvedCorrectedCount, &rejectedCorrectedCount, &approvedCorrectedSum, &rejectedCorrectedSum]
-				(int x, int y, const std::vector<Window<float>>& data)
+				SweepLineReduction<float, Verification> calculation(std::vector<GDALDataset*>{ ahnDataset, ahnCoverage }, 0,
+					Verification(),
+					[](int x, int y, const std::vector<Window<float>>& data, Verification& state)
 				{
 					const auto& ahn = data[0];
 					const auto& coverage = data[1];
@@ -407,14 +366,18 @@ int main(int argc, char* argv[]) try
 
 					if (coverage.data() == Coverage::Accept)
 					{
-						++approvedCorrectedCount;
-						approvedCorrectedSum += std::abs(ahn.data());
+						++state.approvedCount;
+						state.approvedSum += std::abs(ahn.data());
 					}
 					else
 					{
-						++rejectedCorrectedCount;
-						rejectedCorrectedSum += std::abs(ahn.data());
+						++state.rejectedCount;
+						state.rejectedSum += std::abs(ahn.data());
 					}
+				},
+					[](Verification& target, const Verification& source)
+				{
+					target += source;
 				},
 					[&reporter, &computationMark, computationSteps](float complete, const std::string &message)
 				{
@@ -425,6 +388,7 @@ int main(int argc, char* argv[]) try
 
 				// Execute operation
 				calculation.execute();
+				corrected += calculation.result();
 			}
 			reporter.report(1.f);
 #pragma endregion
@@ -444,20 +408,20 @@ int main(int argc, char* argv[]) try
 		<< "All completed!" << std::endl 
 		<< std::endl << std::fixed << std::setprecision(2)
 		<< "[Basic]" << std::endl
-		<< "Approved count: " << approvedBasicCount << std::endl
-		<< "Approved sum: " << approvedBasicSum << std::endl
-		<< "Rejected count: " << rejectedBasicCount << std::endl
-		<< "Rejected sum: " << rejectedBasicSum<< std::endl
-		<< "Ratio by count: " << ((100.f * approvedBasicCount) / (approvedBasicCount + rejectedBasicCount)) << "%" << std::endl
-		<< "Ratio by sum: " << ((100.f * approvedBasicSum) / (approvedBasicSum + rejectedBasicSum)) << "%" << std::endl
+		<< "Approved count: " << basic.approvedCount << std::endl
+		<< "Approved sum: " << basic.approvedSum << std::endl
+		<< "Rejected count: " << basic.rejectedCount << std::endl
+		<< "Rejected sum: " << basic.rejectedSum<< std::endl
+		<< "Ratio by count: " << ((100.f * basic.approvedCount) / (basic.approvedCount + basic.rejectedCount)) << "%" << std::endl
+		<< "Ratio by sum: " << ((100.f * basic.approvedSum) / (basic.approvedSum + basic.rejectedSum)) << "%" << std::endl
 		<< std::endl
 		<< "[Corrected]" << std::endl
-		<< "Approved count: " << approvedCorrectedCount << std::endl
-		<< "Approved sum: " << approvedCorrectedSum << std::endl
-		<< "Rejected count: " << rejectedCorrectedCount << std::endl
-		<< "Rejected sum: " << rejectedCorrectedSum << std::endl
-		<< "Ratio by count: " << ((100.f * approvedCorrectedCount) / (approvedCorrectedCount + rejectedCorrectedCount)) << "%" << std::endl
-		<< "Ratio by sum: " << ((100.f * approvedCorrectedSum) / (approvedCorrectedSum + rejectedCorrectedSum)) << "%" << std::endl;
+		<< "Approved count: " << corrected.approvedCount << std::endl
+		<< "Approved sum: " << corrected.approvedSum << std::endl
+		<< "Rejected count: " << corrected.rejectedCount << std::endl
+		<< "Rejected sum: " << corrected.rejectedSum << std::endl
+		<< "Ratio by count: " << ((100.f * corrected.approvedCount) / (corrected.approvedCount + corrected.rejectedCount)) << "%" << std::endl
+		<< "Ratio by sum: " << ((100.f * corrected.approvedSum) / (corrected.approvedSum + corrected.rejectedSum)) << "%" << std::endl;
 
 	// Execution time measurement
 	std::clock_t clockEnd = std::clock();
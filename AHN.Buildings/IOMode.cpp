@@ -24,6 +24,8 @@ std::istream& operator >> (std::istream& input, IOMode &mode)
 		mode = IOMode::Stream;
 	else if (str == "HADOOP")
 		mode = IOMode::Hadoop;
+	else if (str == "RECORDS")
+		mode = IOMode::Records;
 	else
 		mode = IOMode::Unknown;
 	return input;
@@ -45,6 +47,9 @@ std::ostream& operator<< (std::ostream& output, const IOMode &mode)
 	case IOMode::Hadoop:
 		output << "HADOOP";
 		break;
+	case IOMode::Records:
+		output << "RECORDS";
+		break;
 	default:
 		output << "UNKNOWN";
 	}
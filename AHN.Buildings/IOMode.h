@@ -8,11 +8,12 @@ namespace Buildings
 {
 enum class IOMode
 {
-	Unknown = 0,  // 0000
-	Files   = 1,  // 0001
-	Memory  = 2,  // 0010
-	Stream  = 6,  // 0110
-	Hadoop  = 14, // 1110
+	Unknown = 0,  // 00000
+	Files   = 1,  // 00001
+	Memory  = 2,  // 00010
+	Stream  = 6,  // 00110
+	Hadoop  = 14, // 01110
+	Records = 30, // 11110
 };
 
 using Internal = std::underlying_type<IOMode>::type;
@@ -1,8 +1,10 @@
-#include <iosfwd>
+#include <cstdio>
+#include <cctype>
 #include <vector>
+#include <memory>
 #include <functional>
-#include <iterator>
 #include <utility>
+#include <mutex>
 #include <stdexcept>
 
 #ifdef _MSC_VER
@@ -11,8 +13,8 @@
 #include <io.h>
 #endif
 
-#include <gdal_utils.h>
-
+#include <CloudTools.Common/OperationGraph.h>
+#include <CloudTools.Common/IO/IO.h>
 #include <CloudTools.Common/IO/Reporter.h>
 #include <CloudTools.DEM/SweepLineTransformation.hpp>
 #include <CloudTools.DEM/Filters/NoiseFilter.hpp>
@@ -69,42 +71,78 @@ void Process::onPrepare()
 
 void Process::onExecute()
 {
-	// Building filtering / extraction
-	newResult("buildings-ahn2");
-	newResult("buildings-ahn3");
-	if (_ahn2TerrainDataset && _ahn3TerrainDataset)
+	bool isSegmentation = !(_ahn2TerrainDataset && _ahn3TerrainDataset);
+	bool isConcurrent = concurrentBranches && !hasSharedSources();
+
+	// The stages form a dependency graph, only the AHN-2 and AHN-3 branches are independent.
+	std::unique_ptr<OperationGraph> graph(pool != nullptr
+		? new OperationGraph(*pool)
+		: new OperationGraph(isConcurrent ? 2 : 1));
+
+	// While the branches are executed concurrently, their progress is reported as their average.
+	std::string branchMessage = isSegmentation ? "Building segmentation" : "Building extraction";
+	std::mutex progressMutex;
+	float completes[2] = { 0.f, 0.f };
+	auto branchProgress = [&](int branch) -> ProgressType
 	{
-		_progressMessage = "Building extraction / AHN-2";
+		if (!_progress || !isConcurrent)
+			return _progress;
+		return [&, branch](float complete, const std::string&)
 		{
-			BuildingExtraction extraction(_ahn2SurfaceDataset, _ahn2TerrainDataset,
-				result("buildings-ahn2").path(), _progress);
-			if (_ahn2SurfaceDataset == _ahn2TerrainDataset)
-				extraction.bands = { 1, 2 };
-			configure(extraction);
-
-			extraction.execute();
-			result("buildings-ahn2").dataset = extraction.target();
-		}
+			std::lock_guard<std::mutex> lock(progressMutex);
+			completes[branch] = complete;
+			return _progress((completes[0] + completes[1]) / 2, std::string());
+		};
+	};
+	auto startBranch = [&](const std::string& epoch)
+	{
+		std::lock_guard<std::mutex> lock(progressMutex);
+		_progressMessage = branchMessage + " / " + (isConcurrent ? "AHN-2 & AHN-3" : epoch);
+	};
 
-		_progressMessage = "Building extraction / AHN-3";
-		{
-			BuildingExtraction extraction(_ahn3SurfaceDataset, _ahn3TerrainDataset,
-				result("buildings-ahn3").path(), _progress);
-			if (_ahn3SurfaceDataset == _ahn3TerrainDataset)
-				extraction.bands = { 1, 2 };
-			if (_ahn2SurfaceDataset == _ahn3SurfaceDataset)
-				extraction.bands = { 3, 4 };
-			configure(extraction);
-
-			extraction.execute();
-			result("buildings-ahn3").dataset = extraction.target();
-		}
+	// Building filtering / extraction
+	if (!isSegmentation)
+	{
+		graph->addNode("buildings-ahn2", { "sources" }, { "buildings-ahn2" },
+			[&]()
+			{
+				startBranch("AHN-2");
+				newResult("buildings-ahn2");
+				BuildingExtraction extraction(_ahn2SurfaceDataset, _ahn2TerrainDataset,
+					result("buildings-ahn2").path(), branchProgress(0));
+				if (_ahn2SurfaceDataset == _ahn2TerrainDataset)
+					extraction.bands = { 1, 2 };
+				configure(extraction);
+
+				extraction.execute();
+				result("buildings-ahn2").dataset = extraction.target();
+			});
+
+		graph->addNode("buildings-ahn3",
+			isConcurrent ? std::vector<std::string>{ "sources" } : std::vector<std::string>{ "sources", "buildings-ahn2" },
+			{ "buildings-ahn3" },
+			[&]()
+			{
+				startBranch("AHN-3");
+				newResult("buildings-ahn3");
+				BuildingExtraction extraction(_ahn3SurfaceDataset, _ahn3TerrainDataset,
+					result("buildings-ahn3").path(), branchProgress(1));
+				if (_ahn3SurfaceDataset == _ahn3TerrainDataset)
+					extraction.bands = { 1, 2 };
+				if (_ahn2SurfaceDataset == _ahn3SurfaceDataset)
+					extraction.bands = { 3, 4 };
+				configure(extraction);
+
+				extraction.execute();
+				result("buildings-ahn3").dataset = extraction.target();
+			});
 	}
 	else
 	{
-		_progressMessage = "Building segmentation / AHN-2";
+		auto segmentation = [this](GDALDataset* surfaceDataset, const std::string& resultName, ProgressType progress)
 		{
-			ContourDetection cd(_ahn2SurfaceDataset, _progress);
+			newResult(resultName);
+			ContourDetection cd(surfaceDataset, progress);
 			cd.execute();
 
 			ContourFiltering cf(cd.getContours());
@@ -119,79 +157,170 @@ void Process::onExecute()
 			ContourClassification cc(cs2.getContours());
 			cc.execute();
 
-			ContourConvexHullRasterizer cr(_ahn2SurfaceDataset, cc.getContours(), result("buildings-ahn2").path(), _progress);
+			ContourConvexHullRasterizer cr(surfaceDataset, cc.getContours(), result(resultName).path(), progress);
 			configure(cr);
 			cr.execute();
-			result("buildings-ahn2").dataset = cr.target();
-		}
+			result(resultName).dataset = cr.target();
+		};
+
+		graph->addNode("buildings-ahn2", { "sources" }, { "buildings-ahn2" },
+			[&, segmentation]()
+			{
+				startBranch("AHN-2");
+				segmentation(_ahn2SurfaceDataset, "buildings-ahn2", branchProgress(0));
+			});
+
+		graph->addNode("buildings-ahn3",
+			isConcurrent ? std::vector<std::string>{ "sources" } : std::vector<std::string>{ "sources", "buildings-ahn2" },
+			{ "buildings-ahn3" },
+			[&, segmentation]()
+			{
+				startBranch("AHN-3");
+				segmentation(_ahn3SurfaceDataset, "buildings-ahn3", branchProgress(1));
+			});
+
+		graph->addNode("changes", { "sources", "buildings-ahn2", "buildings-ahn3" }, { "changes" },
+			[this]()
+			{
+				_progressMessage = "Segmentation based change detection";
+				newResult("changes");
+				BuildingChangeDetection comp(result("buildings-ahn2").dataset, result("buildings-ahn3").dataset,
+				                             _ahn2SurfaceDataset, _ahn3SurfaceDataset,
+				                             result("changes").path(), _progress);
+				configure(comp);
+				comp.execute();
+				result("changes").dataset = comp.target();
+			});
+
+		graph->addNode("segmented", { "changes" }, { "segmented" },
+			[this]()
+			{
+				_progressMessage = "Writing results";
+				writeResult("segmented", result("changes").dataset);
+			});
+	}
 
-		_progressMessage = "Building segmentation / AHN-3";
+	// Create basic changeset
+	// (The segmentation based change detection reads the same source datasets, therefore it must precede.)
+	std::vector<std::string> changesetInputs = { "sources", "buildings-ahn2", "buildings-ahn3" };
+	if (isSegmentation)
+		changesetInputs.push_back("segmented");
+	graph->addNode("changeset", changesetInputs, { "changeset" },
+		[this]()
 		{
-			ContourDetection cd(_ahn3SurfaceDataset, _progress);
-			cd.execute();
+			_progressMessage = "Creating changeset";
+			newResult("changeset");
+			Comparison comparison(_ahn2SurfaceDataset, _ahn3SurfaceDataset,
+			                      result("buildings-ahn2").dataset, result("buildings-ahn3").dataset,
+			                      result("changeset").path(), _progress);
+			comparison.minimumThreshold = 1.f;
+			comparison.spatialReference = "EPSG:28992"; // The SRS is given slightly differently for some AHN-2 tiles (but not all).
+			if (_ahn2TerrainDataset && _ahn3TerrainDataset &&
+				_ahn2SurfaceDataset == _ahn3SurfaceDataset)
+				comparison.bands = { 1, 3 };
+			configure(comparison);
+
+			comparison.execute();
+			result("changeset").dataset = comparison.target();
+		});
 
-			ContourFiltering cf(cd.getContours());
-			cf.execute();
-
-			ContourSplitting cs(cf.getContours());
-			cs.execute();
-
-			ContourSimplification cs2(cs.getContours());
-			cs2.execute();
-
-			ContourClassification cc(cs2.getContours());
-			cc.execute();
+	// Noise filtering
+	graph->addNode("noise", { "changeset" }, { "noise" },
+		[this]()
+		{
+			_progressMessage = "Noise filtering";
+			newResult("noise");
+			NoiseFilter<float> filter(result("changeset").dataset, result("noise").path(), 2, _progress);
+			configure(filter);
 
-			ContourConvexHullRasterizer cr(_ahn3SurfaceDataset, cc.getContours(), result("buildings-ahn3").path(), _progress);
-			configure(cr);
-			cr.execute();
-			result("buildings-ahn3").dataset = cr.target();
-		}
+			filter.execute();
+			result("noise").dataset = filter.target();
+		});
 
-		_progressMessage = "Segmentation based change detection";
-		newResult("changes");
+	// Cluster filtering
+	graph->addNode("cluster", { "noise" }, { "cluster" },
+		[this]()
 		{
-			BuildingChangeDetection comp(result("buildings-ahn2").dataset, result("buildings-ahn3").dataset,
-				                         _ahn2SurfaceDataset, _ahn3SurfaceDataset,
-				                         result("changes").path(), _progress);
-			configure(comp);
-			comp.execute();
-			result("changes").dataset = comp.target();
-		}
-
-		_progressMessage = "Writing results";
-		newResult("segmented", true);
+			_progressMessage = "Cluster filtering";
+			newResult("sieve");
+			newResult("cluster");
+			{
+				ClusterFilter<float> filter(result("noise").dataset, result("sieve").path(), result("cluster").path(), _progress);
+				filter.nodataValue = 0;
+				configure(filter);
+
+				filter.execute();
+				result("sieve").dataset = filter.filter();
+				result("cluster").dataset = filter.target();
+			}
+			deleteResult("sieve");
+		});
+
+	// Morpohology dilation
+	graph->addNode("dilation", { "cluster" }, { "dilation" },
+		[this]()
 		{
-			// GTiff creation options
-			char** params = nullptr;
-			params = CSLSetNameValue(params, "COMPRESS", "DEFLATE");
-
-			// Copy results to disk or VSI
-			GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
-			result("segmented").dataset = driver->CreateCopy(result("segmented").path().c_str(), result("changes").dataset,
-				                                             false, params, gdalProgress, static_cast<void*>(this));
-			CSLDestroy(params);
-		}
-		deleteResult("changes");
-	}
+			_progressMessage = "Morpohology dilation";
+			newResult("dilation");
+			MorphologyFilter<float> filter(result("cluster").dataset, result("dilation").path(), MorphologyFilter<float>::Dilation, _progress);
+			configure(filter);
 
-	// Create basic changeset
-	_progressMessage = "Creating changeset";
-	newResult("changeset");
+			filter.execute();
+			result("dilation").dataset = filter.target();
+		});
+
+	// Majority filtering
+	for (int range = 1; range <= 2; ++range)
 	{
-		Comparison comparison(_ahn2SurfaceDataset, _ahn3SurfaceDataset,
-			                  result("buildings-ahn2").dataset, result("buildings-ahn3").dataset,
-			                  result("changeset").path(), _progress);
-		comparison.minimumThreshold = 1.f;
-		comparison.spatialReference = "EPSG:28992"; // The SRS is given slightly differently for some AHN-2 tiles (but not all).
-		if (_ahn2TerrainDataset && _ahn3TerrainDataset &&
-			_ahn2SurfaceDataset == _ahn3SurfaceDataset)
-			comparison.bands = { 1, 3 };
-		configure(comparison);
-
-		comparison.execute();
-		result("changeset").dataset = comparison.target();
+		std::string input = range == 1 ? "dilation" : "majority-" + std::to_string(range - 1);
+		std::string output = "majority-" + std::to_string(range);
+		graph->addNode(output, { input }, { output },
+			[this, range]()
+			{
+				_progressMessage = "Majority filtering / r=" + std::to_string(range);
+				std::size_t index = newResult("majority");
+				MajorityFilter<float> filter(
+					index == 0 ? result("dilation").dataset : result("majority", 0).dataset,
+					result("majority", index).path(),
+					range, _progress);
+				configure(filter);
+
+				filter.execute();
+				result("majority", index).dataset = filter.target();
+			});
 	}
+
+	// Write out the results
+	graph->addNode("result", { "majority-2" }, { "result" },
+		[this]()
+		{
+			_progressMessage = "Writing results";
+			writeResult(std::string(), result("majority").dataset);
+		});
+
+	// Intermediate results are released after their last consumer
+	graph->setRelease("sources", [this]() { closeSources(); });
+	for (const char* name : { "buildings-ahn2", "buildings-ahn3", "changes", "changeset", "noise", "cluster", "dilation" })
+		graph->setRelease(name, [this, name]() { deleteResult(name); });
+	// The earlier majority result is always the first one with the same name
+	graph->setRelease("majority-1", [this]() { deleteResult("majority", 0); });
+	graph->setRelease("majority-2", [this]() { deleteResult("majority", 0); });
+
+	graph->execute();
+	_criticalPath = graph->criticalPath();
+	_criticalPathDuration = graph->criticalPathDuration();
+}
+
+bool Process::hasSharedSources() const
+{
+	return _ahn2SurfaceDataset == _ahn3SurfaceDataset ||
+	       _ahn2SurfaceDataset == _ahn3TerrainDataset ||
+	       (_ahn2TerrainDataset && (_ahn2TerrainDataset == _ahn3SurfaceDataset ||
+	                                _ahn2TerrainDataset == _ahn3TerrainDataset));
+}
+
+void Process::closeSources()
+{
 	GDALClose(_ahn2SurfaceDataset);
 	if (_ahn3SurfaceDataset != _ahn2SurfaceDataset)
 		GDALClose(_ahn3SurfaceDataset);
@@ -203,85 +332,29 @@ void Process::onExecute()
 	_ahn3SurfaceDataset = nullptr;
 	_ahn2TerrainDataset = nullptr;
 	_ahn3TerrainDataset = nullptr;
-	deleteResult("buildings-ahn2");
-	deleteResult("buildings-ahn3");
-
-	// Noise filtering
-	_progressMessage = "Noise filtering";
-	newResult("noise");
-	{
-		NoiseFilter<float> filter(result("changeset").dataset, result("noise").path(), 2, _progress);
-		configure(filter);
-
-		filter.execute();
-		result("noise").dataset = filter.target();
-	}
-	deleteResult("changeset");
-
-	// Cluster filtering
-	_progressMessage = "Cluster filtering";
-	newResult("sieve");
-	newResult("cluster");
-	{
-		ClusterFilter<float> filter(result("noise").dataset, result("sieve").path(), result("cluster").path(), _progress);
-		filter.nodataValue = 0;
-		configure(filter);
-
-		filter.execute();
-		result("sieve").dataset = filter.filter();
-		result("cluster").dataset = filter.target();
-	}
-	deleteResult("noise");
-	deleteResult("sieve");
-
-	// Morpohology dilation
-	_progressMessage = "Morpohology dilation";
-	newResult("dilation");
-	{
-		MorphologyFilter<float> filter(result("cluster").dataset, result("dilation").path(), MorphologyFilter<float>::Dilation, _progress);
-		configure(filter);
+}
 
-		filter.execute();
-		result("dilation").dataset = filter.target();
-	}
-	deleteResult("cluster");
+void Process::writeResult(const std::string& name, GDALDataset* source)
+{
+	newResult(name, true);
 
-	// Majority filtering
-	for (int range = 1; range <= 2; ++range)
+	// Copy results to disk or VSI
+	if (!resultExtent.IsInit())
 	{
-		_progressMessage = "Majority filtering / r=" + std::to_string(range);
-		std::size_t index = newResult("majority");
-		{
-			MajorityFilter<float> filter(
-				index == 0 ? result("dilation").dataset : result("majority", 0).dataset,
-				result("majority", index).path(),
-				range, _progress);
-			configure(filter);
-
-			filter.execute();
-			result("majority", index).dataset = filter.target();
-		}
-		if (index == 0)
-			deleteResult("dilation");
-		else
-			deleteResult("majority", 0);
+		result(name).dataset = output.write(source, result(name).path(),
+		                                    gdalProgress, static_cast<void*>(this));
+		return;
 	}
 
-	// Write out the results
-	_progressMessage = "Writing results";
-	newResult(std::string(), true);
+	// Crop the halo and copy results to disk or VSI
+	std::vector<std::string> arguments =
 	{
-		// GTiff creation options
-		char** params = nullptr;
-		params = CSLSetNameValue(params, "COMPRESS", "DEFLATE");
-
-		// Copy results to disk or VSI
-		GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
-		result("").dataset = driver->CreateCopy(result("").path().c_str(), result("majority").dataset,
-			                                    false, params, gdalProgress, static_cast<void*>(this));
-		CSLDestroy(params);
-	}
-	deleteResult("majority");
+		"-projwin",
+		std::to_string(resultExtent.MinX), std::to_string(resultExtent.MaxY),
+		std::to_string(resultExtent.MaxX), std::to_string(resultExtent.MinY)
+	};
+	result(name).dataset = output.translate(source, result(name).path(), arguments,
+	                                        gdalProgress, static_cast<void*>(this));
 }
 
 int Process::gdalProgress(double dfComplete, const char* pszMessage, void* pProgressArg)
@@ -330,32 +403,24 @@ InMemoryProcess::InMemoryProcess(const std::string& id,
 		throw std::runtime_error("Error at opening a source file.");
 }
 
-void InMemoryProcess::onExecute()
+void InMemoryProcess::writeResult(const std::string& name, GDALDataset* source)
 {
-	Process::onExecute();
-	if (this->colorFile.empty()) return;
+	Process::writeResult(name, source);
+	if (!name.empty() || !colorRelief) return;
 
-	// Color relief
+	// Color relief from the same source, without reading back the written result
 	_progressMessage = "Color relief";
-	newResult("rgb", true);
+	GDALDataset* relief = colorRelief->render(source, 1, _progress);
+	try
+	{
+		Process::writeResult("rgb", relief);
+	}
+	catch (...)
 	{
-		char **params = nullptr;
-		params = CSLAddString(params, "-alpha");
-		params = CSLAddString(params, "-co");
-		params = CSLSetNameValue(params, "COMPRESS", "DEFLATE");
-
-		GDALDEMProcessingOptions *options = GDALDEMProcessingOptionsNew(params, nullptr);
-		GDALDEMProcessingOptionsSetProgress(options, gdalProgress, static_cast<void*>(this));
-
-		result("rgb").dataset = static_cast<GDALDataset*>(
-			GDALDEMProcessing(
-				result("rgb").path().c_str(), result("").dataset,
-				"color-relief", colorFile.c_str(),
-				options, nullptr)
-			);
-		GDALDEMProcessingOptionsFree(options);
-		CSLDestroy(params);
+		GDALClose(relief);
+		throw;
 	}
+	GDALClose(relief);
 	deleteResult("rgb");
 }
 
@@ -401,6 +466,8 @@ void FileBasedProcess::configure(CloudTools::DEM::Transformation& transformation
 {
 	transformation.targetFormat = "GTiff";
 	transformation.createOptions.insert(std::make_pair("COMPRESS", "DEFLATE"));
+	transformation.createOptions.insert(std::make_pair("TILED", "YES"));
+	transformation.createOptions.insert(std::make_pair("NUM_THREADS", "ALL_CPUS"));
 }
 
 #pragma endregion
@@ -417,10 +484,6 @@ StreamedProcess::~StreamedProcess()
 		VSIFCloseL(_streamInputFile);
 		VSIUnlink(StreamInputPath);
 	}
-	if (_buffer)
-	{
-		delete _buffer;
-	}
 }
 
 void StreamedProcess::onPrepare()
@@ -430,13 +493,15 @@ void StreamedProcess::onPrepare()
 	_setmode(_fileno(stdin), _O_BINARY);
 	#endif
 
-	// Read streamed input into a virtual file.
-	_buffer = new std::vector<GByte>(
-		(std::istreambuf_iterator<char>(std::cin)),
-		(std::istreambuf_iterator<char>()));
-	_streamInputFile = VSIFileFromMemBuffer(StreamInputPath, &(*_buffer)[0], _buffer->size(), false);
+	// Expose the streamed input as a virtual file without copying.
+	std::vector<GByte>& input = readInput();
+	if (input.empty())
+		throw std::runtime_error("Streamed input is empty.");
+	_streamInputFile = VSIFileFromMemBuffer(StreamInputPath, input.data(), input.size(), false);
 
 	_ahn2SurfaceDataset = static_cast<GDALDataset*>(GDALOpen(StreamInputPath, GA_ReadOnly));
+	if (_ahn2SurfaceDataset == nullptr)
+		throw std::runtime_error("Error at opening the streamed input.");
 	if (_ahn2SurfaceDataset->GetRasterCount() < 2)
 		throw std::runtime_error("Streamed data must contain at least 2 (surface DEM) bands.");
 
@@ -464,11 +529,7 @@ void StreamedProcess::onExecute()
 		VSIUnlink(StreamInputPath);
 		_streamInputFile = nullptr;
 	}
-	if (_buffer)
-	{
-		delete _buffer;
-		_buffer = nullptr;
-	}
+	std::vector<GByte>().swap(_buffer);
 
 	#ifdef _MSC_VER
 	// Prepares output binary write mode on Windows
@@ -482,10 +543,23 @@ void StreamedProcess::onExecute()
 	// Stream the output
 	vsi_l_offset length;
 	GByte* buffer = VSIGetMemFileBuffer(result("").path().c_str(), &length, false);
-	std::copy(buffer, buffer + length, std::ostream_iterator<GByte>(std::cout));
+	writeOutput(buffer, static_cast<std::size_t>(length));
 	// Do not delete buffer, as it is still owned and freed by VSI file.
 }
 
+std::vector<GByte>& StreamedProcess::readInput()
+{
+	// Read streamed input in bulk chunks.
+	CloudTools::IO::readStream(stdin, _buffer);
+	return _buffer;
+}
+
+void StreamedProcess::writeOutput(const GByte* data, std::size_t size)
+{
+	CloudTools::IO::writeStream(stdout, data, size);
+	std::fflush(stdout);
+}
+
 Result* StreamedProcess::createResult(const std::string& name, bool isFinal)
 {
 	if (isFinal)
@@ -511,14 +585,35 @@ void StreamedProcess::configure(CloudTools::DEM::Transformation& transformation)
 
 void HadoopProcess::onPrepare()
 {
-	std::cin >> _key;
-	std::cin.get(); // tabulator
-	std::cout << _key << '\t';
+	// The key is terminated by a tabulator, the binary value follows.
+	_key.clear();
+	int c;
+	while ((c = std::getc(stdin)) != EOF && std::isspace(c) && c != '\t');
+	for (; c != EOF && c != '\t'; c = std::getc(stdin))
+		_key.push_back(static_cast<char>(c));
+	if (c == EOF)
+		throw std::runtime_error("Streamed input has no key.");
+	std::fputs(_key.c_str(), stdout);
+	std::fputc('\t', stdout);
 	_id = fs::path(_key).stem().string();
 
 	StreamedProcess::onPrepare();
 }
 
+#pragma endregion
+
+#pragma region RecordProcess
+
+std::vector<GByte>& RecordProcess::readInput()
+{
+	return _stream.value();
+}
+
+void RecordProcess::writeOutput(const GByte* data, std::size_t size)
+{
+	_stream.write(_stream.key(), data, size);
+}
+
 #pragma endregion
 } // Buildings
 } // AHN
@@ -1,14 +1,20 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <memory>
 #include <stdexcept>
 
 #include <boost/filesystem.hpp>
 #include <gdal_priv.h>
 
 #include <CloudTools.Common/Operation.h>
+#include <CloudTools.Common/ThreadPool.h>
 #include <CloudTools.Common/IO/ResultCollection.h>
 #include <CloudTools.DEM/Transformation.h>
+#include <CloudTools.DEM/CogWriter.h>
+#include <CloudTools.DEM/ColorRelief.h>
+#include "RecordStream.h"
 
 namespace fs = boost::filesystem;
 
@@ -27,6 +33,38 @@ public:
 	/// </summary>
 	ProgressType progress;
 
+	/// <summary>
+	/// Execute the independent AHN-2 and AHN-3 branches concurrently.
+	/// </summary>
+	/// <remarks>
+	/// The branches are always executed sequentially when they share a source dataset,
+	/// as a GDAL dataset must not be accessed from multiple threads.
+	/// </remarks>
+	bool concurrentBranches = true;
+
+	/// <summary>
+	/// The thread pool to execute the stages on, shared between processes.
+	/// </summary>
+	/// <remarks>
+	/// A private pool is created for each execution when left <c>nullptr</c>.
+	/// The process must not be executed on a worker of the same pool.
+	/// </remarks>
+	CloudTools::ThreadPool* pool = nullptr;
+
+	/// <summary>
+	/// The extent the final results are cropped to.
+	/// </summary>
+	/// <remarks>
+	/// In mosaic mode the sources are extended with a halo from the neighbouring tiles,
+	/// which is removed from the results. No cropping is applied when left uninitialized.
+	/// </remarks>
+	OGREnvelope resultExtent;
+
+	/// <summary>
+	/// The output stage of the final results.
+	/// </summary>
+	CloudTools::DEM::CogWriter output;
+
 protected:
 	/// <summary>
 	/// Unique identifier, in most cases the name of the tile to process.
@@ -47,9 +85,30 @@ protected:
 	/// </summary>
 	std::string _progressMessage;
 
+	std::vector<std::string> _criticalPath;
+	double _criticalPathDuration = 0;
+
 public:
 	~Process();
 
+	/// <summary>
+	/// Gets the unique identifier of the process.
+	/// </summary>
+	/// <remarks>
+	/// In Hadoop streaming mode the identifier is only known after the execution.
+	/// </remarks>
+	const std::string& id() const { return _id; }
+
+	/// <summary>
+	/// Gets the stages along the critical path of the last execution.
+	/// </summary>
+	const std::vector<std::string>& criticalPath() const { return _criticalPath; }
+
+	/// <summary>
+	/// Gets the total duration of the critical path of the last execution in seconds.
+	/// </summary>
+	double criticalPathDuration() const { return _criticalPathDuration; }
+
 protected:	
 	/// <summary>
 	/// Initializes a new instance of the class.
@@ -82,6 +141,23 @@ protected:
 	/// </remarks>
 	virtual void configure(CloudTools::DEM::Transformation& transformation) const = 0;
 
+	/// <summary>
+	/// Determines whether the AHN-2 and AHN-3 branches share a source dataset.
+	/// </summary>
+	bool hasSharedSources() const;
+
+	/// <summary>
+	/// Closes the source datasets.
+	/// </summary>
+	void closeSources();
+
+	/// <summary>
+	/// Writes a final result with the <see cref="output" /> stage, cropped to the <see cref="resultExtent" />.
+	/// </summary>
+	/// <param name="name">The name of the final result.</param>
+	/// <param name="source">The dataset to write.</param>
+	virtual void writeResult(const std::string& name, GDALDataset* source);
+
 	/// <summary>
 	/// Routes the C-style GDAL progress reports to the defined reporter.
 	/// </summary>
@@ -95,13 +171,13 @@ class InMemoryProcess : public Process
 {
 public:
 	/// <summary>
-	/// Map file for color relief.
+	/// Color relief rendered from the final result.
 	/// </summary>
 	/// <remarks>
 	/// No color relief will be applied when left empty.
+	/// The color relief can be shared between processes, its color file is parsed only once.
 	/// </remarks>
-	/// <seealso href="http://www.gdal.org/gdaldem.html"/>
-	std::string colorFile;
+	std::shared_ptr<const CloudTools::DEM::ColorRelief> colorRelief;
 
 protected:	
 	/// <summary>
@@ -137,9 +213,11 @@ public:
 
 protected:
 	/// <summary>
-	/// Produces the DEM and optionally a color-relief output.
+	/// Writes a final result and for the main result optionally its color relief.
 	/// </summary>
-	void onExecute() override;
+	/// <param name="name">The name of the final result.</param>
+	/// <param name="source">The dataset to write.</param>
+	void writeResult(const std::string& name, GDALDataset* source) override;
 
 	/// <summary>
 	/// Creates a new result object.
@@ -241,7 +319,7 @@ protected:
 	/// </summary>
 	static const char* StreamInputPath;
 	VSILFILE* _streamInputFile = nullptr;
-	std::vector<GByte>* _buffer = nullptr;
+	std::vector<GByte> _buffer;
 
 	std::size_t _nextResult = 1;
 
@@ -267,6 +345,19 @@ protected:
 	/// </summary>
 	void onExecute() override;
 
+	/// <summary>
+	/// Reads the streamed input.
+	/// </summary>
+	/// <returns>The buffer containing the raster file.</returns>
+	virtual std::vector<GByte>& readInput();
+
+	/// <summary>
+	/// Writes the streamed output.
+	/// </summary>
+	/// <param name="data">The raster file of the result.</param>
+	/// <param name="size">The size of the raster file in bytes.</param>
+	virtual void writeOutput(const GByte* data, std::size_t size);
+
 	/// <summary>
 	/// Creates a new result object.
 	/// </summary>
@@ -307,5 +398,38 @@ protected:
 	/// </summary>
 	void onPrepare() override;
 };
+
+/// <summary>
+/// The AHN Building Filter operation for a record of a framed record stream.
+/// </summary>
+/// <remarks>
+/// A long-lived worker processes the records one after another with a new operation for each,
+/// sharing the input buffer and the GDAL block cache between them.
+/// </remarks>
+class RecordProcess : public StreamedProcess
+{
+protected:
+	RecordStream& _stream;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class for the current record of the stream.
+	/// </summary>
+	/// <param name="stream">The record stream, the key of its current record is the name of the tile file.</param>
+	RecordProcess(RecordStream& stream)
+		: StreamedProcess(fs::path(stream.key()).stem().string()), _stream(stream)
+	{ }
+
+protected:
+	/// <summary>
+	/// Gets the value of the current record.
+	/// </summary>
+	std::vector<GByte>& readInput() override;
+
+	/// <summary>
+	/// Writes the result as a record with the key of the input record.
+	/// </summary>
+	void writeOutput(const GByte* data, std::size_t size) override;
+};
 } // Buildings
 } // AHN
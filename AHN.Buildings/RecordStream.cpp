@@ -0,0 +1,99 @@
+#include <stdexcept>
+#include <limits>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <stdio.h>
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include <CloudTools.Common/IO/IO.h>
+#include "RecordStream.h"
+
+namespace AHN
+{
+namespace Buildings
+{
+RecordStream::RecordStream(std::FILE* input, std::FILE* output)
+	: _input(input), _output(output)
+{
+	#ifdef _MSC_VER
+	// Prepares binary read and write mode on Windows
+	_setmode(_fileno(_input), _O_BINARY);
+	_setmode(_fileno(_output), _O_BINARY);
+	#endif
+}
+
+bool RecordStream::next()
+{
+	int type = std::getc(_input);
+	if (type == EOF)
+	{
+		if (std::ferror(_input))
+			throw std::runtime_error("Error at reading the record stream.");
+		return false;
+	}
+	if (type != BytesType && type != StringType)
+		throw std::runtime_error("Unsupported key type in record " + std::to_string(_count + 1) + ".");
+
+	_key.resize(readLength());
+	if (!CloudTools::IO::readStream(_input, &_key[0], _key.size()))
+		throw std::runtime_error("Truncated key in record " + std::to_string(_count + 1) + ".");
+
+	type = std::getc(_input);
+	if (type != BytesType)
+		throw std::runtime_error("The value of record '" + _key + "' must be raw bytes.");
+
+	// Reuses the capacity of the previous record
+	_value.resize(readLength());
+	if (!CloudTools::IO::readStream(_input, _value.data(), _value.size()))
+		throw std::runtime_error("Truncated value in record '" + _key + "'.");
+
+	++_count;
+	return true;
+}
+
+void RecordStream::write(const std::string& key, const GByte* data, std::size_t size)
+{
+	writeHeader(StringType, key.size());
+	CloudTools::IO::writeStream(_output, key.data(), key.size());
+	writeHeader(BytesType, size);
+	CloudTools::IO::writeStream(_output, data, size);
+
+	// Records are flushed one by one, so the consumer can process them without waiting for the end.
+	std::fflush(_output);
+}
+
+std::size_t RecordStream::readLength()
+{
+	unsigned char bytes[4];
+	if (!CloudTools::IO::readStream(_input, bytes, sizeof(bytes)))
+		throw std::runtime_error("Truncated length in record " + std::to_string(_count + 1) + ".");
+
+	std::size_t length = (static_cast<std::size_t>(bytes[0]) << 24) |
+	                     (static_cast<std::size_t>(bytes[1]) << 16) |
+	                     (static_cast<std::size_t>(bytes[2]) << 8) |
+	                      static_cast<std::size_t>(bytes[3]);
+	if (length > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+		throw std::runtime_error("Invalid length in record " + std::to_string(_count + 1) + ".");
+	return length;
+}
+
+void RecordStream::writeHeader(int type, std::size_t length)
+{
+	if (length > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+		throw std::length_error("The record is too large for the typed bytes format.");
+
+	unsigned char bytes[5] =
+	{
+		static_cast<unsigned char>(type),
+		static_cast<unsigned char>(length >> 24),
+		static_cast<unsigned char>(length >> 16),
+		static_cast<unsigned char>(length >> 8),
+		static_cast<unsigned char>(length)
+	};
+	CloudTools::IO::writeStream(_output, bytes, sizeof(bytes));
+}
+} // Buildings
+} // AHN
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#include <gdal_priv.h>
+
+namespace AHN
+{
+namespace Buildings
+{
+/// <summary>
+/// Represents a stream of framed key-value records.
+/// </summary>
+/// <remarks>
+/// Records are encoded in the typed bytes format of Hadoop Streaming (<c>-io typedbytes</c>):
+/// each key and value is a type code byte, followed by a 4 byte big-endian length and the data.
+/// The key is the name of the tile file (string or raw bytes), the value is the raw bytes of the raster file.
+/// The value buffer is reused between records, so it is only reallocated for larger tiles.
+/// </remarks>
+class RecordStream
+{
+public:
+	/// <summary>
+	/// The type code of raw bytes.
+	/// </summary>
+	static const int BytesType = 0;
+	/// <summary>
+	/// The type code of UTF-8 strings.
+	/// </summary>
+	static const int StringType = 7;
+
+private:
+	std::FILE* _input;
+	std::FILE* _output;
+
+	std::string _key;
+	std::vector<GByte> _value;
+	std::size_t _count = 0;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class.
+	/// </summary>
+	/// <param name="input">The stream to read the records from.</param>
+	/// <param name="output">The stream to write the records to.</param>
+	RecordStream(std::FILE* input, std::FILE* output);
+
+	RecordStream(const RecordStream&) = delete;
+	RecordStream& operator=(const RecordStream&) = delete;
+
+	/// <summary>
+	/// Reads the next record.
+	/// </summary>
+	/// <returns><c>true</c> if a record was read; <c>false</c> at the end of the stream.</returns>
+	bool next();
+
+	/// <summary>
+	/// Gets the key of the current record.
+	/// </summary>
+	const std::string& key() const { return _key; }
+
+	/// <summary>
+	/// Gets the value of the current record.
+	/// </summary>
+	std::vector<GByte>& value() { return _value; }
+
+	/// <summary>
+	/// Gets the number of records read.
+	/// </summary>
+	std::size_t count() const { return _count; }
+
+	/// <summary>
+	/// Writes a record to the output.
+	/// </summary>
+	/// <param name="key">The key of the record.</param>
+	/// <param name="data">The value of the record.</param>
+	/// <param name="size">The size of the value in bytes.</param>
+	void write(const std::string& key, const GByte* data, std::size_t size);
+
+private:
+	/// <summary>
+	/// Reads a length field.
+	/// </summary>
+	std::size_t readLength();
+
+	/// <summary>
+	/// Writes a type code and a length field.
+	/// </summary>
+	void writeHeader(int type, std::size_t length);
+};
+} // Buildings
+} // AHN
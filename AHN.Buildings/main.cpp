@@ -3,15 +3,21 @@
 #include <fstream>
 #include <ctime>
 #include <chrono>
+#include <memory>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/algorithm/string/join.hpp>
 #include <gdal.h>
 
 #include <CloudTools.Common/IO/IO.h>
+#include <CloudTools.Common/Metrics.h>
+#include <CloudTools.Common/Trace.h>
 #include <CloudTools.Common/IO/Reporter.h>
+#include <CloudTools.DEM/ColorRelief.h>
 #include "IOMode.h"
 #include "Process.h"
+#include "RecordStream.h"
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
@@ -28,6 +34,10 @@ int main(int argc, char* argv[]) try
 	            ahn3Terrain;
 	std::string outputDir = fs::current_path().string();
 	std::string colorFile;
+	std::string metricsDir;
+	std::string traceFile;
+	std::string compression = "DEFLATE";
+	int compressionLevel = 0;
 	IOMode mode = IOMode::Files;
 
 	// Read console arguments
@@ -47,9 +57,20 @@ int main(int argc, char* argv[]) try
 		("color-file", po::value<std::string>(&colorFile),
 			"map file for color relief\n"
 			"ignored when streaming")
+		("compression", po::value<std::string>(&compression)->default_value(compression),
+			"compression codec of the results (e.g. DEFLATE, LZW, ZSTD, NONE)")
+		("compression-level", po::value<int>(&compressionLevel)->default_value(compressionLevel),
+			"compression level of the results\n"
+			"0 means the default of the codec")
+		("metrics-dir", po::value<std::string>(&metricsDir),
+			"directory to write the performance metrics report of the tile in (<tile>_metrics.json)\n"
+			"ignored in RECORDS mode")
+		("trace", po::value<std::string>(&traceFile),
+			"file to write the timeline of the execution in (Chrome trace format)")
 		("mode,m", po::value<IOMode>(&mode)->default_value(mode),
 			"I/O mode, supported\n"
-			"FILES, MEMORY, STREAM, HADOOP")
+			"FILES, MEMORY, STREAM, HADOOP, RECORDS\n"
+			"RECORDS processes a stream of typed bytes records (key: tile file name, value: raster file) until the end of input")
 		("debug,d", "keep intermediate results on disk after progress\n"
 					"applies only to FILES mode")
 		("quiet,q", "suppress progress output")
@@ -123,6 +144,18 @@ int main(int argc, char* argv[]) try
 		argumentError = true;
 	}
 
+	if (vm.count("metrics-dir") && !fs::is_directory(metricsDir) && !fs::create_directories(metricsDir))
+	{
+		std::cerr << "Failed to create metrics directory." << std::endl;
+		argumentError = true;
+	}
+
+	if (compressionLevel < 0)
+	{
+		std::cerr << "The compression level must be non-negative." << std::endl;
+		argumentError = true;
+	}
+
 	if (hasFlag(mode, IOMode::Memory) && vm.count("debug"))
 	{
 		std::cerr << "WARNING: debug mode has no effect with in-memory intermediate results." << std::endl;
@@ -146,8 +179,53 @@ int main(int argc, char* argv[]) try
 	std::clock_t clockStart = std::clock();
 	auto timeStart = std::chrono::high_resolution_clock::now();
 
+	if (vm.count("trace"))
+	{
+		CloudTools::Trace::start();
+		CloudTools::Trace::setThreadName("Main");
+	}
+
 	// Configure the operation
 	GDALAllRegister();
+	std::shared_ptr<const CloudTools::DEM::ColorRelief> colorRelief;
+	if (vm.count("color-file") && !hasFlag(mode, IOMode::Stream))
+		colorRelief = std::make_shared<CloudTools::DEM::ColorRelief>(colorFile);
+
+	if (mode == IOMode::Records)
+	{
+		// A single worker processes all records, the failed ones are skipped.
+		// The stages of the records are executed on the same pool.
+		RecordStream stream(stdin, stdout);
+		CloudTools::ThreadPool stagePool(2);
+		std::size_t failedCount = 0;
+		while (stream.next())
+		{
+			try
+			{
+				RecordProcess process(stream);
+				process.output.compression = compression;
+				process.output.level = compressionLevel;
+				process.pool = &stagePool;
+				process.execute();
+			}
+			catch (std::exception &ex)
+			{
+				std::cerr << "ERROR: record '" << stream.key() << "': " << ex.what() << std::endl;
+				++failedCount;
+			}
+		}
+		delete reporter;
+		if (vm.count("trace"))
+			CloudTools::Trace::writeJson(traceFile);
+
+		if (failedCount > 0)
+		{
+			std::cerr << failedCount << " of " << stream.count() << " records failed." << std::endl;
+			return UnexcpectedError;
+		}
+		return Success;
+	}
+
 	Process* process;
 	std::string lastStatus;
 
@@ -160,7 +238,7 @@ int main(int argc, char* argv[]) try
 			typedProcess = new FileBasedProcess(tileName, ahn2Surface, ahn3Surface, ahn2Terrain, ahn3Terrain, outputDir);
 		else
 			typedProcess = new FileBasedProcess(tileName, ahn2Surface, ahn3Surface, outputDir);
-		typedProcess->colorFile = colorFile;
+		typedProcess->colorRelief = colorRelief;
 		typedProcess->debug = vm.count("debug");
 		process = typedProcess;
 		break;
@@ -172,7 +250,7 @@ int main(int argc, char* argv[]) try
 			typedProcess = new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, ahn2Terrain, ahn3Terrain, outputDir);
 		else
 			typedProcess = new InMemoryProcess(tileName, ahn2Surface, ahn3Surface, outputDir);
-		typedProcess->colorFile = colorFile;
+		typedProcess->colorRelief = colorRelief;
 		process = typedProcess;
 		break;
 	}
@@ -187,6 +265,8 @@ int main(int argc, char* argv[]) try
 		std::cerr << "Unsupported I/O mode given." << std::endl;
 		return Unsupported;
 	}
+	process->output.compression = compression;
+	process->output.level = compressionLevel;
 	
 	if (!vm.count("quiet"))
 	{
@@ -205,9 +285,21 @@ int main(int argc, char* argv[]) try
 	}
 
 	// Execute operation
+	std::unique_ptr<CloudTools::MetricsRecorder> recorder;
+	if (vm.count("metrics-dir"))
+		recorder.reset(new CloudTools::MetricsRecorder(tileName));
 	process->execute();
+	if (recorder)
+	{
+		recorder->stop();
+		recorder->writeJson((fs::path(metricsDir) / (process->id() + "_metrics.json")).string());
+	}
+	std::vector<std::string> criticalPath = process->criticalPath();
+	double criticalPathDuration = process->criticalPathDuration();
 	delete process;
 	delete reporter;
+	if (vm.count("trace"))
+		CloudTools::Trace::writeJson(traceFile);
 
 	// Execution time measurement
 	std::clock_t clockEnd = std::clock();
@@ -221,6 +313,11 @@ int main(int argc, char* argv[]) try
 			<< 1.f * (clockEnd - clockStart) / CLOCKS_PER_SEC << "s" << std::endl
 			<< "Wall clock time passed: "
 			<< std::chrono::duration<float>(timeEnd - timeStart).count() << "s" << std::endl;
+		if (!criticalPath.empty())
+		{
+			out << "Critical path: " << boost::algorithm::join(criticalPath, " -> ")
+				<< " (" << criticalPathDuration << "s)" << std::endl;
+		}
 	}
 	return Success;
 }
@@ -0,0 +1,91 @@
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+#include "Allocations.h"
+
+namespace
+{
+std::atomic<std::uint64_t> allocationCount(0);
+std::atomic<std::uint64_t> allocatedBytes(0);
+
+void* allocate(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	return std::malloc(size > 0 ? size : 1);
+}
+}
+
+namespace CloudTools
+{
+namespace Benchmarks
+{
+std::uint64_t Allocations::count()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Allocations::bytes()
+{
+	return allocatedBytes.load(std::memory_order_relaxed);
+}
+} // Benchmarks
+} // CloudTools
+
+#pragma region Global allocation functions
+
+void* operator new(std::size_t size)
+{
+	void* pointer = allocate(size);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+#pragma endregion
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace CloudTools
+{
+namespace Benchmarks
+{
+/// <summary>
+/// Counts the heap allocations of the process.
+/// </summary>
+/// <remarks>
+/// The global <c>operator new</c> is replaced in the benchmark executables to maintain the counters,
+/// so only C++ allocations are counted; the <c>malloc</c> calls of GDAL and other C libraries are not.
+/// </remarks>
+struct Allocations
+{
+	/// <summary>
+	/// Gets the number of allocations since the start of the process.
+	/// </summary>
+	static std::uint64_t count();
+
+	/// <summary>
+	/// Gets the number of allocated bytes since the start of the process.
+	/// </summary>
+	static std::uint64_t bytes();
+};
+} // Benchmarks
+} // CloudTools
@@ -0,0 +1,136 @@
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <ctime>
+#include <regex>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <CloudTools.Common/IO/IO.h>
+#include "Benchmark.h"
+#include "Allocations.h"
+
+namespace CloudTools
+{
+namespace Benchmarks
+{
+#pragma region BenchmarkResult
+
+std::string BenchmarkResult::key() const
+{
+	std::string key = name;
+	for (const auto& parameter : parameters)
+		key += " " + parameter.first + "=" + parameter.second;
+	return key;
+}
+
+#pragma endregion
+
+#pragma region BenchmarkSuite
+
+void BenchmarkSuite::add(const std::string& name,
+                         const std::map<std::string, std::string>& parameters,
+                         std::uint64_t pixels,
+                         SetupType setup)
+{
+	if (!setup)
+		throw std::invalid_argument("No setup defined for the benchmark.");
+
+	Benchmark benchmark;
+	benchmark.result.name = name;
+	benchmark.result.parameters = parameters;
+	benchmark.result.pixels = pixels;
+	benchmark.setup = std::move(setup);
+	_benchmarks.push_back(std::move(benchmark));
+}
+
+std::vector<BenchmarkResult> BenchmarkSuite::run()
+{
+	if (repetitions < 1)
+		throw std::out_of_range("At least 1 repetition must be measured.");
+
+	std::regex filterRegex(filter);
+	std::vector<BenchmarkResult> results;
+	for (const Benchmark& benchmark : _benchmarks)
+	{
+		if (!std::regex_search(benchmark.result.name, filterRegex))
+			continue;
+
+		// Warm-up, e.g. for the block cache of GDAL
+		benchmark.setup()();
+
+		BenchmarkResult result = benchmark.result;
+		result.repetitions = repetitions;
+		result.minTime = std::numeric_limits<double>::max();
+		double totalTime = 0;
+		std::uint64_t totalAllocations = 0, totalBytes = 0;
+		for (int i = 0; i < repetitions; ++i)
+		{
+			TaskType task = benchmark.setup();
+
+			std::uint64_t allocations = Allocations::count();
+			std::uint64_t bytes = Allocations::bytes();
+			auto start = std::chrono::steady_clock::now();
+			task();
+			double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			totalAllocations += Allocations::count() - allocations;
+			totalBytes += Allocations::bytes() - bytes;
+
+			result.minTime = std::min(result.minTime, time);
+			totalTime += time;
+		}
+		result.meanTime = totalTime / repetitions;
+		result.allocations = totalAllocations / repetitions;
+		result.allocatedBytes = totalBytes / repetitions;
+
+		if (finished)
+			finished(result);
+		results.push_back(std::move(result));
+	}
+	return results;
+}
+
+void BenchmarkSuite::writeJson(const std::string& path, const std::vector<BenchmarkResult>& results) const
+{
+	std::time_t now = std::time(nullptr);
+	std::ofstream out(path);
+	out << std::setprecision(6)
+	    << "{\n"
+	    << "\t\"suite\": \"" << IO::escapeJson(_name) << "\",\n"
+	    << "\t\"timestamp\": \"" << std::put_time(std::gmtime(&now), "%Y-%m-%dT%H:%M:%SZ") << "\",\n"
+	    << "\t\"results\": [";
+	for (std::size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchmarkResult& result = results[i];
+		out << (i == 0 ? "\n" : ",\n")
+		    << "\t\t{\n"
+		    << "\t\t\t\"name\": \"" << IO::escapeJson(result.name) << "\",\n"
+		    << "\t\t\t\"parameters\": {";
+		bool isFirst = true;
+		for (const auto& parameter : result.parameters)
+		{
+			out << (isFirst ? " " : ", ")
+			    << "\"" << IO::escapeJson(parameter.first) << "\": \"" << IO::escapeJson(parameter.second) << "\"";
+			isFirst = false;
+		}
+		out << " },\n"
+		    << "\t\t\t\"repetitions\": " << result.repetitions << ",\n"
+		    << "\t\t\t\"pixels\": " << result.pixels << ",\n"
+		    << "\t\t\t\"minTime\": " << result.minTime << ",\n"
+		    << "\t\t\t\"meanTime\": " << result.meanTime << ",\n"
+		    << "\t\t\t\"pixelsPerSecond\": " << result.pixelsPerSecond() << ",\n"
+		    << "\t\t\t\"allocations\": " << result.allocations << ",\n"
+		    << "\t\t\t\"allocatedBytes\": " << result.allocatedBytes << "\n"
+		    << "\t\t}";
+	}
+	if (!results.empty())
+		out << "\n\t";
+	out << "]\n}" << std::endl;
+	if (!out)
+		throw std::runtime_error("Failed to write the benchmark results.");
+}
+
+#pragma endregion
+} // Benchmarks
+} // CloudTools
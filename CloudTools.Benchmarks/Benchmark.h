@@ -0,0 +1,144 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <cstdint>
+
+namespace CloudTools
+{
+namespace Benchmarks
+{
+/// <summary>
+/// Represents the measurements of a benchmark.
+/// </summary>
+struct BenchmarkResult
+{
+	/// <summary>
+	/// The name of the benchmark, e.g. <c>NoiseFilter</c>.
+	/// </summary>
+	std::string name;
+	/// <summary>
+	/// The parameters of the benchmark, e.g. the size of the input.
+	/// </summary>
+	std::map<std::string, std::string> parameters;
+
+	/// <summary>
+	/// The number of measured repetitions.
+	/// </summary>
+	int repetitions = 0;
+	/// <summary>
+	/// The number of pixels processed by a repetition.
+	/// </summary>
+	std::uint64_t pixels = 0;
+	/// <summary>
+	/// The fastest and the mean wall time of a repetition in seconds.
+	/// </summary>
+	double minTime = 0;
+	double meanTime = 0;
+	/// <summary>
+	/// The mean number of heap allocations and allocated bytes of a repetition.
+	/// </summary>
+	std::uint64_t allocations = 0;
+	std::uint64_t allocatedBytes = 0;
+
+	/// <summary>
+	/// Gets the throughput of the fastest repetition.
+	/// </summary>
+	double pixelsPerSecond() const
+	{
+		return minTime > 0 ? pixels / minTime : 0;
+	}
+
+	/// <summary>
+	/// Gets the unique key of the benchmark, composed of its name and parameters.
+	/// </summary>
+	std::string key() const;
+};
+
+/// <summary>
+/// Represents a set of benchmarks executed together.
+/// </summary>
+/// <remarks>
+/// The benchmarks are executed sequentially, each of them after a warm-up run.
+/// Only the task is measured, the preparation of its inputs is not.
+/// </remarks>
+class BenchmarkSuite
+{
+public:
+	/// <summary>
+	/// The measured task of a benchmark.
+	/// </summary>
+	typedef std::function<void()> TaskType;
+	/// <summary>
+	/// Prepares the inputs of a repetition and returns the task to measure.
+	/// </summary>
+	typedef std::function<TaskType()> SetupType;
+
+	/// <summary>
+	/// The number of measured repetitions of each benchmark.
+	/// </summary>
+	int repetitions = 5;
+
+	/// <summary>
+	/// Regular expression to select the benchmarks to run by name.
+	/// </summary>
+	std::string filter = ".*";
+
+	/// <summary>
+	/// Callback function called when a benchmark is finished.
+	/// </summary>
+	std::function<void(const BenchmarkResult& result)> finished;
+
+private:
+	struct Benchmark
+	{
+		BenchmarkResult result;
+		SetupType setup;
+	};
+
+	std::string _name;
+	std::vector<Benchmark> _benchmarks;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class.
+	/// </summary>
+	/// <param name="name">The name of the suite.</param>
+	explicit BenchmarkSuite(const std::string& name)
+		: _name(name)
+	{ }
+
+	/// <summary>
+	/// Registers a benchmark.
+	/// </summary>
+	/// <param name="name">The name of the benchmark.</param>
+	/// <param name="parameters">The parameters of the benchmark.</param>
+	/// <param name="pixels">The number of pixels processed by a repetition.</param>
+	/// <param name="setup">The preparation of a repetition.</param>
+	void add(const std::string& name,
+	         const std::map<std::string, std::string>& parameters,
+	         std::uint64_t pixels,
+	         SetupType setup);
+
+	/// <summary>
+	/// Gets the number of registered benchmarks.
+	/// </summary>
+	std::size_t size() const { return _benchmarks.size(); }
+
+	/// <summary>
+	/// Executes the benchmarks matching the filter.
+	/// </summary>
+	/// <returns>The results of the executed benchmarks.</returns>
+	std::vector<BenchmarkResult> run();
+
+	/// <summary>
+	/// Writes benchmark results into a JSON file.
+	/// </summary>
+	/// <param name="path">The path of the file.</param>
+	/// <param name="results">The results to write.</param>
+	void writeJson(const std::string& path, const std::vector<BenchmarkResult>& results) const;
+};
+} // Benchmarks
+} // CloudTools
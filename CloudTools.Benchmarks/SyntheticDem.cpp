@@ -0,0 +1,182 @@
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+
+#include "SyntheticDem.h"
+
+namespace CloudTools
+{
+namespace Benchmarks
+{
+GDALDataset* SyntheticDem::create(Model model, int epoch, const std::string& path, const std::string& format) const
+{
+	if (sizeX <= 0 || sizeY <= 0)
+		throw std::invalid_argument("The size of the model must be positive.");
+
+	std::vector<float> data(pixelCount());
+	for (int y = 0; y < sizeY; ++y)
+		for (int x = 0; x < sizeX; ++x)
+			data[static_cast<std::size_t>(y) * sizeX + x] = terrain(x, y);
+
+	if (model == Surface)
+	{
+		std::vector<Building> buildings;
+		std::vector<Tree> trees;
+		generate(epoch, buildings, trees);
+
+		// Flat roofs at the given height above the terrain at the corner of the building
+		for (const Building& building : buildings)
+		{
+			float roof = terrain(building.x, building.y) + building.elevation;
+			for (int y = building.y; y < std::min(building.y + building.height, sizeY); ++y)
+				for (int x = building.x; x < std::min(building.x + building.width, sizeX); ++x)
+				{
+					float& value = data[static_cast<std::size_t>(y) * sizeX + x];
+					value = std::max(value, roof);
+				}
+		}
+
+		// Bell-shaped crowns, covered by the higher roofs
+		for (const Tree& tree : trees)
+		{
+			int radius = static_cast<int>(std::ceil(tree.radius));
+			for (int y = std::max(tree.y - radius, 0); y <= std::min(tree.y + radius, sizeY - 1); ++y)
+				for (int x = std::max(tree.x - radius, 0); x <= std::min(tree.x + radius, sizeX - 1); ++x)
+				{
+					float distance = static_cast<float>((x - tree.x) * (x - tree.x) + (y - tree.y) * (y - tree.y));
+					if (distance > tree.radius * tree.radius)
+						continue;
+
+					float crown = terrain(x, y) + tree.elevation * std::exp(-2 * distance / (tree.radius * tree.radius));
+					float& value = data[static_cast<std::size_t>(y) * sizeX + x];
+					value = std::max(value, crown);
+				}
+		}
+	}
+
+	if (nodataRatio > 0)
+	{
+		std::mt19937 engine(seed * 31 + epoch);
+		std::bernoulli_distribution isMissing(nodataRatio);
+		for (float& value : data)
+			if (isMissing(engine))
+				value = nodataValue;
+	}
+
+	// Write the dataset
+	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName(format.c_str());
+	if (driver == nullptr)
+		throw std::invalid_argument("Target output format unrecognized.");
+
+	GDALDataset* dataset = driver->Create(path.c_str(), sizeX, sizeY, 1, GDT_Float32, nullptr);
+	if (dataset == nullptr)
+		throw std::runtime_error("Target file creation failed.");
+
+	double geoTransform[6] = { originX, pixelSize, 0, originY, 0, -pixelSize };
+	dataset->SetGeoTransform(geoTransform);
+
+	// Amersfoort / RD New, the reference system of AHN
+	OGRSpatialReference reference;
+	if (reference.importFromEPSG(28992) == OGRERR_NONE)
+	{
+		char *wkt;
+		reference.exportToWkt(&wkt);
+		dataset->SetProjection(wkt);
+		CPLFree(wkt);
+	}
+
+	GDALRasterBand* band = dataset->GetRasterBand(1);
+	band->SetNoDataValue(nodataValue);
+	if (band->RasterIO(GF_Write, 0, 0, sizeX, sizeY,
+	                   &data[0], sizeX, sizeY, GDT_Float32, 0, 0) != CE_None)
+	{
+		GDALClose(dataset);
+		throw std::runtime_error("Target write error occured.");
+	}
+	return dataset;
+}
+
+std::vector<OGRPoint> SyntheticDem::treeTops(int epoch) const
+{
+	std::vector<Building> buildings;
+	std::vector<Tree> trees;
+	generate(epoch, buildings, trees);
+
+	std::vector<OGRPoint> tops;
+	tops.reserve(trees.size());
+	for (const Tree& tree : trees)
+		tops.emplace_back(tree.x, tree.y, terrain(tree.x, tree.y) + tree.elevation);
+	return tops;
+}
+
+void SyntheticDem::generate(int epoch, std::vector<Building>& buildings, std::vector<Tree>& trees) const
+{
+	std::mt19937 engine(seed);
+	double megaPixels = pixelCount() / 1e6;
+
+	auto createBuilding = [this](std::mt19937& engine)
+	{
+		Building building;
+		building.width = std::min(std::uniform_int_distribution<int>(12, 60)(engine), sizeX);
+		building.height = std::min(std::uniform_int_distribution<int>(12, 60)(engine), sizeY);
+		building.x = std::uniform_int_distribution<int>(0, sizeX - building.width)(engine);
+		building.y = std::uniform_int_distribution<int>(0, sizeY - building.height)(engine);
+		building.elevation = std::uniform_real_distribution<float>(4, 25)(engine);
+		return building;
+	};
+
+	buildings.clear();
+	int buildingCount = static_cast<int>(std::lround(buildingDensity * megaPixels));
+	for (int i = 0; i < buildingCount; ++i)
+		buildings.push_back(createBuilding(engine));
+
+	trees.clear();
+	int treeCount = static_cast<int>(std::lround(treeDensity * megaPixels));
+	for (int i = 0; i < treeCount; ++i)
+	{
+		Tree tree;
+		tree.x = std::uniform_int_distribution<int>(0, sizeX - 1)(engine);
+		tree.y = std::uniform_int_distribution<int>(0, sizeY - 1)(engine);
+		tree.radius = std::uniform_real_distribution<float>(3, 10)(engine);
+		tree.elevation = std::uniform_real_distribution<float>(5, 20)(engine);
+		trees.push_back(tree);
+	}
+
+	if (epoch == 0)
+		return;
+
+	// Changes of the later epoch: demolished and extended buildings, new buildings and grown trees
+	std::mt19937 changeEngine(seed + 7919 * epoch);
+	std::bernoulli_distribution isChanged(changeRatio);
+	std::bernoulli_distribution isDemolished(0.5);
+	std::vector<Building> changed;
+	for (Building building : buildings)
+	{
+		if (isChanged(changeEngine))
+		{
+			if (isDemolished(changeEngine))
+				continue;
+			building.width = std::min(building.width + building.width / 2, sizeX - building.x);
+			building.elevation += 3;
+		}
+		changed.push_back(building);
+	}
+	int newCount = static_cast<int>(std::lround(buildingCount * changeRatio / 2));
+	for (int i = 0; i < newCount; ++i)
+		changed.push_back(createBuilding(changeEngine));
+	buildings.swap(changed);
+
+	std::uniform_real_distribution<float> growth(0, 1.5f);
+	for (Tree& tree : trees)
+		tree.elevation += growth(changeEngine) * epoch;
+}
+
+float SyntheticDem::terrain(int x, int y) const
+{
+	double meterX = x * pixelSize;
+	double meterY = y * pixelSize;
+	return static_cast<float>(2 + 1.5 * std::sin(meterX / 40) + std::cos(meterY / 55) + 0.5 * std::sin((meterX + meterY) / 15));
+}
+} // Benchmarks
+} // CloudTools
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <gdal_priv.h>
+#include <ogr_geometry.h>
+
+namespace CloudTools
+{
+namespace Benchmarks
+{
+/// <summary>
+/// Represents a generator of synthetic elevation models of a built-up area.
+/// </summary>
+/// <remarks>
+/// The terrain is a smooth undulating surface, the buildings are flat-roofed blocks and the trees are
+/// bell-shaped blobs on top of it. The generation is deterministic for a given seed, and later epochs
+/// differ from the first one by demolished, new and extended buildings and grown trees.
+/// </remarks>
+class SyntheticDem
+{
+public:
+	/// <summary>
+	/// The elevation model to generate.
+	/// </summary>
+	enum Model
+	{
+		/// <summary>
+		/// Digital terrain model, the bare ground.
+		/// </summary>
+		Terrain,
+		/// <summary>
+		/// Digital surface model, the ground with the buildings and the trees.
+		/// </summary>
+		Surface
+	};
+
+	/// <summary>
+	/// The number of columns.
+	/// </summary>
+	int sizeX = 1000;
+	/// <summary>
+	/// The number of rows.
+	/// </summary>
+	int sizeY = 1000;
+	/// <summary>
+	/// The size of a pixel in meters.
+	/// </summary>
+	double pixelSize = 0.5;
+	/// <summary>
+	/// The coordinates of the upper left corner.
+	/// </summary>
+	double originX = 120000, originY = 487000;
+
+	/// <summary>
+	/// The number of buildings per million pixels.
+	/// </summary>
+	double buildingDensity = 60;
+	/// <summary>
+	/// The number of trees per million pixels.
+	/// </summary>
+	double treeDensity = 300;
+	/// <summary>
+	/// The ratio of pixels without data (e.g. water surfaces), between 0 and 1.
+	/// </summary>
+	double nodataRatio = 0;
+	/// <summary>
+	/// The ratio of buildings changed between two epochs, between 0 and 1.
+	/// </summary>
+	double changeRatio = 0.1;
+	/// <summary>
+	/// The nodata value of the generated datasets.
+	/// </summary>
+	float nodataValue = -1e10f;
+	/// <summary>
+	/// The seed of the generation.
+	/// </summary>
+	unsigned int seed = 42;
+
+	/// <summary>
+	/// Generates an elevation model.
+	/// </summary>
+	/// <param name="model">The model to generate.</param>
+	/// <param name="epoch">The epoch of the model, 0 for the first one.</param>
+	/// <param name="path">The path of the dataset, ignored for in-memory datasets.</param>
+	/// <param name="format">The GDAL driver of the dataset.</param>
+	/// <returns>The generated single band <c>Float32</c> dataset, owned by the caller.</returns>
+	GDALDataset* create(Model model, int epoch = 0,
+	                    const std::string& path = std::string(),
+	                    const std::string& format = "MEM") const;
+
+	/// <summary>
+	/// Gets the tops of the trees in an epoch.
+	/// </summary>
+	/// <param name="epoch">The epoch of the model.</param>
+	/// <returns>The pixel coordinates and the elevation of the tree tops.</returns>
+	std::vector<OGRPoint> treeTops(int epoch = 0) const;
+
+	/// <summary>
+	/// Gets the number of pixels of a generated model.
+	/// </summary>
+	std::uint64_t pixelCount() const
+	{
+		return static_cast<std::uint64_t>(sizeX) * sizeY;
+	}
+
+private:
+	struct Building
+	{
+		int x, y, width, height;
+		float elevation;
+	};
+
+	struct Tree
+	{
+		int x, y;
+		float radius, elevation;
+	};
+
+	/// <summary>
+	/// Generates the objects of an epoch.
+	/// </summary>
+	void generate(int epoch, std::vector<Building>& buildings, std::vector<Tree>& trees) const;
+
+	/// <summary>
+	/// Computes the elevation of the terrain.
+	/// </summary>
+	float terrain(int x, int y) const;
+};
+} // Benchmarks
+} // CloudTools
@@ -0,0 +1,361 @@
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+#include <gdal_priv.h>
+
+#include <CloudTools.Common/IO/IO.h>
+#include <CloudTools.DEM/ClusterMap.h>
+#include <CloudTools.DEM/SweepLineTransformation.hpp>
+#include <CloudTools.DEM/Filters/NoiseFilter.hpp>
+#include <CloudTools.DEM/Filters/MajorityFilter.hpp>
+#include <CloudTools.DEM/Filters/MorphologyFilter.hpp>
+#include <CloudTools.DEM/Filters/ClusterFilter.hpp>
+#include <CloudTools.Vegetation/TreeCrownSegmentation.h>
+#include <CloudTools.Vegetation/HausdorffDistance.h>
+#include <AHN.Buildings/ContourDetection.h>
+#include <AHN.Buildings/ContourFiltering.h>
+#include <AHN.Buildings/ContourSplitting.h>
+#include <AHN.Buildings/ContourSimplification.h>
+#include <AHN.Buildings/ContourClassification.h>
+#include "Benchmark.h"
+#include "SyntheticDem.h"
+
+namespace po = boost::program_options;
+
+using namespace CloudTools::IO;
+using namespace CloudTools::DEM;
+using namespace CloudTools::Benchmarks;
+
+typedef std::shared_ptr<GDALDataset> DatasetPointer;
+
+/// <summary>
+/// Wraps a dataset into a shared pointer which closes it.
+/// </summary>
+DatasetPointer share(GDALDataset* dataset)
+{
+	return DatasetPointer(dataset, [](GDALDataset* dataset) { GDALClose(dataset); });
+}
+
+/// <summary>
+/// Registers the benchmarks of the DEM kernels and the cluster algorithms for a synthetic model.
+/// </summary>
+/// <param name="suite">The suite to register the benchmarks into.</param>
+/// <param name="dem">The generator of the synthetic model.</param>
+void addBenchmarks(BenchmarkSuite& suite, const SyntheticDem& dem);
+
+int main(int argc, char* argv[]) try
+{
+	std::vector<int> sizes = { 512, 1024 };
+	std::vector<double> nodataRatios = { 0, 0.2 };
+	int repetitions = 5;
+	unsigned int seed = 42;
+	std::string filter = ".*";
+	std::string outputFile = "benchmarks.json";
+
+	// Read console arguments
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("size", po::value<std::vector<int>>(&sizes)->multitoken()->default_value(sizes, "512 1024"),
+			"sizes of the synthetic square DEMs in pixels")
+		("nodata-ratio", po::value<std::vector<double>>(&nodataRatios)->multitoken()->default_value(nodataRatios, "0 0.2"),
+			"ratios of nodata pixels in the synthetic DEMs")
+		("repetitions", po::value<int>(&repetitions)->default_value(repetitions),
+			"number of measured repetitions of each benchmark")
+		("seed", po::value<unsigned int>(&seed)->default_value(seed),
+			"seed of the synthetic DEM generation")
+		("filter", po::value<std::string>(&filter)->default_value(filter),
+			"regular expression of the benchmark names to run")
+		("output", po::value<std::string>(&outputFile)->default_value(outputFile),
+			"JSON file to write the results in")
+		("help,h", "produce help message")
+		;
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	// Argument validation
+	if (vm.count("help"))
+	{
+		std::cout << "Measures the throughput and the allocations of the DEM kernels and cluster algorithms on synthetic DEMs." << std::endl;
+		std::cout << desc << std::endl;
+		return Success;
+	}
+
+	bool argumentError = false;
+	for (int size : sizes)
+		if (size <= 0)
+		{
+			std::cerr << "The sizes must be positive." << std::endl;
+			argumentError = true;
+			break;
+		}
+
+	for (double ratio : nodataRatios)
+		if (ratio < 0 || ratio >= 1)
+		{
+			std::cerr << "The nodata ratios must be in the [0, 1) interval." << std::endl;
+			argumentError = true;
+			break;
+		}
+
+	if (repetitions < 1)
+	{
+		std::cerr << "At least 1 repetition must be measured." << std::endl;
+		argumentError = true;
+	}
+
+	if (argumentError)
+	{
+		std::cerr << "Use the --help option for description." << std::endl;
+		return InvalidInput;
+	}
+
+	// Program
+	std::cout << "=== CloudTools Benchmarks ===" << std::endl;
+	GDALAllRegister();
+
+	BenchmarkSuite suite("kernels");
+	suite.repetitions = repetitions;
+	suite.filter = filter;
+	suite.finished = [](const BenchmarkResult& result)
+	{
+		std::cout << std::left << std::setw(56) << result.key() << std::right << std::fixed
+			<< std::setprecision(3) << std::setw(10) << result.minTime * 1000 << " ms"
+			<< std::setprecision(2) << std::setw(10) << result.pixelsPerSecond() / 1e6 << " Mpx/s"
+			<< std::setw(12) << result.allocations << " allocs" << std::endl;
+	};
+
+	for (int size : sizes)
+		for (double ratio : nodataRatios)
+		{
+			SyntheticDem dem;
+			dem.sizeX = dem.sizeY = size;
+			dem.nodataRatio = ratio;
+			dem.seed = seed;
+			addBenchmarks(suite, dem);
+		}
+
+	std::vector<BenchmarkResult> results = suite.run();
+	suite.writeJson(outputFile, results);
+	std::cout << results.size() << " benchmarks completed, results written to '" << outputFile << "'." << std::endl;
+	return Success;
+}
+catch (std::exception& ex)
+{
+	std::cerr << "ERROR: " << ex.what() << std::endl;
+	return UnexcpectedError;
+}
+
+void addBenchmarks(BenchmarkSuite& suite, const SyntheticDem& dem)
+{
+	std::map<std::string, std::string> parameters =
+	{
+		{ "size", std::to_string(dem.sizeX) + "x" + std::to_string(dem.sizeY) },
+		{ "nodata", std::to_string(dem.nodataRatio).substr(0, 4) }
+	};
+	std::uint64_t pixels = dem.pixelCount();
+
+	// The inputs are generated once and only read by the benchmarks
+	DatasetPointer surface = share(dem.create(SyntheticDem::Surface));
+
+	// Sweep line kernel
+	suite.add("SweepLineTransformation", parameters, pixels, [surface]()
+	{
+		return [surface]()
+		{
+			SweepLineTransformation<float> transformation({ surface.get() }, 1,
+				[](int x, int y, const std::vector<Window<float>>& sources)
+				{
+					const Window<float>& source = sources[0];
+					if (!source.hasData())
+						return source.data();
+
+					float sum = 0;
+					int counter = 0;
+					for (int i = -1; i <= 1; ++i)
+						for (int j = -1; j <= 1; ++j)
+							if (source.hasData(i, j))
+							{
+								sum += source.data(i, j);
+								++counter;
+							}
+					return sum / counter;
+				});
+			transformation.execute();
+		};
+	});
+
+	// Filters
+	suite.add("NoiseFilter", parameters, pixels, [surface]()
+	{
+		return [surface]()
+		{
+			NoiseFilter<float> filter(surface.get(), std::string(), 2);
+			filter.targetFormat = "MEM";
+			filter.execute();
+		};
+	});
+
+	suite.add("MajorityFilter", parameters, pixels, [surface]()
+	{
+		return [surface]()
+		{
+			MajorityFilter<float> filter(surface.get(), std::string(), 1);
+			filter.targetFormat = "MEM";
+			filter.execute();
+		};
+	});
+
+	suite.add("MorphologyFilter/Dilation", parameters, pixels, [surface]()
+	{
+		return [surface]()
+		{
+			MorphologyFilter<float> filter(surface.get(), std::string(), MorphologyFilter<float>::Dilation);
+			filter.targetFormat = "MEM";
+			filter.execute();
+		};
+	});
+
+	suite.add("MorphologyFilter/Erosion", parameters, pixels, [surface]()
+	{
+		return [surface]()
+		{
+			MorphologyFilter<float> filter(surface.get(), std::string(), MorphologyFilter<float>::Erosion);
+			filter.targetFormat = "MEM";
+			filter.execute();
+		};
+	});
+
+	suite.add("ClusterFilter", parameters, pixels, [surface]()
+	{
+		return [surface]()
+		{
+			ClusterFilter<float> filter(surface.get(), std::string(), std::string());
+			filter.targetFormat = "MEM";
+			filter.execute();
+		};
+	});
+
+	// Cluster algorithms on the tree crowns, the segmentations of both epochs are computed once
+	SyntheticDem vegetation = dem;
+	vegetation.buildingDensity = 0;
+	DatasetPointer crowns = share(vegetation.create(SyntheticDem::Surface));
+	DatasetPointer grownCrowns = share(vegetation.create(SyntheticDem::Surface, 1));
+	std::vector<OGRPoint> seeds = vegetation.treeTops();
+	std::vector<OGRPoint> grownSeeds = vegetation.treeTops(1);
+
+	// Tree crown mask: the elevation of the pixels above the terrain, 0 elsewhere
+	auto mask = std::make_shared<std::vector<float>>(vegetation.pixelCount());
+	{
+		DatasetPointer ground = share(vegetation.create(SyntheticDem::Terrain));
+		std::vector<float> elevation(vegetation.pixelCount());
+		if (crowns->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, vegetation.sizeX, vegetation.sizeY,
+		                                       &(*mask)[0], vegetation.sizeX, vegetation.sizeY, GDT_Float32, 0, 0) != CE_None ||
+		    ground->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, vegetation.sizeX, vegetation.sizeY,
+		                                       &elevation[0], vegetation.sizeX, vegetation.sizeY, GDT_Float32, 0, 0) != CE_None)
+			throw std::runtime_error("Source read error occured.");
+
+		for (std::size_t i = 0; i < mask->size(); ++i)
+			if ((*mask)[i] == vegetation.nodataValue || (*mask)[i] - elevation[i] <= 2)
+				(*mask)[i] = 0;
+	}
+
+	suite.add("ClusterMap", parameters, pixels, [mask, vegetation]()
+	{
+		return [mask, vegetation]()
+		{
+			auto isCrown = [&](int x, int y)
+			{
+				return (*mask)[static_cast<std::size_t>(y) * vegetation.sizeX + x] != 0;
+			};
+
+			// Connected components of the crowns
+			ClusterMap clusterMap(vegetation.sizeX, vegetation.sizeY);
+			for (int y = 0; y < vegetation.sizeY; ++y)
+				for (int x = 0; x < vegetation.sizeX; ++x)
+				{
+					if (!isCrown(x, y))
+						continue;
+
+					float z = (*mask)[static_cast<std::size_t>(y) * vegetation.sizeX + x];
+					GUInt32 left = x > 0 && isCrown(x - 1, y) ? clusterMap.clusterIndex(x - 1, y) : 0;
+					GUInt32 up = y > 0 && isCrown(x, y - 1) ? clusterMap.clusterIndex(x, y - 1) : 0;
+					if (left == 0 && up == 0)
+						clusterMap.createCluster(x, y, z);
+					else
+					{
+						clusterMap.addPoint(left != 0 ? left : up, x, y, z);
+						if (left != 0 && up != 0)
+							clusterMap.mergeClusters(left, up);
+					}
+				}
+
+			for (GUInt32 index : clusterMap.clusterIndexes())
+				clusterMap.neighbors(index);
+		};
+	});
+
+	suite.add("TreeCrownSegmentation", parameters, pixels, [crowns, seeds]()
+	{
+		return [crowns, seeds]()
+		{
+			CloudTools::Vegetation::TreeCrownSegmentation segmentation(crowns.get(), seeds);
+			segmentation.execute();
+		};
+	});
+
+	CloudTools::Vegetation::TreeCrownSegmentation segmentation(crowns.get(), seeds);
+	segmentation.execute();
+	CloudTools::Vegetation::TreeCrownSegmentation grownSegmentation(grownCrowns.get(), grownSeeds);
+	grownSegmentation.execute();
+	auto clusters = std::make_shared<ClusterMap>(segmentation.clusterMap());
+	auto grownClusters = std::make_shared<ClusterMap>(grownSegmentation.clusterMap());
+
+	suite.add("HausdorffDistance", parameters, pixels, [clusters, grownClusters]()
+	{
+		return [clusters, grownClusters]()
+		{
+			CloudTools::Vegetation::HausdorffDistance distance(*clusters, *grownClusters);
+			distance.execute();
+		};
+	});
+
+	// Contour based building detection
+	suite.add("ContourDetection", parameters, pixels, [surface]()
+	{
+		return [surface]()
+		{
+			AHN::Buildings::ContourDetection detection(surface.get());
+			detection.execute();
+		};
+	});
+
+	AHN::Buildings::ContourDetection detection(surface.get());
+	detection.execute();
+	auto contours = std::make_shared<std::vector<std::vector<cv::Point>>>(detection.getContours());
+
+	suite.add("ContourStages", parameters, pixels, [contours]()
+	{
+		return [contours]()
+		{
+			AHN::Buildings::ContourFiltering filtering(*contours);
+			filtering.execute();
+
+			AHN::Buildings::ContourSplitting splitting(filtering.getContours());
+			splitting.execute();
+
+			AHN::Buildings::ContourSimplification simplification(splitting.getContours());
+			simplification.execute();
+
+			AHN::Buildings::ContourClassification classification(simplification.getContours());
+			classification.execute();
+		};
+	});
+}
@@ -1,7 +1,12 @@
 #include <cstring>
 #include <iostream>
+#include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <stdexcept>
+
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include "IO.h"
 
@@ -9,6 +14,33 @@ namespace CloudTools
 {
 namespace IO
 {
+/// <summary>
+/// The size of the chunks in bulk stream operations.
+/// </summary>
+const std::size_t StreamChunkSize = 4 * 1024 * 1024;
+
+/// <summary>
+/// Determines the remaining size of a stream.
+/// </summary>
+/// <returns>The remaining bytes if the stream is a regular file; otherwise 0.</returns>
+static std::size_t remainingSize(std::FILE* stream)
+{
+#ifdef _MSC_VER
+	struct _stat64 status;
+	if (_fstat64(_fileno(stream), &status) != 0 || (status.st_mode & _S_IFMT) != _S_IFREG)
+		return 0;
+#else
+	struct stat status;
+	if (fstat(fileno(stream), &status) != 0 || !S_ISREG(status.st_mode))
+		return 0;
+#endif
+
+	long position = std::ftell(stream);
+	if (position < 0 || position > status.st_size)
+		return 0;
+	return static_cast<std::size_t>(status.st_size - position);
+}
+
 #pragma region Input operations
 
 bool readBoolean(const std::string &msg, bool def)
@@ -27,6 +59,53 @@ bool readBoolean(const std::string &msg, bool def)
 	return strcmp(answer, "yes") == 0 || strcmp(answer, "y") == 0;
 }
 
+void readStream(std::FILE* stream, std::vector<unsigned char>& buffer)
+{
+	std::size_t knownSize = remainingSize(stream);
+	buffer.resize(knownSize > 0 ? knownSize : StreamChunkSize);
+
+	std::size_t size = 0;
+	while (true)
+	{
+		if (size == buffer.size())
+		{
+			// Probe for the end of the stream before growing the buffer
+			int next = std::fgetc(stream);
+			if (next == EOF)
+				break;
+			buffer.resize(size + std::max(StreamChunkSize, size / 2));
+			buffer[size++] = static_cast<unsigned char>(next);
+		}
+
+		std::size_t count = std::fread(&buffer[size], 1, std::min(StreamChunkSize, buffer.size() - size), stream);
+		size += count;
+		if (count == 0)
+			break;
+	}
+
+	if (std::ferror(stream))
+		throw std::runtime_error("Error at reading the input stream.");
+	buffer.resize(size);
+}
+
+bool readStream(std::FILE* stream, void* data, std::size_t size)
+{
+	unsigned char* bytes = static_cast<unsigned char*>(data);
+	std::size_t position = 0;
+	while (position < size)
+	{
+		std::size_t count = std::fread(bytes + position, 1, std::min(StreamChunkSize, size - position), stream);
+		if (count == 0)
+		{
+			if (std::ferror(stream))
+				throw std::runtime_error("Error at reading the input stream.");
+			return false;
+		}
+		position += count;
+	}
+	return true;
+}
+
 #pragma endregion 
 
 #pragma region Output operations
@@ -51,6 +130,38 @@ void eraseLine(std::size_t size)
 	std::cout << '\r' << std::flush;
 }
 
+void writeStream(std::FILE* stream, const void* data, std::size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (std::size_t position = 0; position < size; position += StreamChunkSize)
+	{
+		std::size_t count = std::min(StreamChunkSize, size - position);
+		if (std::fwrite(bytes + position, 1, count, stream) != count)
+			throw std::runtime_error("Error at writing the output stream.");
+	}
+}
+
+std::string escapeJson(const std::string& value)
+{
+	std::ostringstream result;
+	for (char c : value)
+	{
+		switch (c)
+		{
+		case '"': result << "\\\""; break;
+		case '\\': result << "\\\\"; break;
+		case '\n': result << "\\n"; break;
+		case '\t': result << "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+				result << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+			else
+				result << c;
+		}
+	}
+	return result.str();
+}
+
 #pragma endregion 
 } // IO
 } // CloudTools
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <functional>
+#include <cstdio>
 
 namespace CloudTools
 {
@@ -20,6 +22,7 @@ enum ExitCodes
 	InvalidInput = 1,
 	UnexcpectedError = 2,
 	Unsupported = 3,
+	Regression = 4,
 };
 
 #pragma endregion
@@ -33,6 +36,26 @@ enum ExitCodes
 /// <param name="def">The default return value.</param>
 bool readBoolean(const std::string &msg, bool def = true);
 
+/// <summary>
+/// Reads the remaining content of a binary stream.
+/// </summary>
+/// <remarks>
+/// The content is read in bulk chunks directly into the buffer,
+/// which is pre-sized when the stream is a regular file with a known size.
+/// </remarks>
+/// <param name="stream">The stream to read.</param>
+/// <param name="buffer">The buffer to read into, its previous content is discarded.</param>
+void readStream(std::FILE* stream, std::vector<unsigned char>& buffer);
+
+/// <summary>
+/// Reads an exact number of bytes from a binary stream.
+/// </summary>
+/// <param name="stream">The stream to read.</param>
+/// <param name="data">The memory to read into.</param>
+/// <param name="size">The number of bytes to read.</param>
+/// <returns><c>true</c> if all bytes were read; <c>false</c> if the stream ended before.</returns>
+bool readStream(std::FILE* stream, void* data, std::size_t size);
+
 #pragma endregion 
 
 #pragma region Output operations
@@ -50,6 +73,21 @@ void reportProgress(float complete, const std::string &message = std::string());
 /// <param name="complete">The number of characters to erase.</param>
 void eraseLine(std::size_t size = 32);
 
+/// <summary>
+/// Writes binary data to a stream in bulk chunks.
+/// </summary>
+/// <param name="stream">The stream to write.</param>
+/// <param name="data">The data to write.</param>
+/// <param name="size">The number of bytes to write.</param>
+void writeStream(std::FILE* stream, const void* data, std::size_t size);
+
+/// <summary>
+/// Escapes a text to be written as a JSON string.
+/// </summary>
+/// <param name="value">The text to escape.</param>
+/// <returns>The escaped text without the enclosing quotation marks.</returns>
+std::string escapeJson(const std::string& value);
+
 #pragma endregion 
 } // IO
 } // CloudTools
@@ -0,0 +1,103 @@
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "ResultCache.h"
+
+namespace CloudTools
+{
+namespace IO
+{
+#pragma region CacheKey
+
+CacheKey::CacheKey()
+	: _low(14695981039346656037ULL), _high(0x84222325cbf29ce4ULL)
+{ }
+
+CacheKey& CacheKey::add(const std::string& value)
+{
+	std::uint64_t size = value.size();
+	hash(&size, sizeof(size));
+	hash(value.data(), value.size());
+	return *this;
+}
+
+CacheKey& CacheKey::add(long long value)
+{
+	hash(&value, sizeof(value));
+	return *this;
+}
+
+CacheKey& CacheKey::add(const CacheKey& key)
+{
+	hash(&key._low, sizeof(key._low));
+	hash(&key._high, sizeof(key._high));
+	return *this;
+}
+
+CacheKey& CacheKey::addFile(const std::string& path)
+{
+	if (!fs::is_regular_file(path))
+		throw std::invalid_argument("The cached input file does not exist.");
+
+	add(fs::canonical(path).string());
+	add(static_cast<long long>(fs::file_size(path)));
+	add(static_cast<long long>(fs::last_write_time(path)));
+	return *this;
+}
+
+std::string CacheKey::str() const
+{
+	std::ostringstream stream;
+	stream << std::hex << std::setfill('0')
+	       << std::setw(16) << _high
+	       << std::setw(16) << _low;
+	return stream.str();
+}
+
+void CacheKey::hash(const void* data, std::size_t size)
+{
+	// 2 independent FNV-1a hashes with different offset bases, giving a 128 bit key
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		_low = (_low ^ bytes[i]) * 1099511628211ULL;
+		_high = (_high ^ bytes[i]) * 1099511628211ULL;
+	}
+}
+
+#pragma endregion
+
+#pragma region ResultCache
+
+ResultCache::ResultCache(const std::string& directory)
+	: _directory(directory)
+{
+	if (fs::exists(_directory) && !fs::is_directory(_directory))
+		throw std::invalid_argument("The given cache path exists but is not a directory.");
+	if (!fs::exists(_directory))
+		fs::create_directories(_directory);
+}
+
+std::string ResultCache::path(const CacheKey& key, const std::string& extension) const
+{
+	return (_directory / (key.str() + extension)).string();
+}
+
+bool ResultCache::contains(const CacheKey& key, const std::string& extension) const
+{
+	return fs::is_regular_file(path(key, extension));
+}
+
+void ResultCache::store(const std::string& sourcePath, const CacheKey& key, const std::string& extension) const
+{
+	fs::path targetPath = path(key, extension);
+	fs::path temporaryPath = _directory / fs::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+
+	fs::copy_file(sourcePath, temporaryPath);
+	fs::rename(temporaryPath, targetPath);
+}
+
+#pragma endregion
+} // IO
+} // CloudTools
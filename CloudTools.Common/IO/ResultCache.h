@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace CloudTools
+{
+namespace IO
+{
+/// <summary>
+/// Represents the identifier of a cached result, computed from its inputs and parameters.
+/// </summary>
+class CacheKey
+{
+private:
+	std::uint64_t _low, _high;
+
+public:
+	/// <summary>
+	/// Initializes a new, empty instance of the class.
+	/// </summary>
+	CacheKey();
+
+	/// <summary>
+	/// Adds a textual parameter to the key.
+	/// </summary>
+	/// <param name="value">The parameter.</param>
+	/// <returns>The current key.</returns>
+	CacheKey& add(const std::string& value);
+
+	/// <summary>
+	/// Adds an integral parameter to the key.
+	/// </summary>
+	/// <param name="value">The parameter.</param>
+	/// <returns>The current key.</returns>
+	CacheKey& add(long long value);
+
+	/// <summary>
+	/// Chains another key into the key.
+	/// </summary>
+	/// <param name="key">The other key.</param>
+	/// <returns>The current key.</returns>
+	CacheKey& add(const CacheKey& key);
+
+	/// <summary>
+	/// Adds an input file to the key.
+	/// </summary>
+	/// <remarks>
+	/// The file is identified by its canonical path, size and last modification time,
+	/// so the key changes when the file is modified.
+	/// </remarks>
+	/// <param name="path">The path of the file.</param>
+	/// <returns>The current key.</returns>
+	CacheKey& addFile(const std::string& path);
+
+	/// <summary>
+	/// Gets the hexadecimal representation of the key.
+	/// </summary>
+	std::string str() const;
+
+private:
+	void hash(const void* data, std::size_t size);
+};
+
+/// <summary>
+/// Represents a content-addressed cache of result files in a local directory.
+/// </summary>
+class ResultCache
+{
+private:
+	fs::path _directory;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class.
+	/// </summary>
+	/// <remarks>
+	/// The directory is created if it does not exist.
+	/// </remarks>
+	/// <param name="directory">The cache directory.</param>
+	explicit ResultCache(const std::string& directory);
+
+	/// <summary>
+	/// Gets the cache directory.
+	/// </summary>
+	std::string directory() const { return _directory.string(); }
+
+	/// <summary>
+	/// Gets the path of a cache entry.
+	/// </summary>
+	/// <param name="key">The key of the entry.</param>
+	/// <param name="extension">The file extension of the entry.</param>
+	std::string path(const CacheKey& key, const std::string& extension) const;
+
+	/// <summary>
+	/// Determines whether the cache contains an entry.
+	/// </summary>
+	/// <param name="key">The key of the entry.</param>
+	/// <param name="extension">The file extension of the entry.</param>
+	bool contains(const CacheKey& key, const std::string& extension) const;
+
+	/// <summary>
+	/// Stores a copy of a file as a cache entry.
+	/// </summary>
+	/// <remarks>
+	/// The entry is written under a temporary name and renamed afterwards,
+	/// so concurrent processes never observe a partially written entry.
+	/// </remarks>
+	/// <param name="sourcePath">The path of the file to store.</param>
+	/// <param name="key">The key of the entry.</param>
+	/// <param name="extension">The file extension of the entry.</param>
+	void store(const std::string& sourcePath, const CacheKey& key, const std::string& extension) const;
+};
+} // IO
+} // CloudTools
@@ -13,6 +13,7 @@ ResultCollection::~ResultCollection()
 
 Result& ResultCollection::result(const std::string& name, std::size_t index)
 {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
 	if (_results.count(name) <= index)
 		throw std::out_of_range("No result found with the given name and index.");
 
@@ -24,6 +25,7 @@ Result& ResultCollection::result(const std::string& name, std::size_t index)
 
 std::size_t ResultCollection::newResult(const std::string& name, bool isFinal)
 {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
 	std::pair<std::string, Result*> item(name, createResult(name, isFinal));
 	_results.emplace(std::move(item));
 	return _results.count(name) - 1;
@@ -31,6 +33,7 @@ std::size_t ResultCollection::newResult(const std::string& name, bool isFinal)
 
 void ResultCollection::deleteResult(const std::string& name, std::size_t index)
 {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
 	if (_results.count(name) <= index)
 		throw std::out_of_range("No result found with the given name and index.");
 
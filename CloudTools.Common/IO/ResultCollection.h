@@ -1,7 +1,9 @@
 #pragma once
 
 #include <string>
+#include <map>
 #include <unordered_map>
+#include <mutex>
 
 #include "Result.h"
 
@@ -9,10 +11,17 @@ namespace CloudTools
 {
 namespace IO
 {
+/// <summary>
+/// Represents a collection of named result objects.
+/// </summary>
+/// <remarks>
+/// The collection can be safely accessed from multiple threads, the result objects themselves are not synchronized.
+/// </remarks>
 class ResultCollection
 {
 private:
 	std::multimap<std::string, CloudTools::IO::Result*> _results;
+	std::recursive_mutex _mutex;
 
 public:
 	virtual ~ResultCollection();
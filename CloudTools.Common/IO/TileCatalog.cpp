@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <iterator>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/regex.hpp>
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
+#include <gdal_priv.h>
+
+#include "TileCatalog.h"
+#include "ResultCache.h"
+
+namespace CloudTools
+{
+namespace IO
+{
+namespace
+{
+typedef boost::geometry::model::point<double, 2, boost::geometry::cs::cartesian> Point;
+typedef boost::geometry::model::box<Point> Box;
+typedef std::pair<Box, std::size_t> IndexValue;
+}
+
+struct TileCatalog::ExtentIndex
+{
+	boost::geometry::index::rtree<IndexValue, boost::geometry::index::rstar<16>> rtree;
+};
+
+TileCatalog::TileCatalog(const std::string& directory,
+                         const std::string& filePattern,
+                         const std::string& tilePattern,
+                         ExtentType extentType,
+                         const std::string& layer,
+                         const std::string& cacheDirectory)
+	: _directory(directory), _filePattern(filePattern), _tilePattern(tilePattern),
+	  _extentType(extentType), _layer(layer), _extentIndex(new ExtentIndex())
+{
+	if (!fs::is_directory(_directory))
+		throw std::invalid_argument("The catalog directory does not exist.");
+
+	if (cacheDirectory.empty())
+	{
+		scan(std::vector<TileEntry>());
+		return;
+	}
+
+	if (!fs::exists(cacheDirectory))
+		fs::create_directories(cacheDirectory);
+	fs::path path = cachePath(cacheDirectory);
+	if (scan(readCache(path)))
+		writeCache(path, _entries);
+}
+
+TileCatalog::~TileCatalog() = default;
+
+const TileEntry* TileCatalog::find(const std::string& tileName) const
+{
+	auto it = _names.find(tileName);
+	if (it == _names.end())
+		return nullptr;
+	return &_entries[it->second];
+}
+
+const std::string& TileCatalog::lookup(const std::string& tileName) const
+{
+	const TileEntry* entry = find(tileName);
+	if (entry == nullptr)
+		throw std::runtime_error("No input found in directory '" + _directory.string() + "' for tile '" + tileName + "'.");
+	return entry->path;
+}
+
+std::vector<const TileEntry*> TileCatalog::overlapping(double minX, double minY, double maxX, double maxY) const
+{
+	std::vector<IndexValue> candidates;
+	_extentIndex->rtree.query(boost::geometry::index::intersects(Box(Point(minX, minY), Point(maxX, maxY))),
+	                          std::back_inserter(candidates));
+
+	// The R-tree also returns the touching extents, and in arbitrary order
+	std::vector<std::size_t> indices;
+	for (const IndexValue& candidate : candidates)
+		if (_entries[candidate.second].isOverlapping(minX, minY, maxX, maxY))
+			indices.push_back(candidate.second);
+	std::sort(indices.begin(), indices.end());
+
+	std::vector<const TileEntry*> result;
+	result.reserve(indices.size());
+	for (std::size_t index : indices)
+		result.push_back(&_entries[index]);
+	return result;
+}
+
+std::vector<const TileEntry*> TileCatalog::spatialOrder() const
+{
+	std::vector<const TileEntry*> result;
+	result.reserve(_entries.size());
+	for (const TileEntry& entry : _entries)
+		result.push_back(&entry);
+
+	// Tiles are placed on a grid with the cell size of the smallest tile
+	double originX = 0, originY = 0, cellSizeX = 0, cellSizeY = 0;
+	for (const TileEntry& entry : _entries)
+	{
+		if (!entry.hasExtent || entry.maxX <= entry.minX || entry.maxY <= entry.minY)
+			continue;
+		if (cellSizeX == 0)
+		{
+			originX = entry.minX;
+			originY = entry.maxY;
+			cellSizeX = entry.maxX - entry.minX;
+			cellSizeY = entry.maxY - entry.minY;
+		}
+		originX = std::min(originX, entry.minX);
+		originY = std::max(originY, entry.maxY);
+		cellSizeX = std::min(cellSizeX, entry.maxX - entry.minX);
+		cellSizeY = std::min(cellSizeY, entry.maxY - entry.minY);
+	}
+	if (cellSizeX == 0)
+		return result;
+
+	std::unordered_map<const TileEntry*, std::uint64_t> distances;
+	std::uint64_t gridSize = 1, maxColumn = 0, maxRow = 0;
+	for (const TileEntry& entry : _entries)
+		if (entry.hasExtent)
+		{
+			maxColumn = std::max(maxColumn, static_cast<std::uint64_t>(((entry.minX + entry.maxX) / 2 - originX) / cellSizeX));
+			maxRow = std::max(maxRow, static_cast<std::uint64_t>((originY - (entry.minY + entry.maxY) / 2) / cellSizeY));
+		}
+	while (gridSize <= std::max(maxColumn, maxRow))
+		gridSize *= 2;
+
+	for (const TileEntry& entry : _entries)
+	{
+		if (!entry.hasExtent)
+		{
+			distances[&entry] = std::numeric_limits<std::uint64_t>::max();
+			continue;
+		}
+
+		// Distance along the Hilbert curve of the grid cell containing the center of the tile
+		std::uint64_t x = static_cast<std::uint64_t>(((entry.minX + entry.maxX) / 2 - originX) / cellSizeX);
+		std::uint64_t y = static_cast<std::uint64_t>((originY - (entry.minY + entry.maxY) / 2) / cellSizeY);
+		std::uint64_t distance = 0;
+		for (std::uint64_t s = gridSize / 2; s > 0; s /= 2)
+		{
+			std::uint64_t rx = (x & s) > 0;
+			std::uint64_t ry = (y & s) > 0;
+			distance += s * s * ((3 * rx) ^ ry);
+			if (ry == 0)
+			{
+				if (rx == 1)
+				{
+					x = gridSize - 1 - x;
+					y = gridSize - 1 - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		distances[&entry] = distance;
+	}
+
+	std::stable_sort(result.begin(), result.end(),
+		[&distances](const TileEntry* a, const TileEntry* b)
+		{
+			return distances[a] < distances[b];
+		});
+	return result;
+}
+
+bool TileCatalog::scan(const std::vector<TileEntry>& cached)
+{
+	std::unordered_map<std::string, const TileEntry*> cachedPaths;
+	for (const TileEntry& entry : cached)
+		cachedPaths[entry.path] = &entry;
+
+	boost::regex fileRegex(_filePattern);
+	boost::regex tileRegex(_tilePattern.empty() ? ".*" : _tilePattern);
+	bool isChanged = false;
+
+	_entries.clear();
+	for (fs::directory_iterator item(_directory); item != fs::directory_iterator(); ++item)
+	{
+		std::string fileName = item->path().filename().string();
+		if (!fs::is_regular_file(item->status()) ||
+		    !boost::regex_match(fileName, fileRegex))
+			continue;
+
+		TileEntry entry;
+		if (_tilePattern.empty())
+			entry.name = item->path().stem().string();
+		else
+		{
+			boost::smatch tileMatch;
+			if (!boost::regex_search(fileName, tileMatch, tileRegex))
+				continue;
+			entry.name = tileMatch.str();
+		}
+
+		entry.path = item->path().string();
+		entry.size = fs::file_size(item->path());
+		entry.modified = fs::last_write_time(item->path());
+
+		auto it = cachedPaths.find(entry.path);
+		if (it != cachedPaths.end() &&
+		    it->second->size == entry.size &&
+		    it->second->modified == entry.modified)
+		{
+			entry.hasExtent = it->second->hasExtent;
+			entry.minX = it->second->minX;
+			entry.minY = it->second->minY;
+			entry.maxX = it->second->maxX;
+			entry.maxY = it->second->maxY;
+			entry.rasterSizeX = it->second->rasterSizeX;
+			entry.rasterSizeY = it->second->rasterSizeY;
+		}
+		else
+		{
+			readExtent(entry);
+			isChanged = true;
+		}
+		_entries.push_back(std::move(entry));
+	}
+
+	std::sort(_entries.begin(), _entries.end(),
+		[](const TileEntry& a, const TileEntry& b)
+		{
+			return a.path < b.path;
+		});
+
+	// Removed files invalidate the cache as well
+	isChanged = isChanged || _entries.size() != cached.size();
+
+	_names.clear();
+	for (std::size_t i = 0; i < _entries.size(); ++i)
+		_names.emplace(_entries[i].name, i);
+
+	std::vector<IndexValue> extents;
+	for (std::size_t i = 0; i < _entries.size(); ++i)
+		if (_entries[i].hasExtent)
+			extents.emplace_back(Box(Point(_entries[i].minX, _entries[i].minY),
+			                         Point(_entries[i].maxX, _entries[i].maxY)), i);
+	_extentIndex->rtree = decltype(_extentIndex->rtree)(extents.begin(), extents.end());
+	return isChanged;
+}
+
+void TileCatalog::readExtent(TileEntry& entry) const
+{
+	entry.hasExtent = false;
+	if (_extentType == RasterExtent)
+	{
+		GDALDataset* dataset = static_cast<GDALDataset*>(GDALOpen(entry.path.c_str(), GA_ReadOnly));
+		if (dataset == nullptr)
+			return;
+
+		double geoTransform[6];
+		if (dataset->GetGeoTransform(geoTransform) == CE_None)
+		{
+			double x1 = geoTransform[0];
+			double y1 = geoTransform[3];
+			double x2 = x1 + dataset->GetRasterXSize() * geoTransform[1];
+			double y2 = y1 + dataset->GetRasterYSize() * geoTransform[5];
+
+			entry.minX = std::min(x1, x2);
+			entry.maxX = std::max(x1, x2);
+			entry.minY = std::min(y1, y2);
+			entry.maxY = std::max(y1, y2);
+			entry.rasterSizeX = dataset->GetRasterXSize();
+			entry.rasterSizeY = dataset->GetRasterYSize();
+			entry.hasExtent = true;
+		}
+		GDALClose(dataset);
+	}
+	else if (_extentType == VectorExtent)
+	{
+		GDALDataset* dataset = static_cast<GDALDataset*>(GDALOpenEx(entry.path.c_str(),
+			GDAL_OF_VECTOR | GDAL_OF_READONLY, nullptr, nullptr, nullptr));
+		if (dataset == nullptr)
+			throw std::runtime_error("Error at opening the catalog file '" + entry.path + "'.");
+
+		OGRLayer* layer = nullptr;
+		if (!_layer.empty())
+			layer = dataset->GetLayerByName(_layer.c_str());
+		else if (dataset->GetLayerCount() == 1)
+			layer = dataset->GetLayer(0);
+
+		// Rounded outwards the same way as the vector metadata.
+		OGREnvelope extent;
+		if (layer != nullptr && layer->GetExtent(&extent, true) == OGRERR_NONE)
+		{
+			entry.minX = std::floor(extent.MinX);
+			entry.maxX = std::ceil(extent.MaxX);
+			entry.minY = std::floor(extent.MinY);
+			entry.maxY = std::ceil(extent.MaxY);
+			entry.hasExtent = true;
+		}
+		GDALClose(dataset);
+	}
+}
+
+fs::path TileCatalog::cachePath(const std::string& cacheDirectory) const
+{
+	CacheKey key;
+	key.add(fs::canonical(_directory).string())
+	   .add(_filePattern)
+	   .add(static_cast<long long>(_extentType))
+	   .add(_layer);
+	return fs::path(cacheDirectory) / (key.str() + ".catalog");
+}
+
+std::vector<TileEntry> TileCatalog::readCache(const fs::path& path)
+{
+	std::vector<TileEntry> entries;
+	std::ifstream stream(path.string());
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		// Format: path, size, modification time, extent flag, extent and raster size, separated by tabulators
+		std::istringstream fields(line);
+		TileEntry entry;
+		long long modified;
+		if (!std::getline(fields, entry.path, '\t') ||
+		    !(fields >> entry.size >> modified >> entry.hasExtent
+		            >> entry.minX >> entry.minY >> entry.maxX >> entry.maxY
+		            >> entry.rasterSizeX >> entry.rasterSizeY))
+			return std::vector<TileEntry>(); // corrupt cache, rebuild
+		entry.modified = static_cast<std::time_t>(modified);
+		entries.push_back(std::move(entry));
+	}
+	return entries;
+}
+
+void TileCatalog::writeCache(const fs::path& path, const std::vector<TileEntry>& entries)
+{
+	// Written under a temporary name and renamed, so concurrent processes never read a partial catalog.
+	fs::path temporaryPath = path;
+	temporaryPath += fs::unique_path(".%%%%-%%%%.tmp");
+	{
+		std::ofstream stream(temporaryPath.string());
+		stream << std::setprecision(17);
+		for (const TileEntry& entry : entries)
+			stream << entry.path << '\t' << entry.size << '\t' << static_cast<long long>(entry.modified) << '\t'
+			       << entry.hasExtent << '\t'
+			       << entry.minX << '\t' << entry.minY << '\t' << entry.maxX << '\t' << entry.maxY << '\t'
+			       << entry.rasterSizeX << '\t' << entry.rasterSizeY << '\n';
+		if (!stream)
+			throw std::runtime_error("Failed to write the tile catalog.");
+	}
+	fs::rename(temporaryPath, path);
+}
+} // IO
+} // CloudTools
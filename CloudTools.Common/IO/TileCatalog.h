@@ -0,0 +1,189 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <ctime>
+#include <cstdint>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace CloudTools
+{
+namespace IO
+{
+/// <summary>
+/// Represents a file registered in a tile catalog.
+/// </summary>
+struct TileEntry
+{
+	/// <summary>
+	/// The name of the tile, the part of the file name matching the tile pattern.
+	/// </summary>
+	std::string name;
+	/// <summary>
+	/// The path of the file.
+	/// </summary>
+	std::string path;
+	/// <summary>
+	/// The size of the file in bytes.
+	/// </summary>
+	std::uintmax_t size = 0;
+	/// <summary>
+	/// The last modification time of the file.
+	/// </summary>
+	std::time_t modified = 0;
+
+	/// <summary>
+	/// <c>true</c> if the extent is known; otherwise <c>false</c>.
+	/// </summary>
+	/// <remarks>
+	/// The extent is unknown if it was not requested or the file (or its layer) could not be read.
+	/// </remarks>
+	bool hasExtent = false;
+	double minX = 0;
+	double minY = 0;
+	double maxX = 0;
+	double maxY = 0;
+
+	/// <summary>
+	/// The number of columns and rows of a raster tile, 0 for vector tiles.
+	/// </summary>
+	int rasterSizeX = 0;
+	int rasterSizeY = 0;
+
+	/// <summary>
+	/// Determines whether the extent of the tile overlaps with the given one.
+	/// </summary>
+	bool isOverlapping(double minX, double minY, double maxX, double maxY) const
+	{
+		return hasExtent &&
+		       this->minX < maxX && this->maxX > minX &&
+		       this->minY < maxY && this->maxY > minY;
+	}
+};
+
+/// <summary>
+/// Represents an index of the tile files in a directory.
+/// </summary>
+/// <remarks>
+/// The directory is scanned once, the tiles are matched by name and queried by extent from the memory.
+/// The catalog can be persisted in a cache directory, where an entry is reused as long as
+/// the size and the last modification time of its file is unchanged.
+/// The known extents are indexed by an R-tree, which is bulk loaded after each scan.
+/// </remarks>
+class TileCatalog
+{
+public:
+	/// <summary>
+	/// The type of extents to read from the files.
+	/// </summary>
+	enum ExtentType
+	{
+		NoExtent,
+		RasterExtent,
+		VectorExtent
+	};
+
+private:
+	/// <summary>
+	/// Represents the R-tree of the known extents, defined in the source file.
+	/// </summary>
+	struct ExtentIndex;
+
+	fs::path _directory;
+	std::string _filePattern;
+	std::string _tilePattern;
+	ExtentType _extentType;
+	std::string _layer;
+
+	std::vector<TileEntry> _entries;
+	std::unordered_map<std::string, std::size_t> _names;
+	std::unique_ptr<ExtentIndex> _extentIndex;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class and scans the directory.
+	/// </summary>
+	/// <param name="directory">The directory of the tile files.</param>
+	/// <param name="filePattern">The regular expression the file names must match.</param>
+	/// <param name="tilePattern">The regular expression of the tile names searched in the file names, the file stem if empty.</param>
+	/// <param name="extentType">The type of the extents to read.</param>
+	/// <param name="layer">The layer of the vector files to read the extents of, the single layer if empty.</param>
+	/// <param name="cacheDirectory">The directory to persist the catalog in, no persistence if empty.</param>
+	TileCatalog(const std::string& directory,
+	            const std::string& filePattern = ".*",
+	            const std::string& tilePattern = std::string(),
+	            ExtentType extentType = NoExtent,
+	            const std::string& layer = std::string(),
+	            const std::string& cacheDirectory = std::string());
+
+	~TileCatalog();
+
+	TileCatalog(const TileCatalog&) = delete;
+	TileCatalog& operator=(const TileCatalog&) = delete;
+
+	/// <summary>
+	/// Gets the tiles ordered by their paths.
+	/// </summary>
+	const std::vector<TileEntry>& entries() const { return _entries; }
+
+	/// <summary>
+	/// Looks for a tile by its name.
+	/// </summary>
+	/// <param name="tileName">The name of the tile.</param>
+	/// <returns>The tile or <c>nullptr</c> if not found.</returns>
+	const TileEntry* find(const std::string& tileName) const;
+
+	/// <summary>
+	/// Looks for a tile by its name.
+	/// </summary>
+	/// <param name="tileName">The name of the tile.</param>
+	/// <returns>The path of the tile or exception is thrown when not found.</returns>
+	const std::string& lookup(const std::string& tileName) const;
+
+	/// <summary>
+	/// Retrieves the tiles overlapping with the given extent.
+	/// </summary>
+	/// <param name="minX">The minimum X coordinate of the extent.</param>
+	/// <param name="minY">The minimum Y coordinate of the extent.</param>
+	/// <param name="maxX">The maximum X coordinate of the extent.</param>
+	/// <param name="maxY">The maximum Y coordinate of the extent.</param>
+	/// <returns>The overlapping tiles ordered by their paths.</returns>
+	std::vector<const TileEntry*> overlapping(double minX, double minY, double maxX, double maxY) const;
+
+	/// <summary>
+	/// Retrieves the tiles along a Hilbert curve of their extents.
+	/// </summary>
+	/// <remarks>
+	/// Consecutive tiles on the curve are neighbours, so the data they share are likely still cached.
+	/// Tiles without a known extent are placed at the end.
+	/// </remarks>
+	/// <returns>The tiles in space-filling curve order.</returns>
+	std::vector<const TileEntry*> spatialOrder() const;
+
+private:
+	/// <summary>
+	/// Scans the directory, reusing the unchanged entries of the cache.
+	/// </summary>
+	/// <returns><c>true</c> if any entry was (re)created; otherwise <c>false</c>.</returns>
+	bool scan(const std::vector<TileEntry>& cached);
+
+	/// <summary>
+	/// Reads the extent of a file.
+	/// </summary>
+	void readExtent(TileEntry& entry) const;
+
+	/// <summary>
+	/// Gets the path of the persisted catalog in the cache directory.
+	/// </summary>
+	fs::path cachePath(const std::string& cacheDirectory) const;
+
+	static std::vector<TileEntry> readCache(const fs::path& path);
+	static void writeCache(const fs::path& path, const std::vector<TileEntry>& entries);
+};
+} // IO
+} // CloudTools
@@ -0,0 +1,499 @@
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+#endif
+
+#include "IO/IO.h"
+#include "Metrics.h"
+
+namespace CloudTools
+{
+namespace
+{
+/// <summary>
+/// Guards the structure and the timings of the metrics trees shared between threads.
+/// </summary>
+std::mutex metricsMutex;
+
+/// <summary>
+/// The stack of open scopes on the thread.
+/// </summary>
+thread_local std::vector<OperationMetrics*> scopeStack;
+
+/// <summary>
+/// The open scopes of all threads, their peak memory is raised by the sampler.
+/// </summary>
+/// <remarks>
+/// Guarded by the metrics mutex.
+/// </remarks>
+std::vector<OperationMetrics*> openScopes;
+
+/// <summary>
+/// Raises the peak memory of the open scopes to the current resident memory.
+/// </summary>
+void sampleMemory()
+{
+	std::size_t memory = Metrics::residentMemory();
+	std::lock_guard<std::mutex> lock(metricsMutex);
+	for (OperationMetrics* node : openScopes)
+		node->peakMemory = std::max(node->peakMemory, memory);
+}
+
+/// <summary>
+/// Samples the resident memory on a background thread while any recorder is active.
+/// </summary>
+/// <remarks>
+/// Short-lived allocations within a scope are only captured by periodic sampling,
+/// as the peak memory reported by the system only grows during the lifetime of the process.
+/// </remarks>
+class MemorySampler
+{
+private:
+	std::mutex _mutex;
+	std::condition_variable _changed;
+	std::thread _thread;
+	std::size_t _recorders = 0;
+	std::size_t _generation = 0;
+
+public:
+	~MemorySampler()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_recorders = 0;
+		++_generation;
+		_changed.notify_all();
+		std::thread thread = std::move(_thread);
+		lock.unlock();
+		if (thread.joinable())
+			thread.join();
+	}
+
+	/// <summary>
+	/// Starts sampling for a new recorder.
+	/// </summary>
+	void attach()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_recorders++ > 0)
+			return;
+
+		// A sampler of an earlier generation may still be stopping, it exits on the changed generation
+		std::size_t generation = ++_generation;
+		_thread = std::thread([this, generation]()
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (_generation == generation)
+			{
+				lock.unlock();
+				sampleMemory();
+				lock.lock();
+				_changed.wait_for(lock, std::chrono::milliseconds(5),
+					[this, generation] { return _generation != generation; });
+			}
+		});
+	}
+
+	/// <summary>
+	/// Stops sampling when the last recorder is stopped.
+	/// </summary>
+	void detach()
+	{
+		std::thread thread;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_recorders == 0 || --_recorders > 0)
+				return;
+			++_generation;
+			thread = std::move(_thread);
+		}
+		_changed.notify_all();
+		if (thread.joinable())
+			thread.join();
+	}
+} memorySampler;
+
+/// <summary>
+/// Registers a node as open, its peak memory starts from the current resident memory.
+/// </summary>
+void openScope(OperationMetrics* node, std::size_t memory)
+{
+	std::lock_guard<std::mutex> lock(metricsMutex);
+	node->peakMemory = memory;
+	openScopes.push_back(node);
+}
+}
+
+#pragma region OperationMetrics
+
+void OperationMetrics::writeJson(std::ostream& out, int indent) const
+{
+	std::string padding(indent, '\t');
+	out << "{\n"
+	    << padding << "\t\"name\": \"" << IO::escapeJson(name) << "\",\n"
+	    << padding << "\t\"wallTime\": " << wallTime << ",\n"
+	    << padding << "\t\"cpuTime\": " << cpuTime << ",\n"
+	    << padding << "\t\"bytesRead\": " << bytesRead.load() << ",\n"
+	    << padding << "\t\"bytesWritten\": " << bytesWritten.load() << ",\n"
+	    << padding << "\t\"pixels\": " << pixels.load() << ",\n"
+	    << padding << "\t\"peakMemory\": " << peakMemory << ",\n"
+	    << padding << "\t\"memoryGrowth\": " << memoryGrowth << ",\n";
+	if (!criticalPath.empty())
+	{
+		out << padding << "\t\"criticalPath\": [";
+		for (std::size_t i = 0; i < criticalPath.size(); ++i)
+			out << (i == 0 ? "" : ", ") << "\"" << IO::escapeJson(criticalPath[i]) << "\"";
+		out << "],\n"
+		    << padding << "\t\"criticalPathDuration\": " << criticalPathDuration << ",\n";
+	}
+	out << padding << "\t\"children\": [";
+	for (std::size_t i = 0; i < children.size(); ++i)
+	{
+		out << (i == 0 ? "\n" : ",\n") << padding << "\t\t";
+		children[i]->writeJson(out, indent + 2);
+	}
+	if (!children.empty())
+		out << "\n" << padding << "\t";
+	out << "]\n" << padding << "}";
+}
+
+#pragma endregion
+
+#pragma region Metrics
+
+Metrics::Scope::Scope(const std::string& name)
+{
+	if (!scopeStack.empty())
+		start(scopeStack.back(), name);
+}
+
+Metrics::Scope::Scope(OperationMetrics* parent, const std::string& name)
+{
+	if (parent != nullptr)
+		start(parent, name);
+}
+
+Metrics::Scope::~Scope()
+{
+	if (_node == nullptr)
+		return;
+	scopeStack.pop_back();
+	finish(_node, _parent, _wallStart, _cpuStart, _memoryStart);
+}
+
+void Metrics::Scope::start(OperationMetrics* parent, const std::string& name)
+{
+	std::unique_ptr<OperationMetrics> node(new OperationMetrics());
+	node->name = name;
+	_node = node.get();
+	_parent = parent;
+	{
+		std::lock_guard<std::mutex> lock(metricsMutex);
+		parent->children.push_back(std::move(node));
+	}
+	scopeStack.push_back(_node);
+
+	_wallStart = std::chrono::steady_clock::now();
+	_cpuStart = threadCpuTime();
+	_memoryStart = residentMemory();
+	openScope(_node, _memoryStart);
+}
+
+OperationMetrics* Metrics::current()
+{
+	return scopeStack.empty() ? nullptr : scopeStack.back();
+}
+
+void Metrics::addRead(std::uint64_t bytes)
+{
+	if (scopeStack.empty()) return;
+	scopeStack.back()->bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::addWritten(std::uint64_t bytes)
+{
+	if (scopeStack.empty()) return;
+	scopeStack.back()->bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::addPixels(std::uint64_t pixels)
+{
+	if (scopeStack.empty()) return;
+	scopeStack.back()->pixels.fetch_add(pixels, std::memory_order_relaxed);
+}
+
+std::size_t Metrics::peakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+	return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+std::size_t Metrics::residentMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+		return 0;
+	return static_cast<std::size_t>(info.resident_size);
+#else
+	// The second field is the number of resident pages
+	std::ifstream statm("/proc/self/statm");
+	std::size_t size, resident;
+	if (!(statm >> size >> resident))
+		return 0;
+	return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+double Metrics::threadCpuTime()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return 0;
+	auto toSeconds = [](const FILETIME& time)
+	{
+		return ((static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7;
+	};
+	return toSeconds(kernel) + toSeconds(user);
+#else
+	struct timespec time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+		return 0;
+	return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+}
+
+void Metrics::finish(OperationMetrics* node, OperationMetrics* parent,
+                     std::chrono::steady_clock::time_point wallStart, double cpuStart,
+                     std::size_t memoryStart)
+{
+	double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	double cpuTime = threadCpuTime() - cpuStart;
+	std::size_t memory = residentMemory();
+	std::int64_t memoryGrowth = static_cast<std::int64_t>(memory) - static_cast<std::int64_t>(memoryStart);
+
+	{
+		std::lock_guard<std::mutex> lock(metricsMutex);
+		node->wallTime = wallTime;
+		node->cpuTime = cpuTime;
+		node->peakMemory = std::max(node->peakMemory, memory);
+		node->memoryGrowth = memoryGrowth;
+		if (parent != nullptr)
+			parent->peakMemory = std::max(parent->peakMemory, node->peakMemory);
+		auto it = std::find(openScopes.begin(), openScopes.end(), node);
+		if (it != openScopes.end())
+			openScopes.erase(it);
+	}
+	if (parent != nullptr)
+	{
+		parent->bytesRead.fetch_add(node->bytesRead.load(), std::memory_order_relaxed);
+		parent->bytesWritten.fetch_add(node->bytesWritten.load(), std::memory_order_relaxed);
+		parent->pixels.fetch_add(node->pixels.load(), std::memory_order_relaxed);
+	}
+}
+
+#pragma endregion
+
+#pragma region MetricsRecorder
+
+MetricsRecorder::MetricsRecorder(const std::string& name)
+{
+	_root.name = name;
+	scopeStack.push_back(&_root);
+	_wallStart = std::chrono::steady_clock::now();
+	_cpuStart = Metrics::threadCpuTime();
+	_memoryStart = Metrics::residentMemory();
+	openScope(&_root, _memoryStart);
+	memorySampler.attach();
+}
+
+MetricsRecorder::~MetricsRecorder()
+{
+	stop();
+}
+
+void MetricsRecorder::stop()
+{
+	if (_isFinished)
+		return;
+	_isFinished = true;
+
+	// The scopes still open above the recorder are abandoned.
+	auto it = std::find(scopeStack.begin(), scopeStack.end(), &_root);
+	if (it != scopeStack.end())
+		scopeStack.erase(it, scopeStack.end());
+	memorySampler.detach();
+	Metrics::finish(&_root, nullptr, _wallStart, _cpuStart, _memoryStart);
+}
+
+void MetricsRecorder::writeJson(const std::string& path) const
+{
+	std::ofstream out(path);
+	out << std::setprecision(6);
+	_root.writeJson(out);
+	out << std::endl;
+	if (!out)
+		throw std::runtime_error("Failed to write the metrics report.");
+}
+
+#pragma endregion
+
+#pragma region MetricsSummary
+
+void MetricsSummary::add(const OperationMetrics& metrics)
+{
+	++_recordings;
+	_peakMemory = std::max(_peakMemory, Metrics::peakMemory());
+	for (const auto& child : metrics.children)
+		add(*child, std::string(), false);
+}
+
+void MetricsSummary::add(const OperationMetrics& metrics, const std::string& prefix, bool isCritical)
+{
+	std::string path = prefix.empty() ? metrics.name : prefix + " / " + metrics.name;
+	Entry& entry = _entries[path];
+	++entry.count;
+	entry.wallTime += metrics.wallTime;
+	entry.cpuTime += metrics.cpuTime;
+	entry.bytesRead += metrics.bytesRead;
+	entry.bytesWritten += metrics.bytesWritten;
+	entry.pixels += metrics.pixels;
+	entry.peakMemory = std::max(entry.peakMemory, metrics.peakMemory);
+	entry.memoryGrowth = entry.count == 1 ? metrics.memoryGrowth : std::max(entry.memoryGrowth, metrics.memoryGrowth);
+	if (isCritical)
+		++entry.criticalCount;
+
+	for (const auto& child : metrics.children)
+		add(*child, path, std::find(metrics.criticalPath.begin(), metrics.criticalPath.end(),
+		                            child->name) != metrics.criticalPath.end());
+}
+
+void MetricsSummary::merge(const MetricsSummary& other)
+{
+	_recordings += other._recordings;
+	_peakMemory = std::max(_peakMemory, other._peakMemory);
+	for (const auto& item : other._entries)
+	{
+		Entry& entry = _entries[item.first];
+		entry.memoryGrowth = entry.count == 0 ? item.second.memoryGrowth : std::max(entry.memoryGrowth, item.second.memoryGrowth);
+		entry.count += item.second.count;
+		entry.wallTime += item.second.wallTime;
+		entry.cpuTime += item.second.cpuTime;
+		entry.bytesRead += item.second.bytesRead;
+		entry.bytesWritten += item.second.bytesWritten;
+		entry.pixels += item.second.pixels;
+		entry.peakMemory = std::max(entry.peakMemory, item.second.peakMemory);
+		entry.criticalCount += item.second.criticalCount;
+	}
+}
+
+std::string MetricsSummary::serialize() const
+{
+	// Format: the number of recordings and the peak memory, then a line for each scope
+	// with its fields separated by tabulators
+	std::ostringstream out;
+	out << std::setprecision(17) << _recordings << '\t' << _peakMemory << '\n';
+	for (const auto& item : _entries)
+		out << item.first << '\t' << item.second.count << '\t'
+		    << item.second.wallTime << '\t' << item.second.cpuTime << '\t'
+		    << item.second.bytesRead << '\t' << item.second.bytesWritten << '\t'
+		    << item.second.pixels << '\t' << item.second.peakMemory << '\t'
+		    << item.second.memoryGrowth << '\t' << item.second.criticalCount << '\n';
+	return out.str();
+}
+
+MetricsSummary MetricsSummary::deserialize(const std::string& data)
+{
+	MetricsSummary summary;
+	std::istringstream in(data);
+	std::string line;
+	if (!(in >> summary._recordings >> summary._peakMemory) || !std::getline(in, line))
+		throw std::invalid_argument("Invalid serialized metrics summary.");
+
+	while (std::getline(in, line))
+	{
+		std::istringstream fields(line);
+		std::string path;
+		Entry entry;
+		if (!std::getline(fields, path, '\t') ||
+		    !(fields >> entry.count >> entry.wallTime >> entry.cpuTime
+		             >> entry.bytesRead >> entry.bytesWritten >> entry.pixels
+		             >> entry.peakMemory >> entry.memoryGrowth >> entry.criticalCount))
+			throw std::invalid_argument("Invalid serialized metrics summary.");
+		summary._entries[path] = entry;
+	}
+	return summary;
+}
+
+void MetricsSummary::writeJson(const std::string& path) const
+{
+	std::ofstream out(path);
+	out << std::setprecision(6)
+	    << "{\n"
+	    << "\t\"recordings\": " << _recordings << ",\n"
+	    << "\t\"peakMemory\": " << _peakMemory << ",\n"
+	    << "\t\"scopes\": [";
+	bool isFirst = true;
+	for (const auto& item : _entries)
+	{
+		const Entry& entry = item.second;
+		out << (isFirst ? "\n" : ",\n")
+		    << "\t\t{ \"path\": \"" << IO::escapeJson(item.first) << "\""
+		    << ", \"count\": " << entry.count
+		    << ", \"wallTime\": " << entry.wallTime
+		    << ", \"cpuTime\": " << entry.cpuTime
+		    << ", \"bytesRead\": " << entry.bytesRead
+		    << ", \"bytesWritten\": " << entry.bytesWritten
+		    << ", \"pixels\": " << entry.pixels
+		    << ", \"peakMemory\": " << entry.peakMemory
+		    << ", \"memoryGrowth\": " << entry.memoryGrowth
+		    << ", \"criticalCount\": " << entry.criticalCount << " }";
+		isFirst = false;
+	}
+	if (!isFirst)
+		out << "\n\t";
+	out << "]\n}" << std::endl;
+	if (!out)
+		throw std::runtime_error("Failed to write the metrics summary.");
+}
+
+#pragma endregion
+} // CloudTools
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+namespace CloudTools
+{
+/// <summary>
+/// Represents the performance metrics of an operation or a scope of operations.
+/// </summary>
+/// <remarks>
+/// The counters include the nested scopes, the CPU time only includes the thread executing the scope.
+/// The counters are atomic, so the workers of an operation may add to them without locking.
+/// </remarks>
+struct OperationMetrics
+{
+	/// <summary>
+	/// The name of the scope, the type for operations.
+	/// </summary>
+	std::string name;
+	/// <summary>
+	/// The elapsed wall clock time in seconds.
+	/// </summary>
+	double wallTime = 0;
+	/// <summary>
+	/// The CPU time of the executing thread in seconds.
+	/// </summary>
+	double cpuTime = 0;
+	/// <summary>
+	/// The number of bytes read through raster I/O.
+	/// </summary>
+	std::atomic<std::uint64_t> bytesRead{ 0 };
+	/// <summary>
+	/// The number of bytes written through raster I/O.
+	/// </summary>
+	std::atomic<std::uint64_t> bytesWritten{ 0 };
+	/// <summary>
+	/// The number of pixels computed.
+	/// </summary>
+	std::atomic<std::uint64_t> pixels{ 0 };
+	/// <summary>
+	/// The highest resident memory of the process during the scope in bytes.
+	/// </summary>
+	/// <remarks>
+	/// The memory is sampled periodically on a background thread while recording,
+	/// therefore it also includes the allocations of concurrent scopes.
+	/// </remarks>
+	std::size_t peakMemory = 0;
+	/// <summary>
+	/// The change of the resident memory of the process during the scope in bytes.
+	/// </summary>
+	/// <remarks>
+	/// The memory is sampled at the start and the end of the scope, therefore it also includes
+	/// the allocations of concurrent scopes, but not the temporary peaks within the scope.
+	/// </remarks>
+	std::int64_t memoryGrowth = 0;
+
+	/// <summary>
+	/// The names of the nested scopes along the critical path, for operation graphs.
+	/// </summary>
+	std::vector<std::string> criticalPath;
+	/// <summary>
+	/// The total duration of the critical path in seconds.
+	/// </summary>
+	double criticalPathDuration = 0;
+
+	/// <summary>
+	/// The nested scopes in the order of their start.
+	/// </summary>
+	std::vector<std::unique_ptr<OperationMetrics>> children;
+
+	/// <summary>
+	/// Writes the metrics as a JSON object.
+	/// </summary>
+	void writeJson(std::ostream& out, int indent = 0) const;
+};
+
+/// <summary>
+/// Collects performance metrics of operations.
+/// </summary>
+/// <remarks>
+/// Metrics are only collected within a <see cref="MetricsRecorder" /> on the same thread,
+/// or within scopes explicitly attached to one of its nodes from other threads.
+/// The resident memory is sampled on a background thread while any recorder is active.
+/// </remarks>
+class Metrics
+{
+public:
+	/// <summary>
+	/// Represents a measured scope, nested into the current scope of the thread.
+	/// </summary>
+	class Scope
+	{
+	private:
+		OperationMetrics* _node = nullptr;
+		OperationMetrics* _parent = nullptr;
+		std::chrono::steady_clock::time_point _wallStart;
+		double _cpuStart = 0;
+		std::size_t _memoryStart = 0;
+
+	public:
+		/// <summary>
+		/// Starts a scope nested into the current scope of the thread, inactive if there is none.
+		/// </summary>
+		/// <param name="name">The name of the scope.</param>
+		explicit Scope(const std::string& name);
+
+		/// <summary>
+		/// Starts a scope nested into the given node, inactive if it is <c>nullptr</c>.
+		/// </summary>
+		/// <remarks>
+		/// Used to attribute work executed on other threads.
+		/// </remarks>
+		/// <param name="parent">The parent node, in most cases the <see cref="Metrics::current" /> of another thread.</param>
+		/// <param name="name">The name of the scope.</param>
+		Scope(OperationMetrics* parent, const std::string& name);
+
+		/// <summary>
+		/// Finishes the scope.
+		/// </summary>
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		void start(OperationMetrics* parent, const std::string& name);
+	};
+
+	/// <summary>
+	/// Determines whether metrics are recorded on the current thread.
+	/// </summary>
+	static bool isRecording() { return current() != nullptr; }
+
+	/// <summary>
+	/// Gets the current scope of the thread.
+	/// </summary>
+	/// <returns>The current node or <c>nullptr</c> if not recording.</returns>
+	static OperationMetrics* current();
+
+	/// <summary>
+	/// Adds bytes read to the current scope.
+	/// </summary>
+	static void addRead(std::uint64_t bytes);
+
+	/// <summary>
+	/// Adds bytes written to the current scope.
+	/// </summary>
+	static void addWritten(std::uint64_t bytes);
+
+	/// <summary>
+	/// Adds computed pixels to the current scope.
+	/// </summary>
+	static void addPixels(std::uint64_t pixels);
+
+	/// <summary>
+	/// Gets the peak resident memory of the process in bytes.
+	/// </summary>
+	static std::size_t peakMemory();
+
+	/// <summary>
+	/// Gets the current resident memory of the process in bytes.
+	/// </summary>
+	static std::size_t residentMemory();
+
+	/// <summary>
+	/// Gets the CPU time of the current thread in seconds.
+	/// </summary>
+	static double threadCpuTime();
+
+private:
+	friend class MetricsRecorder;
+
+	/// <summary>
+	/// Finishes a node and adds its counters to its parent.
+	/// </summary>
+	static void finish(OperationMetrics* node, OperationMetrics* parent,
+	                   std::chrono::steady_clock::time_point wallStart, double cpuStart,
+	                   std::size_t memoryStart);
+};
+
+/// <summary>
+/// Records the metrics of the operations executed on the thread during its lifetime.
+/// </summary>
+class MetricsRecorder
+{
+private:
+	OperationMetrics _root;
+	std::chrono::steady_clock::time_point _wallStart;
+	double _cpuStart;
+	std::size_t _memoryStart;
+	bool _isFinished = false;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class and starts recording.
+	/// </summary>
+	/// <param name="name">The name of the recording, in most cases the name of the tile.</param>
+	explicit MetricsRecorder(const std::string& name);
+
+	/// <summary>
+	/// Stops recording if not stopped yet.
+	/// </summary>
+	~MetricsRecorder();
+
+	MetricsRecorder(const MetricsRecorder&) = delete;
+	MetricsRecorder& operator=(const MetricsRecorder&) = delete;
+
+	/// <summary>
+	/// Stops recording.
+	/// </summary>
+	/// <remarks>
+	/// The recorders of a thread should be stopped in the reverse order of their creation.
+	/// </remarks>
+	void stop();
+
+	/// <summary>
+	/// Gets the recorded metrics.
+	/// </summary>
+	const OperationMetrics& metrics() const { return _root; }
+
+	/// <summary>
+	/// Writes the recorded metrics into a JSON file.
+	/// </summary>
+	/// <param name="path">The path of the file.</param>
+	void writeJson(const std::string& path) const;
+};
+
+/// <summary>
+/// Represents an aggregation of operation metrics over multiple recordings.
+/// </summary>
+/// <remarks>
+/// Scopes are aggregated by their path in the tree, e.g. <c>Process / noise / NoiseFilter</c>.
+/// The peak memory is recorded once for each process adding recordings to the summary.
+/// </remarks>
+class MetricsSummary
+{
+public:
+	/// <summary>
+	/// Represents the aggregated metrics of a scope.
+	/// </summary>
+	/// <remarks>
+	/// The peak memory and the memory growth are the largest ones of the aggregated scopes,
+	/// the other fields are totals. The critical count is the number of aggregated scopes
+	/// on the critical path of their operation graph.
+	/// </remarks>
+	struct Entry
+	{
+		std::uint64_t count = 0;
+		double wallTime = 0;
+		double cpuTime = 0;
+		std::uint64_t bytesRead = 0;
+		std::uint64_t bytesWritten = 0;
+		std::uint64_t pixels = 0;
+		std::size_t peakMemory = 0;
+		std::int64_t memoryGrowth = 0;
+		std::uint64_t criticalCount = 0;
+	};
+
+private:
+	std::uint64_t _recordings = 0;
+	std::size_t _peakMemory = 0;
+	std::map<std::string, Entry> _entries;
+
+public:
+	/// <summary>
+	/// Adds a recording to the summary.
+	/// </summary>
+	/// <param name="metrics">The root of the recording, its name is not part of the paths.</param>
+	void add(const OperationMetrics& metrics);
+
+	/// <summary>
+	/// Merges another summary into this one.
+	/// </summary>
+	void merge(const MetricsSummary& other);
+
+	/// <summary>
+	/// Gets the aggregated scopes by their path.
+	/// </summary>
+	const std::map<std::string, Entry>& entries() const { return _entries; }
+
+	/// <summary>
+	/// Gets the largest peak resident memory of the processes in bytes.
+	/// </summary>
+	std::size_t peakMemory() const { return _peakMemory; }
+
+	/// <summary>
+	/// Serializes the summary into a compact text, e.g. for message passing.
+	/// </summary>
+	std::string serialize() const;
+
+	/// <summary>
+	/// Deserializes a summary created by <see cref="serialize" />.
+	/// </summary>
+	static MetricsSummary deserialize(const std::string& data);
+
+	/// <summary>
+	/// Writes the summary into a JSON file.
+	/// </summary>
+	/// <param name="path">The path of the file.</param>
+	void writeJson(const std::string& path) const;
+
+private:
+	void add(const OperationMetrics& metrics, const std::string& prefix, bool isCritical);
+};
+} // CloudTools
@@ -1,4 +1,11 @@
+#include <typeinfo>
+#include <regex>
+
+#include <boost/core/demangle.hpp>
+
 #include "Operation.h"
+#include "Metrics.h"
+#include "Trace.h"
 
 namespace CloudTools
 {
@@ -17,6 +24,14 @@ void Operation::prepare(bool force)
 
 void Operation::execute(bool force)
 {
+	// Named without namespace qualifiers, only when recording metrics or tracing
+	static const std::regex qualifier("[A-Za-z_][A-Za-z0-9_]*::");
+	std::string name = Metrics::isRecording() || Trace::isEnabled()
+		? std::regex_replace(boost::core::demangle(typeid(*this).name()), qualifier, "")
+		: std::string();
+	Metrics::Scope scope(name);
+	Trace::Span span("operation", name);
+
 	prepare(force);
 	if (!_isExecuted || force)
 	{
@@ -41,6 +41,10 @@ public:
 	/// <summary>
 	/// Executes the operation.
 	/// </summary>
+	/// <remarks>
+	/// The performance metrics of the execution are collected when a <see cref="MetricsRecorder" /> is active.
+	/// The execution is recorded on the timeline when <see cref="Trace" /> is enabled.
+	/// </remarks>
 	/// <param name="force">Forces reevaluation if necessary.</param>
 	void execute(bool force = false);
 
@@ -0,0 +1,255 @@
+#include <limits>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+
+#include "OperationGraph.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+namespace CloudTools
+{
+namespace
+{
+const std::size_t NoProducer = std::numeric_limits<std::size_t>::max();
+}
+
+OperationGraph::OperationGraph(std::size_t threadCount)
+	: _ownPool(new ThreadPool(threadCount)), _pool(_ownPool.get())
+{ }
+
+OperationGraph::OperationGraph(ThreadPool& pool)
+	: _pool(&pool)
+{ }
+
+void OperationGraph::addNode(const std::string& name,
+                             const std::vector<std::string>& inputs,
+                             const std::vector<std::string>& outputs,
+                             TaskType task)
+{
+	if (_nodeIndexes.count(name))
+		throw std::invalid_argument("A node with the given name already exists.");
+	if (!task)
+		throw std::invalid_argument("No task defined for the node.");
+
+	Node node;
+	node.name = name;
+	node.inputs = inputs;
+	node.outputs = outputs;
+	node.task = std::move(task);
+
+	_nodeIndexes[name] = _nodes.size();
+	_nodes.push_back(std::move(node));
+}
+
+void OperationGraph::addNode(const std::string& name,
+                             const std::vector<std::string>& inputs,
+                             const std::vector<std::string>& outputs,
+                             Operation& operation)
+{
+	addNode(name, inputs, outputs, [&operation]() { operation.execute(); });
+}
+
+void OperationGraph::setRelease(const std::string& data, ReleaseType release)
+{
+	_data[data].release = std::move(release);
+}
+
+double OperationGraph::duration(const std::string& node) const
+{
+	auto it = _nodeIndexes.find(node);
+	if (it == _nodeIndexes.end())
+		throw std::out_of_range("No node found with the given name.");
+	return _nodes[it->second].duration;
+}
+
+const std::vector<std::string>& OperationGraph::criticalPath() const
+{
+	if (!isExecuted())
+		throw std::logic_error("The operation is not executed.");
+	return _criticalPath;
+}
+
+double OperationGraph::criticalPathDuration() const
+{
+	if (!isExecuted())
+		throw std::logic_error("The operation is not executed.");
+	return _criticalPathDuration;
+}
+
+void OperationGraph::onPrepare()
+{
+	// Resolve producers and consumers
+	for (auto& item : _data)
+	{
+		item.second.producer = NoProducer;
+		item.second.consumers = 0;
+	}
+	for (std::size_t i = 0; i < _nodes.size(); ++i)
+	{
+		_nodes[i].successors.clear();
+		_nodes[i].predecessors.clear();
+		for (const std::string& output : _nodes[i].outputs)
+		{
+			Data& data = _data[output];
+			if (data.producer != NoProducer)
+				throw std::logic_error("The data '" + output + "' is produced by multiple nodes.");
+			data.producer = i;
+		}
+	}
+	for (std::size_t i = 0; i < _nodes.size(); ++i)
+		for (const std::string& input : _nodes[i].inputs)
+		{
+			Data& data = _data[input];
+			++data.consumers;
+			if (data.producer != NoProducer)
+			{
+				_nodes[data.producer].successors.push_back(i);
+				_nodes[i].predecessors.push_back(data.producer);
+			}
+		}
+
+	// Topological ordering
+	std::vector<std::size_t> pending(_nodes.size());
+	_order.clear();
+	for (std::size_t i = 0; i < _nodes.size(); ++i)
+	{
+		pending[i] = _nodes[i].predecessors.size();
+		if (pending[i] == 0)
+			_order.push_back(i);
+	}
+	for (std::size_t i = 0; i < _order.size(); ++i)
+		for (std::size_t successor : _nodes[_order[i]].successors)
+			if (--pending[successor] == 0)
+				_order.push_back(successor);
+
+	if (_order.size() != _nodes.size())
+		throw std::logic_error("The operation graph contains a cycle.");
+}
+
+void OperationGraph::onExecute()
+{
+	std::mutex mutex;
+	std::condition_variable finished;
+	std::size_t running = 0;
+	std::size_t completed = 0;
+	std::exception_ptr error;
+
+	// The nodes are attributed to the graph, regardless of the executing thread.
+	OperationMetrics* metrics = Metrics::current();
+
+	std::vector<std::size_t> pending(_nodes.size());
+	std::map<std::string, std::size_t> consumers;
+	for (std::size_t i = 0; i < _nodes.size(); ++i)
+	{
+		pending[i] = _nodes[i].predecessors.size();
+		_nodes[i].duration = 0;
+	}
+	for (const auto& item : _data)
+		consumers[item.first] = item.second.consumers;
+
+	// Schedules a node, must be called while holding the lock.
+	std::function<void(std::size_t)> schedule = [&](std::size_t index)
+	{
+		++running;
+		_pool->submit([&, index]()
+		{
+			Node& node = _nodes[index];
+			auto start = std::chrono::steady_clock::now();
+			try
+			{
+				Metrics::Scope scope(metrics, node.name);
+				Trace::Span span("node", node.name);
+				node.task();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error)
+					error = std::current_exception();
+			}
+			node.duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			// Release the inputs not consumed anymore
+			std::vector<ReleaseType> releases;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (const std::string& input : node.inputs)
+					if (--consumers[input] == 0 && _data[input].release)
+						releases.push_back(_data[input].release);
+			}
+			for (ReleaseType& release : releases)
+			{
+				try
+				{
+					release();
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!error)
+						error = std::current_exception();
+				}
+			}
+
+			// Schedule the successors which became ready
+			std::lock_guard<std::mutex> lock(mutex);
+			++completed;
+			if (!error)
+			{
+				for (std::size_t successor : node.successors)
+					if (--pending[successor] == 0)
+						schedule(successor);
+
+				if (progress)
+					progress(1.f * completed / _nodes.size(), node.name);
+			}
+			--running;
+			finished.notify_all();
+		});
+	};
+
+	std::unique_lock<std::mutex> lock(mutex);
+	for (std::size_t i = 0; i < _nodes.size(); ++i)
+		if (pending[i] == 0)
+			schedule(i);
+	finished.wait(lock, [&running] { return running == 0; });
+
+	if (error)
+		std::rethrow_exception(error);
+	computeCriticalPath();
+	if (metrics != nullptr)
+	{
+		metrics->criticalPath = _criticalPath;
+		metrics->criticalPathDuration = _criticalPathDuration;
+	}
+}
+
+void OperationGraph::computeCriticalPath()
+{
+	std::vector<double> finish(_nodes.size(), 0);
+	std::vector<std::size_t> previous(_nodes.size(), NoProducer);
+	std::size_t last = NoProducer;
+
+	for (std::size_t index : _order)
+	{
+		const Node& node = _nodes[index];
+		for (std::size_t predecessor : node.predecessors)
+			if (previous[index] == NoProducer || finish[predecessor] > finish[previous[index]])
+				previous[index] = predecessor;
+
+		finish[index] = node.duration + (previous[index] != NoProducer ? finish[previous[index]] : 0);
+		if (last == NoProducer || finish[index] > finish[last])
+			last = index;
+	}
+
+	_criticalPath.clear();
+	_criticalPathDuration = last != NoProducer ? finish[last] : 0;
+	for (std::size_t index = last; index != NoProducer; index = previous[index])
+		_criticalPath.push_back(_nodes[index].name);
+	std::reverse(_criticalPath.begin(), _criticalPath.end());
+}
+} // CloudTools
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <limits>
+#include <memory>
+#include <functional>
+
+#include "Operation.h"
+#include "ThreadPool.h"
+
+namespace CloudTools
+{
+/// <summary>
+/// Represents a dependency graph of operations, executed on a thread pool.
+/// </summary>
+/// <remarks>
+/// Each node declares the named data it consumes and produces. A node is scheduled as soon as
+/// all of its inputs are produced, so independent nodes are executed concurrently.
+/// Inputs not produced by any node are considered to be available in advance.
+/// An intermediate data is released right after its last consumer has finished.
+/// </remarks>
+class OperationGraph : public Operation
+{
+public:
+	typedef std::function<void()> TaskType;
+	typedef std::function<void()> ReleaseType;
+
+	/// <summary>
+	/// Callback function for reporting progress.
+	/// </summary>
+	/// <remarks>
+	/// Reports the ratio of finished nodes with the name of the last finished node.
+	/// Calls are serialized, but may come from any of the worker threads.
+	/// </remarks>
+	ProgressType progress;
+
+private:
+	struct Node
+	{
+		std::string name;
+		std::vector<std::string> inputs;
+		std::vector<std::string> outputs;
+		TaskType task;
+		std::vector<std::size_t> successors;
+		std::vector<std::size_t> predecessors;
+		double duration = 0;
+	};
+
+	struct Data
+	{
+		std::size_t producer = std::numeric_limits<std::size_t>::max();
+		std::size_t consumers = 0;
+		ReleaseType release;
+	};
+
+	std::vector<Node> _nodes;
+	std::map<std::string, std::size_t> _nodeIndexes;
+	std::map<std::string, Data> _data;
+	std::vector<std::size_t> _order;
+
+	std::unique_ptr<ThreadPool> _ownPool;
+	ThreadPool* _pool;
+
+	std::vector<std::string> _criticalPath;
+	double _criticalPathDuration = 0;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class with its own thread pool.
+	/// </summary>
+	/// <param name="threadCount">The number of worker threads.</param>
+	explicit OperationGraph(std::size_t threadCount = std::thread::hardware_concurrency());
+
+	/// <summary>
+	/// Initializes a new instance of the class on a shared thread pool.
+	/// </summary>
+	/// <remarks>
+	/// The nodes must not wait for other tasks of the same pool, otherwise the pool may be exhausted.
+	/// </remarks>
+	/// <param name="pool">The thread pool to execute the nodes on.</param>
+	explicit OperationGraph(ThreadPool& pool);
+
+	OperationGraph(const OperationGraph&) = delete;
+	OperationGraph& operator=(const OperationGraph&) = delete;
+
+	/// <summary>
+	/// Adds a new node to the graph.
+	/// </summary>
+	/// <param name="name">The unique name of the node.</param>
+	/// <param name="inputs">The names of the consumed data.</param>
+	/// <param name="outputs">The names of the produced data.</param>
+	/// <param name="task">The callback function producing the outputs.</param>
+	void addNode(const std::string& name,
+	             const std::vector<std::string>& inputs,
+	             const std::vector<std::string>& outputs,
+	             TaskType task);
+
+	/// <summary>
+	/// Adds a new node to the graph executing an existing operation.
+	/// </summary>
+	/// <param name="name">The unique name of the node.</param>
+	/// <param name="inputs">The names of the consumed data.</param>
+	/// <param name="outputs">The names of the produced data.</param>
+	/// <param name="operation">The operation producing the outputs, must outlive the graph execution.</param>
+	void addNode(const std::string& name,
+	             const std::vector<std::string>& inputs,
+	             const std::vector<std::string>& outputs,
+	             Operation& operation);
+
+	/// <summary>
+	/// Defines how to release a data when it is not consumed anymore.
+	/// </summary>
+	/// <remarks>
+	/// Data without a release callback (e.g. final results) are kept.
+	/// </remarks>
+	/// <param name="data">The name of the data.</param>
+	/// <param name="release">The callback function releasing the data.</param>
+	void setRelease(const std::string& data, ReleaseType release);
+
+	/// <summary>
+	/// Gets the wall clock duration of a node in seconds.
+	/// </summary>
+	/// <param name="node">The name of the node.</param>
+	double duration(const std::string& node) const;
+
+	/// <summary>
+	/// Gets the node names along the critical path of the last execution.
+	/// </summary>
+	/// <remarks>
+	/// The critical path is the chain of dependent nodes with the largest total duration,
+	/// which bounds the execution time regardless of the number of threads.
+	/// It is also recorded into the metrics of the graph when a <see cref="MetricsRecorder" /> is active.
+	/// </remarks>
+	const std::vector<std::string>& criticalPath() const;
+
+	/// <summary>
+	/// Gets the total duration of the critical path of the last execution in seconds.
+	/// </summary>
+	double criticalPathDuration() const;
+
+protected:
+	/// <summary>
+	/// Verifies that the graph is acyclic and each data has at most one producer.
+	/// </summary>
+	void onPrepare() override;
+
+	/// <summary>
+	/// Executes the nodes in dependency order.
+	/// </summary>
+	void onExecute() override;
+
+private:
+	void computeCriticalPath();
+};
+} // CloudTools
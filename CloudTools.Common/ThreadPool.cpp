@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "ThreadPool.h"
+
+namespace CloudTools
+{
+ThreadPool::ThreadPool(std::size_t threadCount)
+{
+	threadCount = std::max<std::size_t>(1, threadCount);
+	_workers.reserve(threadCount);
+	for (std::size_t i = 0; i < threadCount; ++i)
+		_workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_isStopping = true;
+	}
+	_condition.notify_all();
+
+	for (std::thread& worker : _workers)
+		worker.join();
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+	auto packagedTask = std::make_shared<std::packaged_task<void()>>(std::move(task));
+	std::future<void> future = packagedTask->get_future();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_isStopping)
+			throw std::logic_error("Cannot submit a task to a stopping thread pool.");
+		_tasks.emplace([packagedTask]() { (*packagedTask)(); });
+	}
+	_condition.notify_one();
+	return future;
+}
+
+void ThreadPool::work()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this] { return _isStopping || !_tasks.empty(); });
+			if (_tasks.empty())
+				return;
+
+			task = std::move(_tasks.front());
+			_tasks.pop();
+		}
+		task();
+	}
+}
+} // CloudTools
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+
+namespace CloudTools
+{
+/// <summary>
+/// Represents a fixed size pool of worker threads executing queued tasks.
+/// </summary>
+class ThreadPool
+{
+private:
+	std::vector<std::thread> _workers;
+	std::queue<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	bool _isStopping = false;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class and starts the worker threads.
+	/// </summary>
+	/// <param name="threadCount">The number of worker threads, at least 1.</param>
+	explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency());
+
+	/// <summary>
+	/// Finishes the queued tasks and stops the worker threads.
+	/// </summary>
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// <summary>
+	/// Gets the number of worker threads.
+	/// </summary>
+	std::size_t size() const { return _workers.size(); }
+
+	/// <summary>
+	/// Queues a task for execution.
+	/// </summary>
+	/// <param name="task">The task to execute.</param>
+	/// <returns>The future of the task, which rethrows the exception of the task (if any).</returns>
+	std::future<void> submit(std::function<void()> task);
+
+private:
+	void work();
+};
+} // CloudTools
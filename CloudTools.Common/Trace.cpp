@@ -0,0 +1,207 @@
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+#include "IO/IO.h"
+#include "Trace.h"
+
+namespace CloudTools
+{
+namespace
+{
+/// <summary>
+/// Represents a recorded event.
+/// </summary>
+struct Event
+{
+	char phase;
+	const char* category;
+	std::string name;
+	std::int64_t timestamp;
+	std::int64_t duration;
+	std::string detail;
+};
+
+/// <summary>
+/// Represents the event buffer of a thread.
+/// </summary>
+/// <remarks>
+/// The lock of the buffer is only contended while the events are formatted.
+/// </remarks>
+struct ThreadBuffer
+{
+	int id = 0;
+	std::string name;
+	std::mutex mutex;
+	std::vector<Event> events;
+};
+
+std::atomic<bool> isTracing(false);
+std::int64_t systemStart = 0;
+std::chrono::steady_clock::time_point steadyStart;
+
+/// <summary>
+/// The buffers of all threads ever traced, they outlive their threads to be flushed at exit.
+/// </summary>
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+thread_local ThreadBuffer* threadBuffer = nullptr;
+
+ThreadBuffer& currentBuffer()
+{
+	if (threadBuffer == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		registry.emplace_back(new ThreadBuffer());
+		threadBuffer = registry.back().get();
+		threadBuffer->id = static_cast<int>(registry.size());
+	}
+	return *threadBuffer;
+}
+}
+
+#pragma region Span
+
+Trace::Span::Span(const char* category, const std::string& name, const std::string& detail)
+	: _category(category), _start(0), _isActive(Trace::isEnabled())
+{
+	if (!_isActive)
+		return;
+	_name = name;
+	_detail = detail;
+	_start = Trace::now();
+}
+
+Trace::Span::~Span()
+{
+	if (_isActive)
+		Trace::complete(_category, _name, _start, _detail);
+}
+
+#pragma endregion
+
+#pragma region Trace
+
+void Trace::start()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (auto& buffer : registry)
+	{
+		std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+		buffer->events.clear();
+	}
+
+	systemStart = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	steadyStart = std::chrono::steady_clock::now();
+	isTracing = true;
+}
+
+void Trace::stop()
+{
+	isTracing = false;
+}
+
+bool Trace::isEnabled()
+{
+	return isTracing.load(std::memory_order_relaxed);
+}
+
+std::int64_t Trace::now()
+{
+	return systemStart + std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - steadyStart).count();
+}
+
+void Trace::complete(const char* category, const std::string& name, std::int64_t start, const std::string& detail)
+{
+	if (isEnabled())
+		record('X', category, name, start, now() - start, detail);
+}
+
+void Trace::instant(const char* category, const std::string& name, const std::string& detail)
+{
+	if (isEnabled())
+		record('i', category, name, now(), 0, detail);
+}
+
+void Trace::setThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = currentBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.name = name;
+}
+
+void Trace::record(char phase, const char* category, const std::string& name,
+                   std::int64_t timestamp, std::int64_t duration, const std::string& detail)
+{
+	ThreadBuffer& buffer = currentBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.events.push_back({ phase, category, name, timestamp, duration, detail });
+}
+
+std::string Trace::events(int processId)
+{
+	std::ostringstream out;
+	out << "{ \"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << processId
+	    << ", \"args\": { \"name\": \"Process #" << processId << "\" } }";
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (auto& buffer : registry)
+	{
+		std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+		if (!buffer->name.empty())
+			out << ",\n{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << processId
+			    << ", \"tid\": " << buffer->id
+			    << ", \"args\": { \"name\": \"" << IO::escapeJson(buffer->name) << "\" } }";
+
+		for (const Event& event : buffer->events)
+		{
+			out << ",\n{ \"name\": \"" << IO::escapeJson(event.name) << "\""
+			    << ", \"cat\": \"" << event.category << "\""
+			    << ", \"ph\": \"" << event.phase << "\""
+			    << ", \"ts\": " << event.timestamp;
+			if (event.phase == 'X')
+				out << ", \"dur\": " << event.duration;
+			else
+				out << ", \"s\": \"t\"";
+			out << ", \"pid\": " << processId << ", \"tid\": " << buffer->id;
+			if (!event.detail.empty())
+				out << ", \"args\": { \"detail\": \"" << IO::escapeJson(event.detail) << "\" }";
+			out << " }";
+		}
+	}
+	return out.str();
+}
+
+void Trace::writeJson(const std::string& path, int processId)
+{
+	writeJson(path, std::vector<std::string>{ events(processId) });
+}
+
+void Trace::writeJson(const std::string& path, const std::vector<std::string>& events)
+{
+	std::ofstream out(path);
+	out << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	bool isFirst = true;
+	for (const std::string& item : events)
+	{
+		if (item.empty())
+			continue;
+		if (!isFirst)
+			out << ",\n";
+		out << item;
+		isFirst = false;
+	}
+	out << "\n] }" << std::endl;
+	if (!out)
+		throw std::runtime_error("Failed to write the trace.");
+}
+
+#pragma endregion
+} // CloudTools
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace CloudTools
+{
+/// <summary>
+/// Represents a timeline of the events of all threads in the Chrome trace event format.
+/// </summary>
+/// <remarks>
+/// The events are recorded into buffers owned by their threads, only the first event of a thread
+/// is synchronized with the others. Nothing is recorded until tracing is started, so the
+/// instrumentation can remain in place, and tracing is cheap enough to keep on in production runs.
+/// The written files can be opened with chrome://tracing or https://ui.perfetto.dev.
+/// </remarks>
+class Trace
+{
+public:
+	/// <summary>
+	/// The number of rows of a sweep line computation traced as a single event.
+	/// </summary>
+	static const int RowBatch = 256;
+
+	/// <summary>
+	/// Represents an event spanning the lifetime of the object.
+	/// </summary>
+	class Span
+	{
+	private:
+		const char* _category;
+		std::string _name;
+		std::string _detail;
+		std::int64_t _start;
+		bool _isActive;
+
+	public:
+		/// <summary>
+		/// Starts an event, inactive if tracing is not enabled.
+		/// </summary>
+		/// <param name="category">The category of the event, e.g. <c>"operation"</c> or <c>"io"</c>.</param>
+		/// <param name="name">The name of the event.</param>
+		/// <param name="detail">Optional description of the event.</param>
+		Span(const char* category, const std::string& name, const std::string& detail = std::string());
+
+		/// <summary>
+		/// Finishes the event.
+		/// </summary>
+		~Span();
+
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+	};
+
+	/// <summary>
+	/// Starts tracing and discards the previously recorded events.
+	/// </summary>
+	static void start();
+
+	/// <summary>
+	/// Stops tracing, the recorded events are kept.
+	/// </summary>
+	static void stop();
+
+	/// <summary>
+	/// Determines whether tracing is enabled.
+	/// </summary>
+	static bool isEnabled();
+
+	/// <summary>
+	/// Gets the current time of the timeline in microseconds.
+	/// </summary>
+	/// <remarks>
+	/// Based on the system clock at the start of tracing, so the timelines of processes on synchronized hosts can be merged.
+	/// </remarks>
+	static std::int64_t now();
+
+	/// <summary>
+	/// Records an event from the given time until now.
+	/// </summary>
+	/// <param name="category">The category of the event.</param>
+	/// <param name="name">The name of the event.</param>
+	/// <param name="start">The start time of the event, see <see cref="now" />.</param>
+	/// <param name="detail">Optional description of the event.</param>
+	static void complete(const char* category, const std::string& name, std::int64_t start,
+	                     const std::string& detail = std::string());
+
+	/// <summary>
+	/// Records an instant event.
+	/// </summary>
+	/// <param name="category">The category of the event.</param>
+	/// <param name="name">The name of the event.</param>
+	/// <param name="detail">Optional description of the event.</param>
+	static void instant(const char* category, const std::string& name,
+	                    const std::string& detail = std::string());
+
+	/// <summary>
+	/// Names the current thread on the timeline.
+	/// </summary>
+	static void setThreadName(const std::string& name);
+
+	/// <summary>
+	/// Formats the recorded events of all threads.
+	/// </summary>
+	/// <remarks>
+	/// The result is a comma separated list of JSON objects, which can be merged with the events of other processes.
+	/// </remarks>
+	/// <param name="processId">The identifier of the process on the timeline, e.g. the MPI rank.</param>
+	/// <returns>The events in the Chrome trace event format.</returns>
+	static std::string events(int processId = 0);
+
+	/// <summary>
+	/// Writes the recorded events of all threads into a JSON file.
+	/// </summary>
+	/// <param name="path">The path of the file.</param>
+	/// <param name="processId">The identifier of the process on the timeline.</param>
+	static void writeJson(const std::string& path, int processId = 0);
+
+	/// <summary>
+	/// Writes the events of multiple processes into a single JSON file.
+	/// </summary>
+	/// <param name="path">The path of the file.</param>
+	/// <param name="events">The events of the processes, as returned by <see cref="events" />.</param>
+	static void writeJson(const std::string& path, const std::vector<std::string>& events);
+
+private:
+	static void record(char phase, const char* category, const std::string& name,
+	                   std::int64_t timestamp, std::int64_t duration, const std::string& detail);
+};
+} // CloudTools
@@ -5,6 +5,14 @@
 #include <utility>
 #include <stdexcept>
 #include <cstdint>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <future>
+#include <exception>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
@@ -12,8 +20,10 @@
 
 #include <CloudTools.Common/IO/IO.h>
 #include <CloudTools.Common/IO/Reporter.h>
+#include <CloudTools.Common/IO/TileCatalog.h>
 #include <CloudTools.DEM/Metadata.h>
 #include <CloudTools.DEM/Rasterize.h>
+#include <CloudTools.DEM/ScanlineFill.h>
 #include <CloudTools.DEM/SweepLineTransformation.hpp>
 #include <CloudTools.DEM/Window.hpp>
 
@@ -23,8 +33,60 @@ namespace fs = boost::filesystem;
 using namespace CloudTools::DEM;
 using namespace CloudTools::IO;
 
+/// <summary>
+/// Represents the settings of the masked outputs.
+/// </summary>
+struct MaskSettings
+{
+	std::string outputFormat;
+	std::map<std::string, std::string> createOptions;
+	bool hasNodataValue = false;
+	double nodataValue = 0;
+	std::string spatialReference;
+	bool invert = false;
+};
+
+/// <summary>
+/// Masks multiple rasters concurrently, the mask is burned in memory once for each distinct grid.
+/// </summary>
+/// <param name="inputPaths">The paths of the rasters.</param>
+/// <param name="outputDir">The directory of the outputs, named after the inputs.</param>
+/// <param name="maskVectorPath">The path of the vector mask.</param>
+/// <param name="maskLayers">The layers of the vector mask, the single layer if empty.</param>
+/// <param name="settings">The settings of the outputs.</param>
+/// <param name="maxJobs">The number of rasters processed simultaneously.</param>
+/// <param name="verbose">Whether the processed rasters are listed.</param>
+/// <param name="reporter">The reporter of progress, <c>nullptr</c> for no progress output.</param>
+/// <returns>The exit code.</returns>
+int processBatch(const std::vector<std::string>& inputPaths, const std::string& outputDir,
+                 const std::string& maskVectorPath, const std::vector<std::string>& maskLayers,
+                 const MaskSettings& settings, unsigned short maxJobs, bool verbose, Reporter* reporter);
+
+/// <summary>
+/// Burns a vector mask onto the grid of a raster.
+/// </summary>
+/// <param name="maskVectorPath">The path of the vector mask.</param>
+/// <param name="maskLayers">The layers of the vector mask, the single layer if empty.</param>
+/// <param name="grid">The grid of the raster.</param>
+/// <returns>The row-major mask, non-zero for the pixels inside the mask.</returns>
+std::vector<GByte> burnMask(const std::string& maskVectorPath, const std::vector<std::string>& maskLayers,
+                            const RasterMetadata& grid);
+
+/// <summary>
+/// Applies an in-memory mask on a raster.
+/// </summary>
+/// <param name="inputPath">The path of the raster.</param>
+/// <param name="outputPath">The path of the output.</param>
+/// <param name="mask">The mask burned onto the grid of the raster.</param>
+/// <param name="settings">The settings of the output.</param>
+template <typename DataType>
+void applyMask(const std::string& inputPath, const std::string& outputPath,
+               const std::vector<GByte>& mask, const MaskSettings& settings);
+
 int main(int argc, char* argv[]) try
 {
+	std::vector<std::string> inputPaths;
+	std::string inputPattern = ".*\\.tif";
 	std::string inputPath;
 	std::string outputPath = (fs::current_path() / "out.tif").string();
 	std::string outputFormat;
@@ -35,10 +97,17 @@ int main(int argc, char* argv[]) try
 	std::string maskRasterPath = (fs::current_path() / fs::unique_path()).replace_extension("tif").string();
 	short maskValue;
 
+	std::string outputDir = fs::current_path().string();
+	unsigned short maxJobs = std::thread::hardware_concurrency();
+
 	// Read console arguments
 	po::options_description desc("Allowed options");
 	desc.add_options()
-		("input-path,i", po::value<std::string>(&inputPath), "input path")
+		("input-path,i", po::value<std::vector<std::string>>(&inputPaths),
+			"input path(s);\n"
+			"multiple files or a directory are masked in batch mode")
+		("input-pattern", po::value<std::string>(&inputPattern)->default_value(inputPattern),
+			"file pattern for input directories (batch mode)")
 		("mask-vector,f", po::value<std::string>(&maskVectorPath), "vector mask path")
 		("mask-layer,l", po::value<std::vector<std::string>>(&maskLayers), "mask layer(s) name")
 		("mask-raster,r", po::value<std::string>(&maskRasterPath),
@@ -47,6 +116,10 @@ int main(int argc, char* argv[]) try
 		("mask-value", po::value<short>(&maskValue)->default_value(255),
 			"specifies the value for the raster mask generation")
 		("output-path,o", po::value<std::string>(&outputPath), "output path")
+		("output-dir", po::value<std::string>(&outputDir)->default_value(outputDir),
+			"output directory (batch mode)")
+		("jobs,j", po::value<unsigned short>(&maxJobs)->default_value(maxJobs),
+			"number of inputs masked simultaneously (batch mode)")
 		("output-format", po::value<std::string>(&outputFormat)->default_value("GTiff"),
 			"output format, supported formats:\n"
 			"http://www.gdal.org/formats_list.html")
@@ -69,6 +142,10 @@ int main(int argc, char* argv[]) try
 	// Post-processing arguments
 	if (vm.count("mask-raster"))
 		maskRasterPath = fs::path(maskRasterPath).replace_extension("tif").string();
+	bool isBatch = inputPaths.size() > 1 ||
+		(inputPaths.size() == 1 && fs::is_directory(inputPaths.front()));
+	if (!isBatch && !inputPaths.empty())
+		inputPath = inputPaths.front();
 
 	// Argument validation
 	if (vm.count("help"))
@@ -97,6 +174,39 @@ int main(int argc, char* argv[]) try
 		argumentError = true;
 	}
 
+	if (isBatch)
+	{
+		for (const std::string& path : inputPaths)
+			if (!fs::exists(path))
+			{
+				std::cerr << "Input path ('" << path << "') does not exist." << std::endl;
+				argumentError = true;
+			}
+
+		if (!vm.count("mask-vector") || vm.count("mask-raster"))
+		{
+			std::cerr << "In batch mode the mask must be given as a vector file only." << std::endl;
+			argumentError = true;
+		}
+
+		if (fs::exists(outputDir) && !fs::is_directory(outputDir))
+		{
+			std::cerr << "The given output path exists but not a directory." << std::endl;
+			argumentError = true;
+		}
+		else if (!fs::exists(outputDir) && !fs::create_directory(outputDir))
+		{
+			std::cerr << "Failed to create output directory." << std::endl;
+			argumentError = true;
+		}
+
+		if (maxJobs == 0)
+		{
+			std::cerr << "The number of jobs must be positive." << std::endl;
+			argumentError = true;
+		}
+	}
+
 	if (argumentError)
 	{
 		std::cerr << "Use the --help option for description." << std::endl;
@@ -112,6 +222,48 @@ int main(int argc, char* argv[]) try
 		: static_cast<Reporter*>(new BarReporter());
 
 	GDALAllRegister();
+
+	MaskSettings settings;
+	settings.outputFormat = outputFormat;
+	settings.invert = vm.count("invert") > 0;
+	if (vm.count("nodata-value"))
+	{
+		settings.hasNodataValue = true;
+		settings.nodataValue = vm["nodata-value"].as<double>();
+	}
+	if (vm.count("srs"))
+		settings.spatialReference = vm["srs"].as<std::string>();
+	for (const std::string &option : outputOptions)
+	{
+		auto pos = std::find(option.begin(), option.end(), '=');
+		if (pos == option.end()) continue;
+		std::string key = option.substr(0, pos - option.begin());
+		std::string value = option.substr(pos - option.begin() + 1, option.end() - pos - 1);
+		settings.createOptions.insert(std::make_pair(key, value));
+	}
+
+	// Batch mode
+	if (isBatch)
+	{
+		std::vector<std::string> batchPaths;
+		for (const std::string& path : inputPaths)
+		{
+			if (fs::is_directory(path))
+			{
+				TileCatalog catalog(path, inputPattern);
+				for (const TileEntry& entry : catalog.entries())
+					batchPaths.push_back(entry.path);
+			}
+			else
+				batchPaths.push_back(path);
+		}
+
+		int result = processBatch(batchPaths, outputDir, maskVectorPath, maskLayers, settings, maxJobs,
+		                          vm.count("verbose") > 0, !vm.count("quiet") ? reporter : nullptr);
+		delete reporter;
+		return result;
+	}
+
 	if (!fs::exists(maskRasterPath) || vm.count("force"))
 	{
 		// Create the raster mask
@@ -256,17 +408,7 @@ int main(int argc, char* argv[]) try
 			return true;
 		};
 	}
-	if (vm.count("output-option"))
-	{
-		for (const std::string &option : outputOptions)
-		{
-			auto pos = std::find(option.begin(), option.end(), '=');
-			if (pos == option.end()) continue;
-			std::string key = option.substr(0, pos - option.begin());
-			std::string value = option.substr(pos - option.begin() + 1, option.end() - pos - 1);
-			mask->createOptions.insert(std::make_pair(key, value));
-		}
-	}
+	mask->createOptions = settings.createOptions;
 
 	// Prepare operation
 	mask->prepare();
@@ -316,3 +458,271 @@ catch (std::exception &ex)
 	std::cerr << "ERROR: " << ex.what() << std::endl;
 	return UnexcpectedError;
 }
+
+int processBatch(const std::vector<std::string>& inputPaths, const std::string& outputDir,
+                 const std::string& maskVectorPath, const std::vector<std::string>& maskLayers,
+                 const MaskSettings& settings, unsigned short maxJobs, bool verbose, Reporter* reporter)
+{
+	typedef std::tuple<double, double, double, double, int, int> GridKey;
+	typedef std::shared_future<std::shared_ptr<const std::vector<GByte>>> MaskFuture;
+
+	struct Input
+	{
+		std::string path;
+		RasterMetadata metadata;
+		GDALDataType dataType;
+		std::size_t grid;
+	};
+
+	struct GridMask
+	{
+		MaskFuture mask;
+		std::size_t remaining = 0;
+	};
+
+	std::size_t failures = 0;
+
+	// Inputs sharing an output name would overwrite each other's output
+	std::map<std::string, std::size_t> outputNames;
+	for (const std::string& path : inputPaths)
+		++outputNames[fs::path(path).filename().string()];
+
+	// Group the inputs by their grids
+	std::vector<Input> inputs;
+	std::map<GridKey, std::size_t> gridIndices;
+	std::vector<GridMask> masks;
+	for (const std::string& path : inputPaths)
+	{
+		if (outputNames[fs::path(path).filename().string()] > 1)
+		{
+			std::cerr << "ERROR: " << path << ": The output name is not unique in the batch." << std::endl;
+			++failures;
+			continue;
+		}
+
+		GDALDataset* dataset = static_cast<GDALDataset*>(GDALOpen(path.c_str(), GA_ReadOnly));
+		if (dataset == nullptr)
+		{
+			std::cerr << "ERROR: " << path << ": Error at opening the input file." << std::endl;
+			++failures;
+			continue;
+		}
+
+		Input input;
+		input.path = path;
+		input.metadata = RasterMetadata(dataset);
+		input.dataType = dataset->GetRasterBand(1)->GetRasterDataType();
+		GDALClose(dataset);
+
+		GridKey key(input.metadata.originX(), input.metadata.originY(),
+		            input.metadata.pixelSizeX(), input.metadata.pixelSizeY(),
+		            input.metadata.rasterSizeX(), input.metadata.rasterSizeY());
+		auto grid = gridIndices.find(key);
+		if (grid == gridIndices.end())
+		{
+			grid = gridIndices.emplace(key, masks.size()).first;
+			masks.emplace_back();
+		}
+		input.grid = grid->second;
+		++masks[input.grid].remaining;
+		inputs.push_back(std::move(input));
+	}
+	if (inputs.empty())
+	{
+		if (failures > 0)
+			return UnexcpectedError;
+		std::cerr << "No input files found." << std::endl;
+		return NoResult;
+	}
+
+	// Inputs of the same grid are processed after each other, so their mask is released early
+	std::stable_sort(inputs.begin(), inputs.end(),
+		[](const Input& a, const Input& b) { return a.grid < b.grid; });
+
+	std::atomic<std::size_t> nextInput(0);
+	std::atomic<std::size_t> counter(0);
+	std::mutex mutex;
+
+	auto maskInputs = [&]()
+	{
+		std::size_t index;
+		while ((index = nextInput++) < inputs.size())
+		{
+			const Input& input = inputs[index];
+			try
+			{
+				// The first input of a grid burns the mask, the others wait for it
+				std::promise<std::shared_ptr<const std::vector<GByte>>> promise;
+				MaskFuture future;
+				bool isBurning = false;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!masks[input.grid].mask.valid())
+					{
+						masks[input.grid].mask = promise.get_future().share();
+						isBurning = true;
+					}
+					future = masks[input.grid].mask;
+				}
+				if (isBurning)
+				{
+					try
+					{
+						promise.set_value(std::make_shared<const std::vector<GByte>>(
+							burnMask(maskVectorPath, maskLayers, input.metadata)));
+					}
+					catch (...)
+					{
+						promise.set_exception(std::current_exception());
+					}
+				}
+				std::shared_ptr<const std::vector<GByte>> mask = future.get();
+
+				fs::path outputPath = fs::path(outputDir) / fs::path(input.path).filename();
+				if (fs::exists(outputPath) && fs::equivalent(outputPath, input.path))
+					throw std::invalid_argument("The output would overwrite the input file.");
+
+				switch (input.dataType)
+				{
+				case GDALDataType::GDT_Int16:
+					applyMask<GInt16>(input.path, outputPath.string(), *mask, settings);
+					break;
+				case GDALDataType::GDT_Int32:
+					applyMask<GInt32>(input.path, outputPath.string(), *mask, settings);
+					break;
+				case GDALDataType::GDT_Float32:
+					applyMask<float>(input.path, outputPath.string(), *mask, settings);
+					break;
+				case GDALDataType::GDT_Float64:
+					applyMask<double>(input.path, outputPath.string(), *mask, settings);
+					break;
+				default:
+					// Unsigned and complex types are not supported.
+					throw std::runtime_error("Unsupported data type given.");
+				}
+
+				if (verbose)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					std::cout << "Masked: " << input.path << " -> " << outputPath.string() << std::endl;
+				}
+			}
+			catch (std::exception &ex)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				std::cerr << "ERROR: " << input.path << ": " << ex.what() << std::endl;
+				++failures;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--masks[input.grid].remaining == 0)
+					masks[input.grid].mask = MaskFuture();
+			}
+
+			std::size_t processed = ++counter;
+			if (reporter)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				reporter->report(processed * 1.f / inputs.size(), "Masking");
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned short i = 1; i < std::min<std::size_t>(maxJobs, inputs.size()); ++i)
+		workers.emplace_back(maskInputs);
+	maskInputs();
+	for (std::thread& worker : workers)
+		worker.join();
+
+	return failures > 0 ? UnexcpectedError : Success;
+}
+
+std::vector<GByte> burnMask(const std::string& maskVectorPath, const std::vector<std::string>& maskLayers,
+                            const RasterMetadata& grid)
+{
+	// The dataset is opened for each grid, as a GDAL dataset must not be accessed from multiple threads
+	std::shared_ptr<GDALDataset> maskDataset(
+		static_cast<GDALDataset*>(GDALOpenEx(maskVectorPath.c_str(), GDAL_OF_VECTOR, nullptr, nullptr, nullptr)),
+		[](GDALDataset* dataset) { if (dataset != nullptr) GDALClose(dataset); });
+	if (maskDataset == nullptr)
+		throw std::runtime_error("Error at opening the vector mask file.");
+
+	std::vector<OGRLayer*> layers;
+	for (const std::string& layerName : maskLayers)
+	{
+		OGRLayer* layer = maskDataset->GetLayerByName(layerName.c_str());
+		if (layer == nullptr)
+			throw std::invalid_argument("The selected layer does not exist.");
+		layers.push_back(layer);
+	}
+	if (layers.empty())
+	{
+		if (maskDataset->GetLayerCount() != 1)
+			throw std::invalid_argument("No layer selected and there are more than 1 layers.");
+		layers.push_back(maskDataset->GetLayer(0));
+	}
+
+	// Only polygons are burned by the scanline fill, other geometries would be skipped silently
+	auto isPolygon = [](OGRwkbGeometryType type)
+	{
+		type = wkbFlatten(type);
+		return type == wkbPolygon || type == wkbMultiPolygon;
+	};
+	for (OGRLayer* layer : layers)
+		if (layer->GetGeomType() != wkbUnknown && !isPolygon(layer->GetGeomType()))
+			throw std::invalid_argument("Only polygon mask layers are supported in batch mode.");
+
+	// Read the features within the grid
+	ScanlineFill fill(grid);
+	for (OGRLayer* layer : layers)
+	{
+		layer->SetSpatialFilterRect(grid.originX(), grid.originY() - grid.extentY(),
+		                            grid.originX() + grid.extentX(), grid.originY());
+		layer->ResetReading();
+
+		OGRFeature* feature;
+		while ((feature = layer->GetNextFeature()) != nullptr)
+		{
+			OGRGeometry* geometry = feature->GetGeometryRef();
+			if (geometry != nullptr && !isPolygon(geometry->getGeometryType()))
+			{
+				OGRFeature::DestroyFeature(feature);
+				throw std::invalid_argument("Only polygon mask layers are supported in batch mode.");
+			}
+			fill.add(geometry);
+			OGRFeature::DestroyFeature(feature);
+		}
+	}
+
+	std::vector<GByte> mask(static_cast<std::size_t>(grid.rasterSizeX()) * grid.rasterSizeY(), 0);
+	fill.burn(mask.data(), 0, grid.rasterSizeY(), std::vector<GByte>(fill.featureCount(), 1));
+	return mask;
+}
+
+template <typename DataType>
+void applyMask(const std::string& inputPath, const std::string& outputPath,
+               const std::vector<GByte>& mask, const MaskSettings& settings)
+{
+	SweepLineTransformation<DataType> transformation({ inputPath }, outputPath, nullptr);
+	transformation.targetFormat = settings.outputFormat;
+	transformation.createOptions = settings.createOptions;
+	if (settings.hasNodataValue)
+		transformation.nodataValue = settings.nodataValue;
+	if (!settings.spatialReference.empty())
+		transformation.spatialReference = settings.spatialReference;
+
+	transformation.prepare();
+	const std::size_t sizeX = static_cast<std::size_t>(transformation.targetMetadata().rasterSizeX());
+	const DataType nodataValue = static_cast<DataType>(transformation.nodataValue);
+	const bool invert = settings.invert;
+	transformation.computation = [&mask, sizeX, nodataValue, invert](int x, int y, const std::vector<Window<DataType>>& sources)
+	{
+		bool isInside = mask[y * sizeX + x] != 0;
+		return (invert ? !isInside : isInside) && sources[0].hasData()
+			? sources[0].data()
+			: nodataValue;
+	};
+	transformation.execute();
+}
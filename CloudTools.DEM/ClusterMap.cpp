@@ -286,6 +286,88 @@ void ClusterMap::shuffle()
 	}
 }
 
+void ClusterMap::write(std::ostream& stream) const
+{
+	auto writeValue = [&stream](const auto& value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	};
+	auto writePoint = [&writeValue](const OGRPoint& point)
+	{
+		writeValue(point.getX());
+		writeValue(point.getY());
+		writeValue(point.getZ());
+	};
+
+	writeValue(_sizeX);
+	writeValue(_sizeY);
+	writeValue(_nextClusterIndex);
+	writeValue(static_cast<GUInt64>(_clusterIndexes.size()));
+	for (const auto& item : _clusterIndexes)
+	{
+		writeValue(item.first);
+
+		auto seed = _seedPoints.find(item.first);
+		writeValue(static_cast<GByte>(seed != _seedPoints.end()));
+		if (seed != _seedPoints.end())
+			writePoint(seed->second);
+
+		writeValue(static_cast<GUInt64>(item.second.size()));
+		for (const OGRPoint& point : item.second)
+			writePoint(point);
+	}
+
+	if (!stream)
+		throw std::runtime_error("Cluster map write error occured.");
+}
+
+void ClusterMap::read(std::istream& stream)
+{
+	auto readValue = [&stream](auto& value)
+	{
+		stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+		if (!stream)
+			throw std::runtime_error("Cluster map read error occured.");
+	};
+	auto readPoint = [&readValue]()
+	{
+		double x, y, z;
+		readValue(x);
+		readValue(y);
+		readValue(z);
+		return OGRPoint(x, y, z);
+	};
+
+	_seedPoints.clear();
+	_clusterIndexes.clear();
+	_clusterPoints.clear();
+
+	GUInt64 clusterCount;
+	readValue(_sizeX);
+	readValue(_sizeY);
+	readValue(_nextClusterIndex);
+	readValue(clusterCount);
+	for (GUInt64 i = 0; i < clusterCount; ++i)
+	{
+		GUInt32 index;
+		GByte hasSeed;
+		readValue(index);
+		readValue(hasSeed);
+		if (hasSeed)
+			_seedPoints[index] = readPoint();
+
+		GUInt64 pointCount;
+		readValue(pointCount);
+		std::vector<OGRPoint>& points = _clusterIndexes[index];
+		points.reserve(pointCount);
+		for (GUInt64 j = 0; j < pointCount; ++j)
+		{
+			points.push_back(readPoint());
+			_clusterPoints[points.back()] = index;
+		}
+	}
+}
+
 std::random_device ClusterMap::rd;
 std::mt19937 ClusterMap::engine = std::mt19937(ClusterMap::rd());
 } // DEM
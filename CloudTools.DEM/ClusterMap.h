@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <map>
+#include <iostream>
 #include <unordered_map>
 #include <random>
 
@@ -178,6 +179,21 @@ public:
 	/// </summary>
 	void shuffle();
 
+	/// <summary>
+	/// Writes the cluster map into a binary stream.
+	/// </summary>
+	/// <param name="stream">The output stream.</param>
+	void write(std::ostream& stream) const;
+
+	/// <summary>
+	/// Reads the cluster map from a binary stream, replacing its current content.
+	/// </summary>
+	/// <remarks>
+	/// The cluster indexes and seed points are restored as written by <see cref="write" />.
+	/// </remarks>
+	/// <param name="stream">The input stream.</param>
+	void read(std::istream& stream);
+
 private:
 	static std::random_device rd;
 	static std::mt19937 engine;
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+#include <gdal_priv.h>
+#include <ogr_geometry.h>
+
+#include <CloudTools.Common/Metrics.h>
+
+#include "ClusterMap.h"
+#include "Metadata.h"
+#include "Helper.h"
+
+namespace fs = boost::filesystem;
+
+namespace CloudTools
+{
+namespace DEM
+{
+/// <summary>
+/// Represents a dense in-memory raster on which clusters are painted before written to a file.
+/// </summary>
+/// <remarks>
+/// The points of the clusters are painted in parallel, then the complete raster is written with a single I/O operation.
+/// </remarks>
+template <typename DataType>
+class ClusterRenderer
+{
+public:
+	/// <summary>
+	/// Target output format.
+	/// </summary>
+	/// <remarks>
+	/// For supported formats, <see cref="http://www.gdal.org/formats_list.html" />.
+	/// </remarks>
+	std::string targetFormat = "GTiff";
+
+	/// <summary>
+	/// Format specific output creation options.
+	/// </summary>
+	/// <remarks>
+	/// For supported options, <see cref="http://www.gdal.org/formats_list.html" />.
+	/// </remarks>
+	std::map<std::string, std::string> createOptions;
+
+	/// <summary>
+	/// The number of threads used for painting clusters.
+	/// </summary>
+	/// <remarks>
+	/// Default value 0 means the number of concurrent threads supported by the hardware.
+	/// </remarks>
+	unsigned int threadCount = 0;
+
+private:
+	RasterMetadata _metadata;
+	DataType _nodataValue;
+	std::vector<DataType> _data;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class with all pixels set to nodata.
+	/// </summary>
+	/// <param name="metadata">The metadata of the target raster.</param>
+	/// <param name="nodataValue">The nodata value.</param>
+	ClusterRenderer(const RasterMetadata& metadata, DataType nodataValue)
+		: _metadata(metadata), _nodataValue(nodataValue),
+		  _data(static_cast<std::size_t>(metadata.rasterSizeX()) * metadata.rasterSizeY(), nodataValue)
+	{ }
+
+	ClusterRenderer(const ClusterRenderer&) = delete;
+	ClusterRenderer& operator=(const ClusterRenderer&) = delete;
+
+	/// <summary>
+	/// Retrieves the nodata value.
+	/// </summary>
+	DataType nodataValue() const { return _nodataValue; }
+
+	/// <summary>
+	/// Retrieves the value of a pixel.
+	/// </summary>
+	/// <param name="x">The abcissa of the pixel.</param>
+	/// <param name="y">The ordinate of the pixel.</param>
+	DataType data(int x, int y) const
+	{
+		if (!isValid(x, y))
+			return _nodataValue;
+		return _data[static_cast<std::size_t>(y) * _metadata.rasterSizeX() + x];
+	}
+
+	/// <summary>
+	/// Paints a set of points with the given value.
+	/// </summary>
+	/// <remarks>
+	/// Points outside of the raster are ignored.
+	/// </remarks>
+	/// <param name="points">The points to paint.</param>
+	/// <param name="value">The value to paint with.</param>
+	void paint(const std::vector<OGRPoint>& points, DataType value);
+
+	/// <summary>
+	/// Paints the given clusters in parallel, each with its respective value.
+	/// </summary>
+	/// <remarks>
+	/// The clusters of a cluster map are disjoint, therefore they can be painted concurrently.
+	/// Subsequent calls paint over the previous ones.
+	/// </remarks>
+	/// <param name="clusters">The cluster map.</param>
+	/// <param name="indexes">The indexes of the clusters to paint.</param>
+	/// <param name="values">The values to paint the clusters with.</param>
+	void paint(const ClusterMap& clusters,
+	           const std::vector<GUInt32>& indexes,
+	           const std::vector<DataType>& values);
+
+	/// <summary>
+	/// Resets the pixels to nodata where the given raster has no data.
+	/// </summary>
+	/// <remarks>
+	/// The raster is read sequentially by strips of its natural block height.
+	/// </remarks>
+	/// <param name="dataset">The masking dataset.</param>
+	/// <param name="bandIndex">The index of the masking band.</param>
+	void mask(GDALDataset* dataset, int bandIndex = 1);
+
+	/// <summary>
+	/// Writes the raster into a new file.
+	/// </summary>
+	/// <param name="path">The path of the target file.</param>
+	void write(const std::string& path) const;
+
+private:
+	bool isValid(int x, int y) const
+	{
+		return x >= 0 && x < _metadata.rasterSizeX() &&
+		       y >= 0 && y < _metadata.rasterSizeY();
+	}
+};
+
+template <typename DataType>
+void ClusterRenderer<DataType>::paint(const std::vector<OGRPoint>& points, DataType value)
+{
+	for (const OGRPoint& point : points)
+	{
+		int x = static_cast<int>(point.getX());
+		int y = static_cast<int>(point.getY());
+		if (isValid(x, y))
+			_data[static_cast<std::size_t>(y) * _metadata.rasterSizeX() + x] = value;
+	}
+}
+
+template <typename DataType>
+void ClusterRenderer<DataType>::paint(const ClusterMap& clusters,
+                                      const std::vector<GUInt32>& indexes,
+                                      const std::vector<DataType>& values)
+{
+	if (indexes.size() != values.size())
+		throw std::invalid_argument("The number of clusters and values must match.");
+
+	std::size_t threads = threadCount > 0 ? threadCount : std::thread::hardware_concurrency();
+	threads = std::max<std::size_t>(1, std::min(threads, indexes.size()));
+
+	auto worker = [&](std::size_t from, std::size_t to)
+	{
+		for (std::size_t i = from; i < to; ++i)
+			paint(clusters.points(indexes[i]), values[i]);
+	};
+
+	if (threads <= 1)
+	{
+		worker(0, indexes.size());
+		return;
+	}
+
+	std::size_t chunkSize = (indexes.size() + threads - 1) / threads;
+	std::vector<std::thread> pool;
+	pool.reserve(threads);
+	for (std::size_t from = 0; from < indexes.size(); from += chunkSize)
+		pool.emplace_back(worker, from, std::min(from + chunkSize, indexes.size()));
+	for (std::thread& thread : pool)
+		thread.join();
+}
+
+template <typename DataType>
+void ClusterRenderer<DataType>::mask(GDALDataset* dataset, int bandIndex)
+{
+	if (dataset == nullptr)
+		throw std::invalid_argument("The masking dataset is not given.");
+
+	RasterMetadata metadata(dataset);
+	GDALRasterBand* band = dataset->GetRasterBand(bandIndex);
+	if (band == nullptr)
+		throw std::out_of_range("The masking band does not exist.");
+
+	int hasNodata;
+	DataType maskNodata = static_cast<DataType>(band->GetNoDataValue(&hasNodata));
+
+	int offsetX = static_cast<int>((metadata.originX() - _metadata.originX()) / std::abs(_metadata.pixelSizeX()));
+	int offsetY = static_cast<int>((_metadata.originY() - metadata.originY()) / std::abs(_metadata.pixelSizeY()));
+
+	int blockSizeX, blockSizeY;
+	band->GetBlockSize(&blockSizeX, &blockSizeY);
+	blockSizeY = std::max(1, blockSizeY);
+
+	std::vector<DataType> strip(static_cast<std::size_t>(metadata.rasterSizeX()) * blockSizeY);
+	for (int y = 0; y < _metadata.rasterSizeY(); y += blockSizeY)
+	{
+		int rows = std::min(blockSizeY, _metadata.rasterSizeY() - y);
+		int readFrom = std::max(0, y - offsetY);
+		int readTo = std::min(metadata.rasterSizeY(), y + rows - offsetY);
+		if (readFrom < readTo &&
+		    band->RasterIO(GF_Read,
+		                   0, readFrom,
+		                   metadata.rasterSizeX(), readTo - readFrom,
+		                   &strip[0], metadata.rasterSizeX(), readTo - readFrom,
+		                   gdalType<DataType>(), 0, 0) != CE_None)
+			throw std::runtime_error("Mask read error occured.");
+		if (readFrom < readTo)
+			Metrics::addRead(static_cast<std::uint64_t>(metadata.rasterSizeX()) * (readTo - readFrom) * sizeof(DataType));
+
+		for (int j = y; j < y + rows; ++j)
+			for (int i = 0; i < _metadata.rasterSizeX(); ++i)
+			{
+				int mi = i - offsetX;
+				int mj = j - offsetY;
+				bool hasData = mi >= 0 && mi < metadata.rasterSizeX() &&
+				               mj >= readFrom && mj < readTo &&
+				               !(hasNodata && strip[static_cast<std::size_t>(mj - readFrom) * metadata.rasterSizeX() + mi] == maskNodata);
+				if (!hasData)
+					_data[static_cast<std::size_t>(j) * _metadata.rasterSizeX() + i] = _nodataValue;
+			}
+	}
+}
+
+template <typename DataType>
+void ClusterRenderer<DataType>::write(const std::string& path) const
+{
+	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName(targetFormat.c_str());
+	if (driver == nullptr)
+		throw std::invalid_argument("Target output format unrecognized.");
+
+	if (fs::exists(path) &&
+	    driver->Delete(path.c_str()) == CE_Failure &&
+	    !fs::remove(path))
+		throw std::runtime_error("Cannot overwrite previously created target file.");
+
+	char **targetParams = nullptr;
+	for (auto& co : createOptions)
+		targetParams = CSLSetNameValue(targetParams, co.first.c_str(), co.second.c_str());
+
+	GDALDataset* target = driver->Create(path.c_str(),
+	                                     _metadata.rasterSizeX(),
+	                                     _metadata.rasterSizeY(), 1,
+	                                     gdalType<DataType>(), targetParams);
+	CSLDestroy(targetParams);
+	if (target == nullptr)
+		throw std::runtime_error("Target file creation failed.");
+
+	target->SetGeoTransform(&_metadata.geoTransform()[0]);
+	if (_metadata.reference().Validate() == OGRERR_NONE)
+	{
+		char *wkt;
+		_metadata.reference().exportToWkt(&wkt);
+		target->SetProjection(wkt);
+		CPLFree(wkt);
+	}
+
+	GDALRasterBand* targetBand = target->GetRasterBand(1);
+	targetBand->SetNoDataValue(_nodataValue);
+
+	CPLErr ioResult = targetBand->RasterIO(GF_Write,
+	                                       0, 0,
+	                                       _metadata.rasterSizeX(), _metadata.rasterSizeY(),
+	                                       const_cast<DataType*>(_data.data()),
+	                                       _metadata.rasterSizeX(), _metadata.rasterSizeY(),
+	                                       gdalType<DataType>(), 0, 0);
+	GDALClose(target);
+
+	if (ioResult != CE_None)
+		throw std::runtime_error("Target write error occured.");
+	Metrics::addWritten(static_cast<std::uint64_t>(_metadata.rasterSizeX()) * _metadata.rasterSizeY() * sizeof(DataType));
+}
+} // DEM
+} // CloudTools
@@ -0,0 +1,152 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+
+#include <boost/algorithm/string.hpp>
+#include <gdal_utils.h>
+
+#include <CloudTools.Common/Metrics.h>
+#include <CloudTools.Common/Trace.h>
+
+#include "CogWriter.h"
+
+namespace CloudTools
+{
+namespace DEM
+{
+namespace
+{
+/// <summary>
+/// Gets the uncompressed size of the raster data of a dataset in bytes.
+/// </summary>
+std::uint64_t rasterBytes(GDALDataset* dataset)
+{
+	std::uint64_t bytes = 0;
+	for (int i = 1; i <= dataset->GetRasterCount(); ++i)
+		bytes += static_cast<std::uint64_t>(dataset->GetRasterXSize()) * dataset->GetRasterYSize() *
+			GDALGetDataTypeSizeBytes(dataset->GetRasterBand(i)->GetRasterDataType());
+	return bytes;
+}
+}
+
+const char* CogWriter::Format = "COG";
+
+bool CogWriter::isNative()
+{
+	return GetGDALDriverManager()->GetDriverByName(Format) != nullptr;
+}
+
+std::string CogWriter::format() const
+{
+	return isNative() ? Format : "GTiff";
+}
+
+std::map<std::string, std::string> CogWriter::options() const
+{
+	std::map<std::string, std::string> result;
+	std::string codec = boost::to_upper_copy(compression);
+	result["COMPRESS"] = codec;
+	result["NUM_THREADS"] = threadCount > 0 ? std::to_string(threadCount) : "ALL_CPUS";
+	result["BIGTIFF"] = "IF_SAFER";
+
+	if (isNative())
+	{
+		result["BLOCKSIZE"] = std::to_string(blockSize);
+		result["OVERVIEWS"] = overviews ? "AUTO" : "NONE";
+		result["RESAMPLING"] = resampling;
+		if (level > 0)
+			result["LEVEL"] = std::to_string(level);
+	}
+	else
+	{
+		result["TILED"] = "YES";
+		result["BLOCKXSIZE"] = std::to_string(blockSize);
+		result["BLOCKYSIZE"] = std::to_string(blockSize);
+		if (level > 0)
+		{
+			if (codec == "DEFLATE")
+				result["ZLEVEL"] = std::to_string(level);
+			else if (codec == "ZSTD")
+				result["ZSTD_LEVEL"] = std::to_string(level);
+			else if (codec == "LZMA")
+				result["LZMA_PRESET"] = std::to_string(level);
+		}
+	}
+
+	for (const auto& co : createOptions)
+		result[co.first] = co.second;
+	return result;
+}
+
+GDALDataset* CogWriter::write(GDALDataset* source, const std::string& path,
+                              GDALProgressFunc progress, void* progressArg) const
+{
+	Trace::Span span("io", "write", path);
+	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName(format().c_str());
+	if (driver == nullptr)
+		throw std::invalid_argument("Target output format unrecognized.");
+
+	char** params = nullptr;
+	for (const auto& co : options())
+		params = CSLSetNameValue(params, co.first.c_str(), co.second.c_str());
+
+	GDALDataset* dataset = driver->CreateCopy(path.c_str(), source, false, params, progress, progressArg);
+	CSLDestroy(params);
+	if (dataset == nullptr)
+		throw std::runtime_error("Failed to write the output file.");
+
+	buildOverviews(dataset);
+	Metrics::addWritten(rasterBytes(dataset));
+	return dataset;
+}
+
+GDALDataset* CogWriter::translate(GDALDataset* source, const std::string& path,
+                                  const std::vector<std::string>& arguments,
+                                  GDALProgressFunc progress, void* progressArg) const
+{
+	Trace::Span span("io", "write", path);
+	char** params = nullptr;
+	params = CSLAddString(params, "-of");
+	params = CSLAddString(params, format().c_str());
+	for (const auto& co : options())
+	{
+		params = CSLAddString(params, "-co");
+		params = CSLAddString(params, (co.first + "=" + co.second).c_str());
+	}
+	for (const std::string& argument : arguments)
+		params = CSLAddString(params, argument.c_str());
+
+	GDALTranslateOptions* options = GDALTranslateOptionsNew(params, nullptr);
+	GDALTranslateOptionsSetProgress(options, progress, progressArg);
+	GDALDataset* dataset = static_cast<GDALDataset*>(
+		GDALTranslate(path.c_str(), source, options, nullptr));
+	GDALTranslateOptionsFree(options);
+	CSLDestroy(params);
+	if (dataset == nullptr)
+		throw std::runtime_error("Failed to write the output file.");
+
+	buildOverviews(dataset);
+	Metrics::addWritten(rasterBytes(dataset));
+	return dataset;
+}
+
+void CogWriter::buildOverviews(GDALDataset* dataset) const
+{
+	// The COG driver generates the overviews itself.
+	if (isNative() || !overviews)
+		return;
+
+	// Halving until the overview fits into a single tile
+	std::vector<int> levels;
+	int size = std::max(dataset->GetRasterXSize(), dataset->GetRasterYSize());
+	for (int factor = 2; size / (factor / 2) > blockSize; factor *= 2)
+		levels.push_back(factor);
+	if (levels.empty())
+		return;
+
+	if (dataset->BuildOverviews(resampling.c_str(), static_cast<int>(levels.size()), levels.data(),
+	                            0, nullptr, nullptr, nullptr) != CE_None)
+		throw std::runtime_error("Failed to build the overviews of the output file.");
+}
+} // DEM
+} // CloudTools
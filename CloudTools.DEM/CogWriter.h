@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <gdal_priv.h>
+
+namespace CloudTools
+{
+namespace DEM
+{
+/// <summary>
+/// Represents an output stage writing Cloud-optimized GeoTIFF (COG) files.
+/// </summary>
+/// <remarks>
+/// The output is tiled, contains internal overviews and its blocks are compressed on multiple threads.
+/// When the COG driver is not available (GDAL before 3.1), a tiled GeoTIFF with internal overviews is written instead.
+/// </remarks>
+class CogWriter
+{
+public:
+	/// <summary>
+	/// The name of the format for the creation options of operations.
+	/// </summary>
+	static const char* Format;
+
+	/// <summary>
+	/// The compression codec, e.g. DEFLATE, LZW, ZSTD, LZMA or NONE.
+	/// </summary>
+	std::string compression = "DEFLATE";
+
+	/// <summary>
+	/// The compression level, the default of the codec if 0.
+	/// </summary>
+	int level = 0;
+
+	/// <summary>
+	/// The width and height of the tiles in pixels.
+	/// </summary>
+	int blockSize = 512;
+
+	/// <summary>
+	/// Generate internal overviews.
+	/// </summary>
+	bool overviews = true;
+
+	/// <summary>
+	/// The resampling method of the overviews.
+	/// </summary>
+	std::string resampling = "NEAREST";
+
+	/// <summary>
+	/// The number of threads compressing the blocks, all CPUs if 0.
+	/// </summary>
+	int threadCount = 0;
+
+	/// <summary>
+	/// Additional format specific creation options, overriding the generated ones.
+	/// </summary>
+	std::map<std::string, std::string> createOptions;
+
+	/// <summary>
+	/// Determines whether the native COG driver is available.
+	/// </summary>
+	static bool isNative();
+
+	/// <summary>
+	/// Gets the GDAL format of the output.
+	/// </summary>
+	std::string format() const;
+
+	/// <summary>
+	/// Gets the creation options of the output.
+	/// </summary>
+	std::map<std::string, std::string> options() const;
+
+	/// <summary>
+	/// Writes a dataset.
+	/// </summary>
+	/// <param name="source">The dataset to write.</param>
+	/// <param name="path">The path of the output file.</param>
+	/// <param name="progress">The GDAL progress callback.</param>
+	/// <param name="progressArg">The argument of the progress callback.</param>
+	/// <returns>The written dataset.</returns>
+	GDALDataset* write(GDALDataset* source, const std::string& path,
+	                   GDALProgressFunc progress = nullptr, void* progressArg = nullptr) const;
+
+	/// <summary>
+	/// Writes a dataset with GDALTranslate.
+	/// </summary>
+	/// <param name="source">The dataset to write.</param>
+	/// <param name="path">The path of the output file.</param>
+	/// <param name="arguments">Additional GDALTranslate arguments, e.g. <c>-projwin</c>.</param>
+	/// <param name="progress">The GDAL progress callback.</param>
+	/// <param name="progressArg">The argument of the progress callback.</param>
+	/// <returns>The written dataset.</returns>
+	GDALDataset* translate(GDALDataset* source, const std::string& path,
+	                       const std::vector<std::string>& arguments,
+	                       GDALProgressFunc progress = nullptr, void* progressArg = nullptr) const;
+
+private:
+	/// <summary>
+	/// Builds the internal overviews when the COG driver is not available.
+	/// </summary>
+	void buildOverviews(GDALDataset* dataset) const;
+};
+} // DEM
+} // CloudTools
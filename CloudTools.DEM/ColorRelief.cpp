@@ -0,0 +1,230 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <boost/algorithm/string.hpp>
+
+#include <CloudTools.Common/Metrics.h>
+
+#include "ColorRelief.h"
+
+namespace CloudTools
+{
+namespace DEM
+{
+ColorRelief::ColorRelief(const std::string& colorFile)
+{
+	std::ifstream stream(colorFile);
+	if (!stream)
+		throw std::runtime_error("Error at opening the color file.");
+
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		boost::trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::vector<std::string> tokens;
+		boost::split(tokens, line, boost::is_any_of(" \t,:"), boost::token_compress_on);
+
+		Color color;
+		if (tokens.size() == 2)
+		{
+			std::istringstream name(tokens[1]);
+			name >> color;
+		}
+		else if (tokens.size() == 4 || tokens.size() == 5)
+			color = Color(std::stoi(tokens[1]), std::stoi(tokens[2]), std::stoi(tokens[3]),
+			              tokens.size() == 5 ? std::stoi(tokens[4]) : 255);
+		else
+			throw std::invalid_argument("Invalid line in the color file: " + line);
+
+		std::string value = boost::to_lower_copy(tokens[0]);
+		if (value == "nv")
+		{
+			_nodataColor = color;
+			continue;
+		}
+
+		Entry entry;
+		entry.isPercent = boost::ends_with(value, "%");
+		entry.value = std::stod(entry.isPercent ? value.substr(0, value.size() - 1) : value);
+		entry.color = color;
+		_hasPercent = _hasPercent || entry.isPercent;
+		_entries.push_back(entry);
+	}
+
+	if (_entries.empty())
+		throw std::invalid_argument("The color file contains no entries.");
+
+	if (!_hasPercent)
+		buildTable(_table, _minimum, _maximum, 0, 100);
+}
+
+Color ColorRelief::color(double value, double minimum, double maximum) const
+{
+	// Absolute value of the entries, percentages are resolved over the range
+	auto resolve = [minimum, maximum](const Entry& entry)
+	{
+		return entry.isPercent ? minimum + (maximum - minimum) * entry.value / 100 : entry.value;
+	};
+
+	std::vector<std::pair<double, Color>> entries;
+	entries.reserve(_entries.size());
+	for (const Entry& entry : _entries)
+		entries.emplace_back(resolve(entry), entry.color);
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const std::pair<double, Color>& a, const std::pair<double, Color>& b)
+		{
+			return a.first < b.first;
+		});
+
+	if (value <= entries.front().first)
+		return entries.front().second;
+	if (value >= entries.back().first)
+		return entries.back().second;
+
+	auto upper = std::upper_bound(entries.begin(), entries.end(), value,
+		[](double value, const std::pair<double, Color>& entry)
+		{
+			return value < entry.first;
+		});
+	auto lower = upper - 1;
+
+	double ratio = (value - lower->first) / (upper->first - lower->first);
+	auto interpolate = [ratio](int from, int to)
+	{
+		return static_cast<int>(std::lround(from + (to - from) * ratio));
+	};
+	return Color(interpolate(lower->second.red(), upper->second.red()),
+	             interpolate(lower->second.green(), upper->second.green()),
+	             interpolate(lower->second.blue(), upper->second.blue()),
+	             interpolate(lower->second.alpha(), upper->second.alpha()));
+}
+
+GDALDataset* ColorRelief::render(GDALDataset* source, int band,
+                                 Operation::ProgressType progress) const
+{
+	GDALRasterBand* sourceBand = source->GetRasterBand(band);
+	if (sourceBand == nullptr)
+		throw std::invalid_argument("The band to render does not exist.");
+
+	int sizeX = source->GetRasterXSize();
+	int sizeY = source->GetRasterYSize();
+
+	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("MEM");
+	GDALDataset* target = driver->Create("", sizeX, sizeY, 4, GDT_Byte, nullptr);
+	if (target == nullptr)
+		throw std::runtime_error("Color relief creation failed.");
+
+	double geoTransform[6];
+	if (source->GetGeoTransform(geoTransform) == CE_None)
+		target->SetGeoTransform(geoTransform);
+	target->SetProjection(source->GetProjectionRef());
+	target->GetRasterBand(1)->SetColorInterpretation(GCI_RedBand);
+	target->GetRasterBand(2)->SetColorInterpretation(GCI_GreenBand);
+	target->GetRasterBand(3)->SetColorInterpretation(GCI_BlueBand);
+	target->GetRasterBand(4)->SetColorInterpretation(GCI_AlphaBand);
+
+	// Percentage entries require the value range of the band
+	std::vector<PixelType> rangeTable;
+	const std::vector<PixelType>* table = &_table;
+	double minimum = _minimum, maximum = _maximum;
+	if (_hasPercent)
+	{
+		double range[2];
+		sourceBand->ComputeRasterMinMax(false, range);
+		buildTable(rangeTable, minimum, maximum, range[0], range[1]);
+		table = &rangeTable;
+	}
+	double scale = maximum > minimum ? (TableSize - 1) / (maximum - minimum) : 0;
+
+	int hasNodata;
+	double nodataValue = sourceBand->GetNoDataValue(&hasNodata);
+	PixelType nodataPixel =
+	{
+		static_cast<GByte>(_nodataColor.red()), static_cast<GByte>(_nodataColor.green()),
+		static_cast<GByte>(_nodataColor.blue()), static_cast<GByte>(_nodataColor.alpha())
+	};
+
+	// Strips of whole block rows
+	int blockSizeX, blockSizeY;
+	sourceBand->GetBlockSize(&blockSizeX, &blockSizeY);
+	int stripSize = std::max(1, std::min(sizeY, std::max(blockSizeY, (1 << 20) / std::max(1, sizeX))));
+
+	std::vector<double> values(static_cast<std::size_t>(sizeX) * stripSize);
+	std::vector<PixelType> pixels(values.size());
+	int bandMap[4] = { 1, 2, 3, 4 };
+	for (int y = 0; y < sizeY; y += stripSize)
+	{
+		int rows = std::min(stripSize, sizeY - y);
+		std::size_t count = static_cast<std::size_t>(sizeX) * rows;
+		if (sourceBand->RasterIO(GF_Read, 0, y, sizeX, rows,
+		                         values.data(), sizeX, rows, GDT_Float64, 0, 0) != CE_None)
+		{
+			GDALClose(target);
+			throw std::runtime_error("Source read error occured.");
+		}
+		Metrics::addRead(count * sizeof(double));
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			double value = values[i];
+			if (std::isnan(value) || (hasNodata && value == nodataValue))
+				pixels[i] = nodataPixel;
+			else if (value <= minimum)
+				pixels[i] = table->front();
+			else if (value >= maximum)
+				pixels[i] = table->back();
+			else
+				pixels[i] = (*table)[static_cast<std::size_t>((value - minimum) * scale + 0.5)];
+		}
+
+		// Pixel interleaved buffer for all 4 bands
+		if (target->RasterIO(GF_Write, 0, y, sizeX, rows,
+		                     pixels.data(), sizeX, rows, GDT_Byte,
+		                     4, bandMap, 4, 4 * static_cast<GSpacing>(sizeX), 1) != CE_None)
+		{
+			GDALClose(target);
+			throw std::runtime_error("Target write error occured.");
+		}
+		Metrics::addWritten(count * sizeof(PixelType));
+		Metrics::addPixels(count);
+
+		if (progress)
+			progress(1.f * (y + rows) / sizeY, std::string());
+	}
+	return target;
+}
+
+void ColorRelief::buildTable(std::vector<PixelType>& table, double& minimum, double& maximum,
+                             double rangeMinimum, double rangeMaximum) const
+{
+	minimum = maximum = _entries.front().isPercent
+		? rangeMinimum + (rangeMaximum - rangeMinimum) * _entries.front().value / 100
+		: _entries.front().value;
+	for (const Entry& entry : _entries)
+	{
+		double value = entry.isPercent
+			? rangeMinimum + (rangeMaximum - rangeMinimum) * entry.value / 100
+			: entry.value;
+		minimum = std::min(minimum, value);
+		maximum = std::max(maximum, value);
+	}
+
+	table.resize(TableSize);
+	for (int i = 0; i < TableSize; ++i)
+	{
+		double value = maximum > minimum ? minimum + (maximum - minimum) * i / (TableSize - 1) : minimum;
+		Color color = this->color(value, rangeMinimum, rangeMaximum);
+		table[i] = {
+			static_cast<GByte>(color.red()), static_cast<GByte>(color.green()),
+			static_cast<GByte>(color.blue()), static_cast<GByte>(color.alpha())
+		};
+	}
+}
+} // DEM
+} // CloudTools
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <utility>
+
+#include <gdal_priv.h>
+
+#include <CloudTools.Common/Operation.h>
+#include "Color.h"
+
+namespace CloudTools
+{
+namespace DEM
+{
+/// <summary>
+/// Represents a color relief rendering of DEM datasets.
+/// </summary>
+/// <remarks>
+/// The color file is in the format of <c>gdaldem color-relief</c>: each line contains a value
+/// (or a percentage of the value range, or <c>nv</c> for nodata) and an RGB(A) color or a color name.
+/// Colors are linearly interpolated between the entries and clamped outside of them.
+/// The entries are parsed once into a lookup table, so rendering a pixel costs a single table access.
+/// </remarks>
+/// <seealso href="http://www.gdal.org/gdaldem.html"/>
+class ColorRelief
+{
+public:
+	/// <summary>
+	/// The number of entries in the lookup table.
+	/// </summary>
+	static const int TableSize = 4096;
+
+	typedef std::array<GByte, 4> PixelType;
+
+private:
+	struct Entry
+	{
+		double value;
+		bool isPercent;
+		Color color;
+	};
+
+	std::vector<Entry> _entries;
+	Color _nodataColor = Color::Transparent;
+	bool _hasPercent = false;
+
+	// The lookup table of the absolute entries
+	std::vector<PixelType> _table;
+	double _minimum = 0;
+	double _maximum = 0;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class and parses the color file.
+	/// </summary>
+	/// <param name="colorFile">The path of the color file.</param>
+	ColorRelief(const std::string& colorFile);
+
+	/// <summary>
+	/// Determines the color of a value by interpolating between the entries.
+	/// </summary>
+	/// <param name="value">The value to color.</param>
+	/// <param name="minimum">The minimum of the value range, for percentage entries.</param>
+	/// <param name="maximum">The maximum of the value range, for percentage entries.</param>
+	/// <returns>The color of the value.</returns>
+	Color color(double value, double minimum = 0, double maximum = 100) const;
+
+	/// <summary>
+	/// Renders a band of a dataset into an RGBA dataset.
+	/// </summary>
+	/// <remarks>
+	/// The band is processed in strips of its blocks, pixels with the nodata value get the nodata color.
+	/// </remarks>
+	/// <param name="source">The source dataset.</param>
+	/// <param name="band">The index of the band to render.</param>
+	/// <param name="progress">The callback method to report progress.</param>
+	/// <returns>A new 4 band in-memory dataset with the georeference of the source.</returns>
+	GDALDataset* render(GDALDataset* source, int band = 1,
+	                    Operation::ProgressType progress = nullptr) const;
+
+private:
+	/// <summary>
+	/// Builds a lookup table over a value range.
+	/// </summary>
+	void buildTable(std::vector<PixelType>& table, double& minimum, double& maximum,
+	                double rangeMinimum, double rangeMaximum) const;
+};
+} // DEM
+} // CloudTools
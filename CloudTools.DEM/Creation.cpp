@@ -1,6 +1,11 @@
 #include <stdexcept>
 
+#include <boost/filesystem.hpp>
+
 #include "Creation.h"
+#include "CogWriter.h"
+
+namespace fs = boost::filesystem;
 
 namespace CloudTools
 {
@@ -19,5 +24,61 @@ GDALDataset* Creation::target()
 	_targetOwnerShip = false;
 	return _targetDataset;
 }
+
+void Creation::createTarget(const RasterMetadata& metadata, GDALDataType dataType)
+{
+	bool isCog = targetFormat == CogWriter::Format;
+	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName(isCog ? "MEM" : targetFormat.c_str());
+	if (driver == nullptr)
+		throw std::invalid_argument("Target output format unrecognized.");
+
+	if (fs::exists(_targetPath) &&
+		driver->Delete(_targetPath.c_str()) == CE_Failure &&
+		!fs::remove(_targetPath))
+		throw std::runtime_error("Cannot overwrite previously created target file.");
+
+	// The creation options of COG are applied on completion.
+	char **targetParams = nullptr;
+	if (!isCog)
+		for (auto& co : createOptions)
+			targetParams = CSLSetNameValue(targetParams, co.first.c_str(), co.second.c_str());
+
+	_targetDataset = driver->Create(isCog ? "" : _targetPath.c_str(),
+		metadata.rasterSizeX(), metadata.rasterSizeY(), 1,
+		dataType, targetParams);
+	CSLDestroy(targetParams);
+	if (_targetDataset == nullptr)
+		throw std::runtime_error("Target file creation failed.");
+
+	_targetDataset->SetGeoTransform(&metadata.geoTransform()[0]);
+	if (metadata.reference().Validate() == OGRERR_NONE)
+	{
+		char *wkt;
+		metadata.reference().exportToWkt(&wkt);
+		_targetDataset->SetProjection(wkt);
+		CPLFree(wkt);
+	}
+}
+
+void Creation::completeTarget()
+{
+	if (targetFormat != CogWriter::Format)
+		return;
+
+	CogWriter writer;
+	writer.createOptions = createOptions;
+	GDALDataset* memoryDataset = _targetDataset;
+	_targetDataset = nullptr;
+	try
+	{
+		_targetDataset = writer.write(memoryDataset, _targetPath);
+	}
+	catch (...)
+	{
+		GDALClose(memoryDataset);
+		throw;
+	}
+	GDALClose(memoryDataset);
+}
 } // DEM
 } // CloudTools
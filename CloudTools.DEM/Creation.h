@@ -21,6 +21,7 @@ public:
 	/// </summary>
 	/// <remarks>
 	/// For supported formats, <see cref="http://www.gdal.org/formats_list.html" />.
+	/// The <c>COG</c> format is supported by all transformations, see <see cref="CogWriter" />.
 	/// </remarks>
 	std::string targetFormat = "GTiff";
 
@@ -66,6 +67,22 @@ public:
 	/// </remarks>
 	/// <returns>The target dataset.</returns>
 	GDALDataset* target();
+
+protected:
+	/// <summary>
+	/// Creates the target dataset.
+	/// </summary>
+	/// <remarks>
+	/// When the target format is COG, the dataset is created in memory and written by <see cref="completeTarget" />.
+	/// </remarks>
+	/// <param name="metadata">The metadata of the target.</param>
+	/// <param name="dataType">The data type of the target.</param>
+	void createTarget(const RasterMetadata& metadata, GDALDataType dataType);
+
+	/// <summary>
+	/// Completes the target dataset after the computation.
+	/// </summary>
+	void completeTarget();
 };
 } // DEM
 } // CloudTools
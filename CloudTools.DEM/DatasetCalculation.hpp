@@ -10,6 +10,9 @@
 #include <boost/filesystem.hpp>
 #include <gdal_priv.h>
 
+#include <CloudTools.Common/Metrics.h>
+#include <CloudTools.Common/Trace.h>
+
 #include "Transformation.h"
 #include "Metadata.h"
 #include "Helper.h"
@@ -164,6 +167,7 @@ void DatasetCalculation<SourceType>::onExecute()
 	CPLErr ioResult = CE_None;
 	for (unsigned int i = 0; i < sourceCount(); ++i)
 	{
+		Trace::Span span("io", "read", "source #" + std::to_string(i + 1));
 		ioResult = static_cast<CPLErr>(ioResult |
 			sourceBands[i]->RasterIO(GF_Read,
 				0, 0,
@@ -172,6 +176,7 @@ void DatasetCalculation<SourceType>::onExecute()
 				_sourceMetadata[i].rasterSizeX(), _sourceMetadata[i].rasterSizeY(),
 				sourceType, 
 				0, 0));
+		Metrics::addRead(static_cast<std::uint64_t>(_sourceMetadata[i].rasterSizeX()) * _sourceMetadata[i].rasterSizeY() * sizeof(SourceType));
 
 		if (progress)
 			progress((i + 1) * 1.f / computationSteps, "Done reading source #" + std::to_string(i + 1));
@@ -190,6 +195,7 @@ void DatasetCalculation<SourceType>::onExecute()
 	}
 
 	computation(_targetMetadata.rasterSizeX(), _targetMetadata.rasterSizeY());
+	Metrics::addPixels(static_cast<std::uint64_t>(_targetMetadata.rasterSizeX()) * _targetMetadata.rasterSizeY());
 
 	progress = origProgress;
 	if (progress)
@@ -10,6 +10,9 @@
 #include <boost/filesystem.hpp>
 #include <gdal_priv.h>
 
+#include <CloudTools.Common/Metrics.h>
+#include <CloudTools.Common/Trace.h>
+
 #include "Transformation.h"
 #include "Metadata.h"
 #include "Helper.h"
@@ -169,38 +172,11 @@ void DatasetTransformation<TargetType, SourceType>::onExecute()
 	if (!computation)
 		throw std::logic_error("No computation method defined.");
 
-	// Create and open the target file
-	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName(targetFormat.c_str());
-	if (driver == nullptr)
-		throw std::invalid_argument("Target output format unrecognized.");
-
-	if (fs::exists(_targetPath) &&
-		driver->Delete(_targetPath.c_str()) == CE_Failure &&
-		!fs::remove(_targetPath))
-		throw std::runtime_error("Cannot overwrite previously created target file.");
-
 	GDALDataType sourceType = gdalType<SourceType>();
 	GDALDataType targetType = gdalType<TargetType>();
 
-	char **targetParams = nullptr;
-	for (auto& co : createOptions)
-		targetParams = CSLSetNameValue(targetParams, co.first.c_str(), co.second.c_str());
-
-	_targetDataset = driver->Create(_targetPath.c_str(),
-		_targetMetadata.rasterSizeX(), _targetMetadata.rasterSizeY(), 1,
-		targetType, targetParams);
-	CSLDestroy(targetParams);
-	if (_targetDataset == nullptr)
-		throw std::runtime_error("Target file creation failed.");
-
-	_targetDataset->SetGeoTransform(&_targetMetadata.geoTransform()[0]);
-	if (_targetMetadata.reference().Validate() == OGRERR_NONE)
-	{
-		char *wkt;
-		_targetMetadata.reference().exportToWkt(&wkt);
-		_targetDataset->SetProjection(wkt);
-		CPLFree(wkt);
-	}
+	// Create and open the target file
+	createTarget(_targetMetadata, targetType);
 
 	// Determine computation progress steps
 	int computationSteps = sourceCount() + 2;
@@ -244,6 +220,7 @@ void DatasetTransformation<TargetType, SourceType>::onExecute()
 	CPLErr ioResult = CE_None;
 	for (unsigned int i = 0; i < sourceCount(); ++i)
 	{
+		Trace::Span span("io", "read", "source #" + std::to_string(i + 1));
 		ioResult = static_cast<CPLErr>(ioResult |
 			sourceBands[i]->RasterIO(GF_Read,
 				0, 0,
@@ -252,6 +229,7 @@ void DatasetTransformation<TargetType, SourceType>::onExecute()
 				_sourceMetadata[i].rasterSizeX(), _sourceMetadata[i].rasterSizeY(),
 				sourceType, 
 				0, 0));
+		Metrics::addRead(static_cast<std::uint64_t>(_sourceMetadata[i].rasterSizeX()) * _sourceMetadata[i].rasterSizeY() * sizeof(SourceType));
 
 		if (progress)
 			progress((i + 1) * 1.f / computationSteps, "Done reading source #" + std::to_string(i + 1));
@@ -273,12 +251,14 @@ void DatasetTransformation<TargetType, SourceType>::onExecute()
 	}
 
 	computation(_targetMetadata.rasterSizeX(), _targetMetadata.rasterSizeY());
+	Metrics::addPixels(static_cast<std::uint64_t>(_targetMetadata.rasterSizeX()) * _targetMetadata.rasterSizeY());
 
 	progress = origProgress;
 	if (progress)
 		progress((computationSteps - 1) * 1.f / computationSteps, "Computation performed");
 
 	// Write target
+	Trace::Span span("io", "write");
 	ioResult = targetBand->RasterIO(GF_Write,
 		0, 0,
 		_targetMetadata.rasterSizeX(), _targetMetadata.rasterSizeY(),
@@ -288,6 +268,8 @@ void DatasetTransformation<TargetType, SourceType>::onExecute()
 		0, 0);
 	if (ioResult != CE_None)
 		throw std::runtime_error("Target write error occured.");
+	Metrics::addWritten(static_cast<std::uint64_t>(_targetMetadata.rasterSizeX()) * _targetMetadata.rasterSizeY() * sizeof(TargetType));
+	completeTarget();
 
 	if (progress)
 		progress(1.f, "Target written");
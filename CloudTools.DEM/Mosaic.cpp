@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <gdal_utils.h>
+
+#include "Mosaic.h"
+
+namespace CloudTools
+{
+namespace DEM
+{
+Mosaic::Mosaic(const std::vector<std::string>& tilePaths, const std::string& path)
+	: _path(path)
+{
+	if (tilePaths.empty())
+		throw std::invalid_argument("At least 1 tile must be given for a mosaic.");
+
+	std::vector<const char*> sources;
+	sources.reserve(tilePaths.size());
+	for (const std::string& tilePath : tilePaths)
+		sources.push_back(tilePath.c_str());
+
+	GDALBuildVRTOptions* options = GDALBuildVRTOptionsNew(nullptr, nullptr);
+	GDALDataset* dataset = static_cast<GDALDataset*>(GDALBuildVRT(_path.c_str(),
+		static_cast<int>(sources.size()), nullptr, sources.data(),
+		options, nullptr));
+	GDALBuildVRTOptionsFree(options);
+	if (dataset == nullptr)
+		throw std::runtime_error("Failed to build the mosaic.");
+
+	_metadata = RasterMetadata(dataset);
+
+	// The VRT file is flushed on closing
+	GDALClose(dataset);
+}
+
+Mosaic::~Mosaic()
+{
+	if (boost::starts_with(_path, "/vsimem/"))
+		VSIUnlink(_path.c_str());
+}
+
+void Mosaic::cutout(const std::string& path,
+                    double minX, double minY, double maxX, double maxY,
+                    int halo) const
+{
+	// Pixel window of the extent with the halo, clipped to the mosaic
+	double pixelSizeX = std::abs(_metadata.pixelSizeX());
+	double pixelSizeY = std::abs(_metadata.pixelSizeY());
+	int fromX = static_cast<int>(std::floor((minX - _metadata.originX()) / pixelSizeX + 0.5)) - halo;
+	int toX = static_cast<int>(std::floor((maxX - _metadata.originX()) / pixelSizeX + 0.5)) + halo;
+	int fromY = static_cast<int>(std::floor((_metadata.originY() - maxY) / pixelSizeY + 0.5)) - halo;
+	int toY = static_cast<int>(std::floor((_metadata.originY() - minY) / pixelSizeY + 0.5)) + halo;
+
+	fromX = std::max(fromX, 0);
+	fromY = std::max(fromY, 0);
+	toX = std::min(toX, _metadata.rasterSizeX());
+	toY = std::min(toY, _metadata.rasterSizeY());
+	if (fromX >= toX || fromY >= toY)
+		throw std::logic_error("The cut-out does not overlap with the mosaic.");
+
+	GDALDataset* mosaic = static_cast<GDALDataset*>(GDALOpen(_path.c_str(), GA_ReadOnly));
+	if (mosaic == nullptr)
+		throw std::runtime_error("Error at opening the mosaic.");
+
+	std::vector<std::string> arguments =
+	{
+		"-of", "VRT",
+		"-srcwin",
+		std::to_string(fromX), std::to_string(fromY),
+		std::to_string(toX - fromX), std::to_string(toY - fromY)
+	};
+	char** params = nullptr;
+	for (const std::string& argument : arguments)
+		params = CSLAddString(params, argument.c_str());
+
+	GDALTranslateOptions* options = GDALTranslateOptionsNew(params, nullptr);
+	GDALDataset* dataset = static_cast<GDALDataset*>(GDALTranslate(path.c_str(), mosaic, options, nullptr));
+	GDALTranslateOptionsFree(options);
+	CSLDestroy(params);
+	GDALClose(mosaic);
+
+	if (dataset == nullptr)
+		throw std::runtime_error("Failed to create the cut-out of the mosaic.");
+	GDALClose(dataset);
+}
+} // DEM
+} // CloudTools
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <gdal_priv.h>
+
+#include "Metadata.h"
+
+namespace CloudTools
+{
+namespace DEM
+{
+/// <summary>
+/// Represents a seamless virtual mosaic (VRT) of raster tiles.
+/// </summary>
+/// <remarks>
+/// Cut-outs of the mosaic are virtual datasets as well, referring to the tiles they overlap.
+/// Reading a tile extended with a halo therefore only fetches the halo rows and columns
+/// from the neighbouring tiles, and no pixels are copied in advance.
+/// </remarks>
+class Mosaic
+{
+private:
+	std::string _path;
+	RasterMetadata _metadata;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class and builds the mosaic.
+	/// </summary>
+	/// <param name="tilePaths">The paths of the tiles.</param>
+	/// <param name="path">The path of the mosaic VRT file, in most cases on <c>"/vsimem/"</c>.</param>
+	Mosaic(const std::vector<std::string>& tilePaths, const std::string& path);
+
+	/// <summary>
+	/// Removes the mosaic file if it is virtual.
+	/// </summary>
+	~Mosaic();
+
+	Mosaic(const Mosaic&) = delete;
+	Mosaic& operator=(const Mosaic&) = delete;
+
+	/// <summary>
+	/// Gets the path of the mosaic VRT file.
+	/// </summary>
+	const std::string& path() const { return _path; }
+
+	/// <summary>
+	/// Gets the metadata of the mosaic.
+	/// </summary>
+	const RasterMetadata& metadata() const { return _metadata; }
+
+	/// <summary>
+	/// Creates a virtual cut-out of the mosaic.
+	/// </summary>
+	/// <remarks>
+	/// The extent is expanded by the halo on each side, but clipped to the extent of the mosaic.
+	/// The cut-out can be opened from multiple threads through separate dataset handles.
+	/// </remarks>
+	/// <param name="path">The path of the cut-out VRT file, in most cases on <c>"/vsimem/"</c>.</param>
+	/// <param name="minX">The minimum X coordinate of the extent.</param>
+	/// <param name="minY">The minimum Y coordinate of the extent.</param>
+	/// <param name="maxX">The maximum X coordinate of the extent.</param>
+	/// <param name="maxY">The maximum Y coordinate of the extent.</param>
+	/// <param name="halo">The size of the halo in pixels.</param>
+	void cutout(const std::string& path,
+	            double minX, double minY, double maxX, double maxY,
+	            int halo) const;
+};
+} // DEM
+} // CloudTools
@@ -4,11 +4,21 @@
 #include <utility>
 #include <functional>
 #include <stdexcept>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <future>
+#include <cstdint>
 
 #include <gdal_utils.h>
 #include <boost/filesystem.hpp>
 
+#include <CloudTools.Common/ThreadPool.h>
+#include <CloudTools.Common/Metrics.h>
+
 #include "Rasterize.h"
+#include "CogWriter.h"
+#include "ScanlineFill.h"
 
 namespace fs = boost::filesystem;
 
@@ -215,6 +225,187 @@ void Rasterize::onExecute()
 		!fs::remove(_targetPath))
 		throw std::runtime_error("Cannot overwrite previously created output file.");
 
+	// COG is burned in memory first, its creation options are applied on writing.
+	bool isCog = targetFormat == CogWriter::Format;
+	std::string format = isCog ? "MEM" : targetFormat;
+
+	bool isPolygonal = std::all_of(_layers.begin(), _layers.end(),
+		[](OGRLayer* layer)
+	{
+		OGRwkbGeometryType type = wkbFlatten(layer->GetGeomType());
+		return type == wkbPolygon || type == wkbMultiPolygon;
+	});
+	if (isPolygonal)
+	{
+		switch (targetType)
+		{
+		case GDALDataType::GDT_Byte:
+			_targetDataset = burn<GByte>(format);
+			break;
+		case GDALDataType::GDT_Int16:
+			_targetDataset = burn<GInt16>(format);
+			break;
+		case GDALDataType::GDT_Int32:
+			_targetDataset = burn<GInt32>(format);
+			break;
+		case GDALDataType::GDT_UInt16:
+			_targetDataset = burn<GUInt16>(format);
+			break;
+		case GDALDataType::GDT_UInt32:
+			_targetDataset = burn<GUInt32>(format);
+			break;
+		case GDALDataType::GDT_Float32:
+			_targetDataset = burn<float>(format);
+			break;
+		case GDALDataType::GDT_Float64:
+			_targetDataset = burn<double>(format);
+			break;
+		default:
+			throw std::runtime_error("Complex number types are not supported.");
+		}
+	}
+	else
+		_targetDataset = rasterize(format);
+
+	// Set the spatial reference system
+	if (_targetMetadata.reference().Validate() == OGRERR_NONE)
+	{
+		char *wkt;
+		_targetMetadata.reference().exportToWkt(&wkt);
+		_targetDataset->SetProjection(wkt);
+		CPLFree(wkt);
+	}
+
+	if (isCog)
+	{
+		CogWriter writer;
+		writer.createOptions = createOptions;
+		GDALDataset* memoryDataset = _targetDataset;
+		_targetDataset = nullptr;
+		try
+		{
+			_targetDataset = writer.write(memoryDataset, _targetPath);
+		}
+		catch (...)
+		{
+			GDALClose(memoryDataset);
+			throw;
+		}
+		GDALClose(memoryDataset);
+	}
+}
+
+template <typename DataType>
+GDALDataset* Rasterize::burn(const std::string& format)
+{
+	const int sizeX = _targetMetadata.rasterSizeX();
+	const int sizeY = _targetMetadata.rasterSizeY();
+
+	// Read the features within the target extent
+	// (A spatial filter set on the layer by the caller is kept, the fill clips the features anyway.)
+	ScanlineFill fill(_targetMetadata);
+	std::vector<DataType> values;
+	for (OGRLayer* layer : _layers)
+	{
+		int fieldIndex = targetField.empty() ? -1 : layer->FindFieldIndex(targetField.c_str(), false);
+		bool isOwnFilter = layer->GetSpatialFilter() == nullptr;
+		if (isOwnFilter)
+			layer->SetSpatialFilterRect(_targetMetadata.originX(), _targetMetadata.originY() - _targetMetadata.extentY(),
+			                            _targetMetadata.originX() + _targetMetadata.extentX(), _targetMetadata.originY());
+		layer->ResetReading();
+
+		OGRFeature* feature;
+		while ((feature = layer->GetNextFeature()) != nullptr)
+		{
+			fill.add(feature->GetGeometryRef());
+			values.push_back(fieldIndex >= 0
+				? static_cast<DataType>(feature->GetFieldAsDouble(fieldIndex))
+				: static_cast<DataType>(targetValue));
+			OGRFeature::DestroyFeature(feature);
+		}
+		if (isOwnFilter)
+			layer->SetSpatialFilter(nullptr);
+	}
+
+	// Create the target
+	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName(format.c_str());
+	if (driver == nullptr)
+		throw std::invalid_argument("Target output format unrecognized.");
+
+	char **params = nullptr;
+	if (format == targetFormat)
+		for (auto& co : createOptions)
+			params = CSLSetNameValue(params, co.first.c_str(), co.second.c_str());
+	GDALDataset* dataset = driver->Create(format == "MEM" ? "" : _targetPath.c_str(),
+		sizeX, sizeY, 1, targetType, params);
+	CSLDestroy(params);
+	if (dataset == nullptr)
+		throw std::runtime_error("Target file creation failed.");
+
+	dataset->SetGeoTransform(&_targetMetadata.geoTransform()[0]);
+	GDALRasterBand* band = dataset->GetRasterBand(1);
+	band->SetNoDataValue(nodataValue);
+
+	// Burn the row bands concurrently, a chunk of bands at once is buffered and written
+	const int bandHeight = 256;
+	int bandCount = (sizeY + bandHeight - 1) / bandHeight;
+	std::size_t threads = threadCount > 0 ? threadCount : std::thread::hardware_concurrency();
+	threads = std::max<std::size_t>(1, std::min<std::size_t>(threads, bandCount));
+	const int chunkHeight = static_cast<int>(threads) * bandHeight;
+
+	std::vector<DataType> buffer(static_cast<std::size_t>(sizeX) * std::min(sizeY, chunkHeight));
+	std::unique_ptr<ThreadPool> pool(threads > 1 ? new ThreadPool(threads) : nullptr);
+	try
+	{
+		for (int chunkY = 0; chunkY < sizeY; chunkY += chunkHeight)
+		{
+			int chunkToY = std::min(sizeY, chunkY + chunkHeight);
+			std::fill(buffer.begin(), buffer.end(), static_cast<DataType>(nodataValue));
+
+			auto burnBand = [&](int fromY)
+			{
+				int toY = std::min(chunkToY, fromY + bandHeight);
+				fill.burn(buffer.data() + static_cast<std::size_t>(fromY - chunkY) * sizeX, fromY, toY, values);
+			};
+
+			if (!pool)
+			{
+				for (int fromY = chunkY; fromY < chunkToY; fromY += bandHeight)
+					burnBand(fromY);
+			}
+			else
+			{
+				std::vector<std::future<void>> futures;
+				for (int fromY = chunkY; fromY < chunkToY; fromY += bandHeight)
+					futures.push_back(pool->submit([&burnBand, fromY]() { burnBand(fromY); }));
+				for (std::future<void>& future : futures)
+					future.get();
+			}
+			Metrics::addPixels(static_cast<std::uint64_t>(sizeX) * (chunkToY - chunkY));
+
+			if (band->RasterIO(GF_Write, 0, chunkY, sizeX, chunkToY - chunkY,
+			                   buffer.data(), sizeX, chunkToY - chunkY,
+			                   targetType, 0, 0) != CE_None)
+				throw std::runtime_error("Target write error occured.");
+			Metrics::addWritten(static_cast<std::uint64_t>(sizeX) * (chunkToY - chunkY) * sizeof(DataType));
+
+			if (progress)
+				progress(.99f * chunkToY / sizeY, "Polygons burned");
+		}
+	}
+	catch (...)
+	{
+		GDALClose(dataset);
+		throw;
+	}
+
+	if (progress)
+		progress(1.f, "Target written");
+	return dataset;
+}
+
+GDALDataset* Rasterize::rasterize(const std::string& format)
+{
 	// Define the GDALRasterize parameters
 	char **params = nullptr;
 	for (unsigned int i = 0; i < _layers.size(); ++i)
@@ -275,29 +466,24 @@ void Rasterize::onExecute()
 	default:
 		throw std::runtime_error("Complex number types are not supported.");
 	}
-	for (auto& co : createOptions)
-	{
-		params = CSLAddString(params, "-co");
-		params = CSLSetNameValue(params, co.first.c_str(), co.second.c_str());
-	}
+	if (format == targetFormat)
+		for (auto& co : createOptions)
+		{
+			params = CSLAddString(params, "-co");
+			params = CSLSetNameValue(params, co.first.c_str(), co.second.c_str());
+		}
 	params = CSLAddString(params, "-of");
-	params = CSLAddString(params, targetFormat.c_str());
+	params = CSLAddString(params, format.c_str());
 	
 	// Execute GDALRasterize
 	GDALRasterizeOptions *options = GDALRasterizeOptionsNew(params, nullptr);
 	GDALRasterizeOptionsSetProgress(options, gdalProgress, static_cast<void*>(this));
-	_targetDataset = static_cast<GDALDataset*>(GDALRasterize(_targetPath.c_str(), nullptr, _sourceDataset, options, nullptr));
+	GDALDataset* dataset = static_cast<GDALDataset*>(GDALRasterize(format == "MEM" ? "" : _targetPath.c_str(), nullptr, _sourceDataset, options, nullptr));
 	GDALRasterizeOptionsFree(options);
 	CSLDestroy(params);
-
-	// Set the spatial reference system
-	if (_targetMetadata.reference().Validate() == OGRERR_NONE)
-	{
-		char *wkt;
-		_targetMetadata.reference().exportToWkt(&wkt);
-		_targetDataset->SetProjection(wkt);
-		CPLFree(wkt);
-	}
+	if (dataset == nullptr)
+		throw std::runtime_error("Rasterization failed.");
+	return dataset;
 }
 
 int Rasterize::gdalProgress(double dfComplete, const char *pszMessage, void *pProgressArg)
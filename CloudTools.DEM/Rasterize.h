@@ -17,6 +17,12 @@ namespace DEM
 /// <summary>
 /// Represents a converter of vector layers into a raster filter file.
 /// </summary>
+/// <remarks>
+/// Polygon layers are burned in-process: the features within the target extent are read once,
+/// then row bands of the target are burned concurrently by a scanline fill and written chunk by chunk,
+/// so only a few bands are kept in memory.
+/// Other layers are rasterized by GDALRasterize.
+/// </remarks>
 class Rasterize : public Operation
 {
 public:	
@@ -84,6 +90,14 @@ public:
 	/// </remarks>
 	GDALDataType targetType = GDALDataType::GDT_Unknown;
 
+	/// <summary>
+	/// The number of threads burning the polygons.
+	/// </summary>
+	/// <remarks>
+	/// Default value 0 means the number of concurrent threads supported by the hardware.
+	/// </remarks>
+	unsigned int threadCount = 0;
+
 protected:
 	std::string _sourcePath;
 	std::string _targetPath;
@@ -166,6 +180,19 @@ protected:
 	void onExecute() override;
 
 private:
+	/// <summary>
+	/// Burns the polygons of the layers into a new target dataset.
+	/// </summary>
+	/// <param name="format">The format of the target dataset.</param>
+	template <typename DataType>
+	GDALDataset* burn(const std::string& format);
+
+	/// <summary>
+	/// Rasterizes the layers into a new target dataset by GDALRasterize.
+	/// </summary>
+	/// <param name="format">The format of the target dataset.</param>
+	GDALDataset* rasterize(const std::string& format);
+
 	/// <summary>
 	/// Routes the C-style GDAL progress reports to the defined reporter.
 	/// </summary>
@@ -0,0 +1,150 @@
+#include <cmath>
+
+#include <ogrsf_frmts.h>
+
+#include "ScanlineFill.h"
+
+namespace CloudTools
+{
+namespace DEM
+{
+namespace
+{
+/// <summary>
+/// Represents the crossing of a row by a polygon edge.
+/// </summary>
+struct Crossing
+{
+	std::size_t feature;
+	double x;
+
+	bool operator<(const Crossing& other) const
+	{
+		return feature < other.feature || (feature == other.feature && x < other.x);
+	}
+};
+}
+
+std::size_t ScanlineFill::add(const OGRGeometry* geometry)
+{
+	addGeometry(geometry, _featureCount);
+	return _featureCount++;
+}
+
+void ScanlineFill::addGeometry(const OGRGeometry* geometry, std::size_t feature)
+{
+	if (geometry == nullptr)
+		return;
+
+	switch (wkbFlatten(geometry->getGeometryType()))
+	{
+	case wkbPolygon:
+		addPolygon(static_cast<const OGRPolygon*>(geometry), feature);
+		break;
+	case wkbMultiPolygon:
+	case wkbGeometryCollection:
+	{
+		const OGRGeometryCollection* collection = static_cast<const OGRGeometryCollection*>(geometry);
+		for (int i = 0; i < collection->getNumGeometries(); ++i)
+			addGeometry(collection->getGeometryRef(i), feature);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void ScanlineFill::addPolygon(const OGRPolygon* polygon, std::size_t feature)
+{
+	double pixelSizeY = std::abs(_grid.pixelSizeY());
+	for (int r = -1; r < polygon->getNumInteriorRings(); ++r)
+	{
+		const OGRLinearRing* ring = r < 0 ? polygon->getExteriorRing() : polygon->getInteriorRing(r);
+		if (ring == nullptr)
+			continue;
+
+		int count = ring->getNumPoints();
+		for (int i = 0; i < count; ++i)
+		{
+			Edge edge;
+			edge.x0 = ring->getX(i);
+			edge.y0 = ring->getY(i);
+			edge.x1 = ring->getX((i + 1) % count);
+			edge.y1 = ring->getY((i + 1) % count);
+			if (edge.y0 == edge.y1)
+				continue;
+
+			// The rows with their centers in [minY, maxY)
+			double minY = std::min(edge.y0, edge.y1);
+			double maxY = std::max(edge.y0, edge.y1);
+			edge.firstRow = static_cast<int>(std::floor((_grid.originY() - maxY) / pixelSizeY - .5)) + 1;
+			edge.lastRow = static_cast<int>(std::floor((_grid.originY() - minY) / pixelSizeY - .5));
+			edge.firstRow = std::max(edge.firstRow, 0);
+			edge.lastRow = std::min(edge.lastRow, _grid.rasterSizeY() - 1);
+			if (edge.firstRow > edge.lastRow)
+				continue;
+
+			edge.feature = feature;
+			_edges.push_back(edge);
+		}
+	}
+}
+
+void ScanlineFill::runs(int fromY, int toY, const RunCallbackType& callback) const
+{
+	fromY = std::max(fromY, 0);
+	toY = std::min(toY, _grid.rasterSizeY());
+
+	// The edges crossing the range, by their first row
+	std::vector<const Edge*> edges;
+	for (const Edge& edge : _edges)
+		if (edge.firstRow < toY && edge.lastRow >= fromY)
+			edges.push_back(&edge);
+	std::sort(edges.begin(), edges.end(),
+		[](const Edge* a, const Edge* b) { return a->firstRow < b->firstRow; });
+
+	double pixelSizeX = std::abs(_grid.pixelSizeX());
+	double pixelSizeY = std::abs(_grid.pixelSizeY());
+	std::vector<const Edge*> active;
+	std::vector<Crossing> crossings;
+	std::size_t nextEdge = 0;
+	for (int y = fromY; y < toY; ++y)
+	{
+		active.erase(std::remove_if(active.begin(), active.end(),
+			[y](const Edge* edge) { return edge->lastRow < y; }), active.end());
+		while (nextEdge < edges.size() && edges[nextEdge]->firstRow <= y)
+			active.push_back(edges[nextEdge++]);
+
+		double centerY = _grid.originY() - (y + .5) * pixelSizeY;
+		crossings.clear();
+		for (const Edge* edge : active)
+			crossings.push_back({ edge->feature,
+				edge->x0 + (centerY - edge->y0) * (edge->x1 - edge->x0) / (edge->y1 - edge->y0) });
+		std::sort(crossings.begin(), crossings.end());
+
+		// The crossings of a feature are paired in order (even-odd rule)
+		std::size_t i = 0;
+		while (i + 1 < crossings.size())
+		{
+			// Skipping the unpaired crossing of an invalid ring
+			if (crossings[i].feature != crossings[i + 1].feature)
+			{
+				++i;
+				continue;
+			}
+
+			// The columns with their centers in [x0, x1)
+			Run run;
+			run.x0 = static_cast<int>(std::ceil((crossings[i].x - _grid.originX()) / pixelSizeX - .5));
+			run.x1 = static_cast<int>(std::ceil((crossings[i + 1].x - _grid.originX()) / pixelSizeX - .5));
+			run.x0 = std::max(run.x0, 0);
+			run.x1 = std::min(run.x1, _grid.rasterSizeX());
+			run.feature = crossings[i].feature;
+			if (run.x0 < run.x1)
+				callback(y, run);
+			i += 2;
+		}
+	}
+}
+} // DEM
+} // CloudTools
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+
+#include "Metadata.h"
+
+class OGRGeometry;
+class OGRPolygon;
+
+namespace CloudTools
+{
+namespace DEM
+{
+/// <summary>
+/// Represents a scanline polygon fill on the rows of a raster grid.
+/// </summary>
+/// <remarks>
+/// A pixel is filled by a feature when its center is inside the polygons of the feature (even-odd rule),
+/// as with the default rasterization of GDAL. Once the features are added, the runs of disjoint
+/// row ranges can be computed and burned concurrently.
+/// </remarks>
+class ScanlineFill
+{
+public:
+	/// <summary>
+	/// Represents a horizontal run of pixels filled by a feature.
+	/// </summary>
+	struct Run
+	{
+		/// <summary>
+		/// The first column of the run (inclusive).
+		/// </summary>
+		int x0;
+		/// <summary>
+		/// The last column of the run (exclusive).
+		/// </summary>
+		int x1;
+		/// <summary>
+		/// The index of the feature in the order of addition.
+		/// </summary>
+		std::size_t feature;
+	};
+
+	typedef std::function<void(int, const Run&)> RunCallbackType;
+
+private:
+	struct Edge
+	{
+		double x0, y0, x1, y1;
+		int firstRow, lastRow;
+		std::size_t feature;
+	};
+
+	RasterMetadata _grid;
+	std::vector<Edge> _edges;
+	std::size_t _featureCount = 0;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class.
+	/// </summary>
+	/// <param name="grid">The raster grid to fill.</param>
+	explicit ScanlineFill(const RasterMetadata& grid)
+		: _grid(grid)
+	{ }
+
+	/// <summary>
+	/// Gets the raster grid to fill.
+	/// </summary>
+	const RasterMetadata& grid() const { return _grid; }
+
+	/// <summary>
+	/// Gets the number of added features.
+	/// </summary>
+	std::size_t featureCount() const { return _featureCount; }
+
+	/// <summary>
+	/// Adds the polygons of a geometry as the next feature.
+	/// </summary>
+	/// <remarks>
+	/// Non-polygonal parts of the geometry are ignored.
+	/// </remarks>
+	/// <param name="geometry">The geometry of the feature.</param>
+	/// <returns>The index of the feature.</returns>
+	std::size_t add(const OGRGeometry* geometry);
+
+	/// <summary>
+	/// Computes the runs of a range of rows.
+	/// </summary>
+	/// <remarks>
+	/// The runs are reported row by row, in a row ordered by their features, then by their first column.
+	/// </remarks>
+	/// <param name="fromY">The first row (inclusive).</param>
+	/// <param name="toY">The last row (exclusive).</param>
+	/// <param name="callback">The callback function receiving the row and the run.</param>
+	void runs(int fromY, int toY, const RunCallbackType& callback) const;
+
+	/// <summary>
+	/// Burns the features into a buffer of a range of rows, later features overwriting the earlier ones.
+	/// </summary>
+	/// <param name="buffer">The row-major buffer starting at the first row, with the width of the grid.</param>
+	/// <param name="fromY">The first row (inclusive).</param>
+	/// <param name="toY">The last row (exclusive).</param>
+	/// <param name="values">The values to burn for each feature.</param>
+	template <typename DataType>
+	void burn(DataType* buffer, int fromY, int toY, const std::vector<DataType>& values) const
+	{
+		const std::size_t sizeX = static_cast<std::size_t>(_grid.rasterSizeX());
+		runs(fromY, toY, [buffer, fromY, sizeX, &values](int y, const Run& run)
+		{
+			DataType* row = buffer + (y - fromY) * sizeX;
+			std::fill(row + run.x0, row + run.x1, values[run.feature]);
+		});
+	}
+
+private:
+	void addGeometry(const OGRGeometry* geometry, std::size_t feature);
+	void addPolygon(const OGRPolygon* polygon, std::size_t feature);
+};
+} // DEM
+} // CloudTools
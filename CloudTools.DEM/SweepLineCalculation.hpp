@@ -6,9 +6,15 @@
 #include <functional>
 #include <algorithm>
 #include <stdexcept>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
 
 #include <boost/filesystem.hpp>
 
+#include <CloudTools.Common/Metrics.h>
+#include <CloudTools.Common/Trace.h>
+
 #include "Calculation.h"
 #include "Window.hpp"
 #include "Metadata.h"
@@ -94,10 +100,50 @@ namespace DEM
 		void setRange(int value);
 
 	protected:
+		/// <summary>
+		/// Represents the state shared by the sweeps of the row bands of the target area.
+		/// </summary>
+		struct SweepContext
+		{
+			/// <summary>
+			/// Serializes the reads of the source bands, <c>nullptr</c> when they are not shared between threads.
+			/// </summary>
+			std::mutex* ioMutex = nullptr;
+			/// <summary>
+			/// Serializes the progress reports, <c>nullptr</c> for a single sweep.
+			/// </summary>
+			std::mutex* progressMutex = nullptr;
+			/// <summary>
+			/// The number of rows computed by all sweeps.
+			/// </summary>
+			std::atomic<int> rowCount{ 0 };
+		};
+
 		/// <summary>
 		/// Executes the computation on the target area.
 		/// </summary>
 		void onExecute() override;
+
+		/// <summary>
+		/// Gets the bands of the given source datasets to sweep.
+		/// </summary>
+		/// <param name="sourceDatasets">The datasets of the sources, respectively.</param>
+		std::vector<GDALRasterBand*> sourceBands(const std::vector<GDALDataset*>& sourceDatasets) const;
+
+		/// <summary>
+		/// Executes a computation on a band of rows of the target area.
+		/// </summary>
+		/// <remarks>
+		/// The metrics of the sweep are not recorded, as it might be executed on another thread.
+		/// </remarks>
+		/// <param name="sourceBands">The bands of the sources.</param>
+		/// <param name="fromY">The first row of the band.</param>
+		/// <param name="toY">The row after the last row of the band.</param>
+		/// <param name="computation">The computation to execute for each pixel.</param>
+		/// <param name="context">The state shared with the concurrent sweeps.</param>
+		/// <returns>The number of bytes read from the sources.</returns>
+		std::uint64_t sweep(const std::vector<GDALRasterBand*>& sourceBands, int fromY, int toY,
+		                    const ComputationType& computation, SweepContext& context);
 	};
 
 	template <typename SourceType>
@@ -138,11 +184,15 @@ namespace DEM
 		if (!computation)
 			throw std::logic_error("No computation method defined.");
 
-		// Determine computation progress steps
-		int computationSize = _targetMetadata.rasterSizeY();
-		int computationStep = computationSize / 199;
-		int computationProgress = 0;
+		SweepContext context;
+		std::uint64_t bytesRead = sweep(sourceBands(_sourceDatasets), 0, _targetMetadata.rasterSizeY(), computation, context);
+		Metrics::addRead(bytesRead);
+		Metrics::addPixels(static_cast<std::uint64_t>(_targetMetadata.rasterSizeX()) * _targetMetadata.rasterSizeY());
+	}
 
+	template <typename SourceType>
+	std::vector<GDALRasterBand*> SweepLineCalculation<SourceType>::sourceBands(const std::vector<GDALDataset*>& sourceDatasets) const
+	{
 		// Open and check bands
 		std::vector<GDALRasterBand*> sourceBands(sourceCount());
 		for (unsigned int i = 0; i < sourceCount(); ++i)
@@ -160,7 +210,7 @@ namespace DEM
 					? std::count(_sourcePaths.begin(), _sourcePaths.begin() + i, _sourcePaths[i]) + 1
 					: std::count(_sourceDatasets.begin(), _sourceDatasets.begin() + i, _sourceDatasets[i]) + 1;
 			}
-			sourceBands[i] = _sourceDatasets[i]->GetRasterBand(static_cast<int>(bandIndex));
+			sourceBands[i] = sourceDatasets[i]->GetRasterBand(static_cast<int>(bandIndex));
 		}
 
 		GDALDataType sourceType = gdalType<SourceType>();
@@ -170,6 +220,17 @@ namespace DEM
 			return band->GetRasterDataType() != sourceType;
 		}))
 			throw std::domain_error("The data type of a source band does not match with the given data type.");
+		return sourceBands;
+	}
+
+	template <typename SourceType>
+	std::uint64_t SweepLineCalculation<SourceType>::sweep(const std::vector<GDALRasterBand*>& sourceBands, int fromY, int toY,
+	                                                      const ComputationType& computation, SweepContext& context)
+	{
+		// Determine computation progress steps
+		int computationSize = _targetMetadata.rasterSizeY();
+		int computationStep = std::max(1, computationSize / 199);
+		GDALDataType sourceType = gdalType<SourceType>();
 
 		// Define windows
 		int windowSize = 2 * _range + 1;
@@ -177,47 +238,58 @@ namespace DEM
 		dataWindows.reserve(sourceCount());
 
 		// Read sources and execute computation
-		SourceType** sourceScanlines = new SourceType*[sourceCount()];
+		std::vector<std::vector<SourceType>> sourceScanlines(sourceCount());
 		for (unsigned int i = 0; i < sourceCount(); ++i)
-			sourceScanlines[i] = new SourceType[_sourceMetadata[i].rasterSizeX() * windowSize];
+			sourceScanlines[i].resize(static_cast<std::size_t>(_sourceMetadata[i].rasterSizeX()) * windowSize);
 
-		for (int y = 0; y < _targetMetadata.rasterSizeY(); ++y)
+		// Rows are traced in batches to keep the timeline compact
+		std::uint64_t bytesRead = 0;
+		std::int64_t batchStart = Trace::now();
+		int batchFrom = fromY;
+		for (int y = fromY; y < toY; ++y)
 		{
 			CPLErr ioResult = CE_None;
 
 			dataWindows.clear();
-			for (unsigned int i = 0; i < sourceCount(); ++i)
 			{
-				int sourceOffsetX = static_cast<int>((_sourceMetadata[i].originX() - _targetMetadata.originX()) / std::abs(_targetMetadata.pixelSizeX()));
-				int sourceOffsetY = static_cast<int>((_targetMetadata.originY() - _sourceMetadata[i].originY()) / std::abs(_targetMetadata.pixelSizeY()));
+				std::unique_lock<std::mutex> lock;
+				if (context.ioMutex)
+					lock = std::unique_lock<std::mutex>(*context.ioMutex);
 
-				if (y + _range >= sourceOffsetY &&
-					y - _range < sourceOffsetY + _sourceMetadata[i].rasterSizeY())
+				for (unsigned int i = 0; i < sourceCount(); ++i)
 				{
-					int readOffsetX = 0;
-					int readOffsetY = std::max(0, -sourceOffsetY + y - _range);
-					int readSizeX = _sourceMetadata[i].rasterSizeX();
-					int readSizeY = -readOffsetY + std::min(readOffsetY + windowSize, _sourceMetadata[i].rasterSizeY());
-
-					ioResult = static_cast<CPLErr>(ioResult | 
-						sourceBands[i]->RasterIO(GF_Read,
-							readOffsetX, readOffsetY,
+					int sourceOffsetX = static_cast<int>((_sourceMetadata[i].originX() - _targetMetadata.originX()) / std::abs(_targetMetadata.pixelSizeX()));
+					int sourceOffsetY = static_cast<int>((_targetMetadata.originY() - _sourceMetadata[i].originY()) / std::abs(_targetMetadata.pixelSizeY()));
+
+					if (y + _range >= sourceOffsetY &&
+						y - _range < sourceOffsetY + _sourceMetadata[i].rasterSizeY())
+					{
+						int readOffsetX = 0;
+						int readOffsetY = std::max(0, -sourceOffsetY + y - _range);
+						int readSizeX = _sourceMetadata[i].rasterSizeX();
+						int readSizeY = -readOffsetY + std::min(readOffsetY + windowSize, _sourceMetadata[i].rasterSizeY());
+
+						ioResult = static_cast<CPLErr>(ioResult | 
+							sourceBands[i]->RasterIO(GF_Read,
+								readOffsetX, readOffsetY,
+								readSizeX, readSizeY,
+								sourceScanlines[i].data(), _sourceMetadata[i].rasterSizeX(), windowSize,
+								sourceType, 0, 0));
+						bytesRead += static_cast<std::uint64_t>(readSizeX) * readSizeY * sizeof(SourceType);
+
+						dataWindows.emplace_back(sourceScanlines[i].data(), 
+							static_cast<SourceType>(sourceBands[i]->GetNoDataValue()),
 							readSizeX, readSizeY,
-							sourceScanlines[i], _sourceMetadata[i].rasterSizeX(), windowSize,
-							sourceType, 0, 0));
-
-					dataWindows.emplace_back(sourceScanlines[i], 
-						static_cast<SourceType>(sourceBands[i]->GetNoDataValue()),
-						readSizeX, readSizeY,
-						sourceOffsetX + readOffsetX, sourceOffsetY + readOffsetY,
-						0, y);
+							sourceOffsetX + readOffsetX, sourceOffsetY + readOffsetY,
+							0, y);
+					}
+					else
+						dataWindows.emplace_back(sourceScanlines[i].data(), 
+							static_cast<SourceType>(sourceBands[i]->GetNoDataValue()),
+							0, 0,
+							sourceOffsetX, sourceOffsetY,
+							0, y);
 				}
-				else
-					dataWindows.emplace_back(sourceScanlines[i], 
-						static_cast<SourceType>(sourceBands[i]->GetNoDataValue()),
-						0, 0,
-						sourceOffsetX, sourceOffsetY,
-						0, y);
 			}
 			if (ioResult != CE_None)
 				throw std::runtime_error("Source read error occured.");
@@ -229,13 +301,24 @@ namespace DEM
 				computation(x, y, dataWindows);
 			}
 
-			if (progress && (computationProgress++ % computationStep == 0 || computationProgress == computationSize))
+			int computationProgress = ++context.rowCount;
+			if (progress && (computationProgress % computationStep == 1 || computationStep == 1 || computationProgress == computationSize))
+			{
+				std::unique_lock<std::mutex> lock;
+				if (context.progressMutex)
+					lock = std::unique_lock<std::mutex>(*context.progressMutex);
 				progress(1.f * computationProgress / computationSize, std::string());
-		}
+			}
 
-		for (unsigned int i = 0; i < sourceCount(); ++i)
-			delete[] sourceScanlines[i];
-		delete[] sourceScanlines;
+			if (Trace::isEnabled() && ((y + 1) % Trace::RowBatch == 0 || y + 1 == toY))
+			{
+				Trace::complete("sweep", "rows", batchStart,
+				                std::to_string(batchFrom) + "-" + std::to_string(y));
+				batchStart = Trace::now();
+				batchFrom = y + 1;
+			}
+		}
+		return bytesRead;
 	}
 } // DEM
 } // CloudTools
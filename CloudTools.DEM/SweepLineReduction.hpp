@@ -0,0 +1,235 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+#include <CloudTools.Common/ThreadPool.h>
+#include <CloudTools.Common/Metrics.h>
+
+#include "SweepLineCalculation.hpp"
+
+namespace CloudTools
+{
+namespace DEM
+{
+	/// <summary>
+	/// Represents a sweepline calculation on DEM datasets reducing the pixels into a single result.
+	/// </summary>
+	/// <remarks>
+	/// The target area is divided into bands of rows, which are swept concurrently. Each band accumulates
+	/// into its own state, then the states are merged in the order of the bands, so the result does not
+	/// depend on the number of threads. Sources opened from files are reopened for each band and read
+	/// concurrently, while the reads of the given source datasets are serialized.
+	/// The <see cref="computation" /> of the base class is not used.
+	/// </remarks>
+	template <typename SourceType, typename StateType>
+	class SweepLineReduction : public SweepLineCalculation<SourceType>
+	{
+	public:
+		typedef std::function<void(int, int, const std::vector<Window<SourceType>>&, StateType&)> AccumulationType;
+		typedef std::function<void(StateType&, const StateType&)> MergeType;
+		typedef std::function<void(StateType&)> FinalizeType;
+		typedef typename SweepLineCalculation<SourceType>::ProgressType ProgressType;
+
+		/// <summary>
+		/// The callback function accumulating a pixel into the state of its band.
+		/// </summary>
+		AccumulationType accumulation;
+		/// <summary>
+		/// The callback function merging the state of a band (second argument) into the result (first argument).
+		/// </summary>
+		MergeType merge;
+		/// <summary>
+		/// The optional callback function computing the final result from the merged states.
+		/// </summary>
+		FinalizeType finalize;
+
+		/// <summary>
+		/// The number of rows in a band.
+		/// </summary>
+		int bandHeight = 256;
+
+		/// <summary>
+		/// The number of threads sweeping the bands.
+		/// </summary>
+		/// <remarks>
+		/// Default value 0 means the number of concurrent threads supported by the hardware.
+		/// </remarks>
+		unsigned int threadCount = 0;
+
+	private:
+		StateType _initial;
+		StateType _result;
+
+	public:
+		/// <summary>
+		/// Initializes a new instance of the class and loads source metadata.
+		/// </summary>
+		/// <param name="sourcePaths">The source files of the calculation.</param>
+		/// <param name="range">The range of surrounding data to involve in the computations.</param>
+		/// <param name="initial">The initial state of the bands, the identity of the merge.</param>
+		/// <param name="accumulation">The callback function for accumulation.</param>
+		/// <param name="merge">The callback function for merging the states of the bands.</param>
+		/// <param name="progress">The callback method to report progress.</param>
+		SweepLineReduction(const std::vector<std::string>& sourcePaths,
+		                   int range,
+		                   const StateType& initial,
+		                   AccumulationType accumulation,
+		                   MergeType merge,
+		                   ProgressType progress = nullptr)
+			: SweepLineCalculation<SourceType>(sourcePaths, range, nullptr, progress),
+			  accumulation(accumulation), merge(merge),
+			  _initial(initial), _result(initial)
+		{ }
+
+		/// <summary>
+		/// Initializes a new instance of the class and loads source metadata.
+		/// </summary>
+		/// <param name="sourceDatasets">The source datasets of the calculation.</param>
+		/// <param name="range">The range of surrounding data to involve in the computations.</param>
+		/// <param name="initial">The initial state of the bands, the identity of the merge.</param>
+		/// <param name="accumulation">The callback function for accumulation.</param>
+		/// <param name="merge">The callback function for merging the states of the bands.</param>
+		/// <param name="progress">The callback method to report progress.</param>
+		SweepLineReduction(const std::vector<GDALDataset*>& sourceDatasets,
+		                   int range,
+		                   const StateType& initial,
+		                   AccumulationType accumulation,
+		                   MergeType merge,
+		                   ProgressType progress = nullptr)
+			: SweepLineCalculation<SourceType>(sourceDatasets, range, nullptr, progress),
+			  accumulation(accumulation), merge(merge),
+			  _initial(initial), _result(initial)
+		{ }
+
+		SweepLineReduction(const SweepLineReduction&) = delete;
+		SweepLineReduction& operator=(const SweepLineReduction&) = delete;
+
+		/// <summary>
+		/// Gets the result of the reduction.
+		/// </summary>
+		const StateType& result() const { return _result; }
+
+		/// <summary>
+		/// Gets the result of the reduction.
+		/// </summary>
+		StateType& result() { return _result; }
+
+	protected:
+		/// <summary>
+		/// Executes the reduction on the target area.
+		/// </summary>
+		void onExecute() override;
+	};
+
+	template <typename SourceType, typename StateType>
+	void SweepLineReduction<SourceType, StateType>::onExecute()
+	{
+		if (!accumulation)
+			throw std::logic_error("No accumulation method defined.");
+		if (!merge)
+			throw std::logic_error("No merge method defined.");
+		if (bandHeight < 1)
+			throw std::out_of_range("Band height must be positive.");
+
+		int sizeY = this->_targetMetadata.rasterSizeY();
+		int bandCount = (sizeY + bandHeight - 1) / bandHeight;
+		std::size_t threads = threadCount > 0 ? threadCount : std::thread::hardware_concurrency();
+		threads = std::max<std::size_t>(1, std::min<std::size_t>(threads, bandCount));
+
+		std::vector<StateType> states(bandCount, _initial);
+		std::vector<std::uint64_t> bytesRead(bandCount, 0);
+		std::vector<GDALRasterBand*> sharedBands = this->sourceBands(this->_sourceDatasets);
+		std::mutex ioMutex, progressMutex;
+		typename SweepLineCalculation<SourceType>::SweepContext context;
+		if (threads > 1)
+		{
+			context.ioMutex = !this->_sourceOwnership ? &ioMutex : nullptr;
+			context.progressMutex = &progressMutex;
+		}
+
+		auto sweepBand = [&](int band)
+		{
+			// Sources opened from files are reopened, as a GDAL dataset must not be accessed from multiple threads
+			std::vector<std::shared_ptr<GDALDataset>> datasets;
+			std::vector<GDALRasterBand*> bands = sharedBands;
+			if (threads > 1 && this->_sourceOwnership)
+			{
+				std::vector<GDALDataset*> sourceDatasets;
+				for (const std::string& path : this->_sourcePaths)
+				{
+					GDALDataset* dataset = static_cast<GDALDataset*>(GDALOpen(path.c_str(), GA_ReadOnly));
+					if (dataset == nullptr)
+						throw std::runtime_error("Error at opening a source file.");
+					datasets.emplace_back(dataset, [](GDALDataset* dataset) { GDALClose(dataset); });
+					sourceDatasets.push_back(dataset);
+				}
+				bands = this->sourceBands(sourceDatasets);
+			}
+
+			StateType& state = states[band];
+			bytesRead[band] = this->sweep(bands,
+				band * bandHeight, std::min(sizeY, (band + 1) * bandHeight),
+				[this, &state](int x, int y, const std::vector<Window<SourceType>>& data)
+				{
+					accumulation(x, y, data, state);
+				},
+				context);
+		};
+
+		if (threads == 1)
+		{
+			for (int band = 0; band < bandCount; ++band)
+				sweepBand(band);
+		}
+		else
+		{
+			// The remaining bands are skipped after a failure
+			std::atomic<bool> isFailed(false);
+			std::vector<std::future<void>> futures;
+			futures.reserve(bandCount);
+			{
+				ThreadPool pool(threads);
+				for (int band = 0; band < bandCount; ++band)
+					futures.push_back(pool.submit([&, band]()
+					{
+						if (isFailed)
+							return;
+						try
+						{
+							sweepBand(band);
+						}
+						catch (...)
+						{
+							isFailed = true;
+							throw;
+						}
+					}));
+			}
+			for (std::future<void>& future : futures)
+				future.get();
+		}
+
+		// Merge the states in the order of the bands
+		_result = _initial;
+		for (const StateType& state : states)
+			merge(_result, state);
+		if (finalize)
+			finalize(_result);
+
+		std::uint64_t totalRead = 0;
+		for (std::uint64_t bytes : bytesRead)
+			totalRead += bytes;
+		Metrics::addRead(totalRead);
+		Metrics::addPixels(static_cast<std::uint64_t>(this->_targetMetadata.rasterSizeX()) * sizeY);
+	}
+} // DEM
+} // CloudTools
@@ -9,6 +9,9 @@
 
 #include <boost/filesystem.hpp>
 
+#include <CloudTools.Common/Metrics.h>
+#include <CloudTools.Common/Trace.h>
+
 #include "Transformation.h"
 #include "Window.hpp"
 #include "Metadata.h"
@@ -165,38 +168,11 @@ void SweepLineTransformation<TargetType, SourceType>::onExecute()
 	if (!computation)
 		throw std::logic_error("No computation method defined.");
 
-	// Create and open the target file
-	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName(targetFormat.c_str());
-	if (driver == nullptr)
-		throw std::invalid_argument("Target output format unrecognized.");
-
-	if (fs::exists(_targetPath) &&
-		driver->Delete(_targetPath.c_str()) == CE_Failure &&
-		!fs::remove(_targetPath))
-		throw std::runtime_error("Cannot overwrite previously created target file.");
-
 	GDALDataType sourceType = gdalType<SourceType>();
 	GDALDataType targetType = gdalType<TargetType>();
 
-	char **targetParams = nullptr;
-	for (auto& co : createOptions)
-		targetParams = CSLSetNameValue(targetParams, co.first.c_str(), co.second.c_str());
-
-	_targetDataset = driver->Create(_targetPath.c_str(),
-		_targetMetadata.rasterSizeX(), _targetMetadata.rasterSizeY(), 1,
-		targetType, targetParams);
-	CSLDestroy(targetParams);
-	if (_targetDataset == nullptr)
-		throw std::runtime_error("Target file creation failed.");
-
-	_targetDataset->SetGeoTransform(&_targetMetadata.geoTransform()[0]);
-	if (_targetMetadata.reference().Validate() == OGRERR_NONE)
-	{
-		char *wkt;
-		_targetMetadata.reference().exportToWkt(&wkt);
-		_targetDataset->SetProjection(wkt);
-		CPLFree(wkt);
-	}
+	// Create and open the target file
+	createTarget(_targetMetadata, targetType);
 
 	// Determine computation progress steps
 	int computationSize = _targetMetadata.rasterSizeY();
@@ -243,6 +219,8 @@ void SweepLineTransformation<TargetType, SourceType>::onExecute()
 		sourceScanlines[i] = new SourceType[_sourceMetadata[i].rasterSizeX() * windowSize];
 	TargetType* targetScanline = new TargetType[_targetMetadata.rasterSizeX()];
 
+	// Rows are traced in batches to keep the timeline compact
+	std::int64_t batchStart = Trace::now();
 	for (int y = 0; y < _targetMetadata.rasterSizeY(); ++y)
 	{
 		CPLErr ioResult = CE_None;
@@ -267,6 +245,7 @@ void SweepLineTransformation<TargetType, SourceType>::onExecute()
 						readSizeX, readSizeY,
 						sourceScanlines[i], _sourceMetadata[i].rasterSizeX(), windowSize,
 						sourceType, 0, 0));
+				Metrics::addRead(static_cast<std::uint64_t>(readSizeX) * readSizeY * sizeof(SourceType));
 
 				dataWindows.emplace_back(sourceScanlines[i], 
 					static_cast<SourceType>(sourceBands[i]->GetNoDataValue()),
@@ -298,15 +277,25 @@ void SweepLineTransformation<TargetType, SourceType>::onExecute()
 			targetType, 0, 0);
 		if (ioResult != CE_None)
 			throw std::runtime_error("Target write error occured.");
+		Metrics::addWritten(static_cast<std::uint64_t>(_targetMetadata.rasterSizeX()) * sizeof(TargetType));
+		Metrics::addPixels(_targetMetadata.rasterSizeX());
 
 		if (progress && (computationProgress++ % computationStep == 0 || computationProgress == computationSize))
 			progress(1.f * computationProgress / computationSize, std::string());
+
+		if (Trace::isEnabled() && ((y + 1) % Trace::RowBatch == 0 || y + 1 == _targetMetadata.rasterSizeY()))
+		{
+			Trace::complete("sweep", "rows", batchStart,
+			                std::to_string(y / Trace::RowBatch * Trace::RowBatch) + "-" + std::to_string(y));
+			batchStart = Trace::now();
+		}
 	}
 
 	for (unsigned int i = 0; i < sourceCount(); ++i)
 		delete[] sourceScanlines[i];
 	delete[] sourceScanlines;
 	delete[] targetScanline;
+	completeTarget();
 }
 } // DEM
 } // CloudTools
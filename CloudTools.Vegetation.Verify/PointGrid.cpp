@@ -0,0 +1,92 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "PointGrid.h"
+
+namespace CloudTools
+{
+namespace Vegetation
+{
+PointGrid::PointGrid(const std::vector<OGRPoint>& points, double cellSize)
+	: _originX(0), _originY(0), _cellSize(1), _cellsX(1), _cellsY(1)
+{
+	double minX = std::numeric_limits<double>::max(), minY = std::numeric_limits<double>::max();
+	double maxX = std::numeric_limits<double>::lowest(), maxY = std::numeric_limits<double>::lowest();
+	for (const OGRPoint& point : points)
+	{
+		minX = std::min(minX, point.getX());
+		minY = std::min(minY, point.getY());
+		maxX = std::max(maxX, point.getX());
+		maxY = std::max(maxY, point.getY());
+	}
+
+	if (!points.empty())
+	{
+		_originX = minX;
+		_originY = minY;
+
+		// Limit the number of cells for small radii over large extents.
+		const double maxCells = 1 << 24;
+		double extent = std::max(maxX - minX, maxY - minY);
+		_cellSize = std::max(cellSize, std::max(extent / std::sqrt(maxCells), 1e-6));
+		_cellsX = static_cast<int>((maxX - minX) / _cellSize) + 1;
+		_cellsY = static_cast<int>((maxY - minY) / _cellSize) + 1;
+	}
+
+	// Counting sort of the points by cell
+	std::vector<std::size_t> cells(points.size());
+	_cellStarts.assign(static_cast<std::size_t>(_cellsX) * _cellsY + 1, 0);
+	for (std::size_t i = 0; i < points.size(); ++i)
+	{
+		cells[i] = static_cast<std::size_t>(cellY(points[i].getY())) * _cellsX + cellX(points[i].getX());
+		++_cellStarts[cells[i] + 1];
+	}
+	for (std::size_t c = 1; c < _cellStarts.size(); ++c)
+		_cellStarts[c] += _cellStarts[c - 1];
+
+	std::vector<std::size_t> positions(_cellStarts.begin(), _cellStarts.end() - 1);
+	_pointsX.resize(points.size());
+	_pointsY.resize(points.size());
+	for (std::size_t i = 0; i < points.size(); ++i)
+	{
+		std::size_t position = positions[cells[i]]++;
+		_pointsX[position] = points[i].getX();
+		_pointsY[position] = points[i].getY();
+	}
+}
+
+bool PointGrid::hasPointWithin(double x, double y, double radius) const
+{
+	if (_pointsX.empty())
+		return false;
+
+	int fromX = cellX(x - radius), toX = cellX(x + radius);
+	int fromY = cellY(y - radius), toY = cellY(y + radius);
+	for (int cy = fromY; cy <= toY; ++cy)
+	{
+		std::size_t row = static_cast<std::size_t>(cy) * _cellsX;
+		for (std::size_t p = _cellStarts[row + fromX]; p < _cellStarts[row + toX + 1]; ++p)
+		{
+			double dx = _pointsX[p] - x;
+			double dy = _pointsY[p] - y;
+			if (std::sqrt(dx * dx + dy * dy) <= radius)
+				return true;
+		}
+	}
+	return false;
+}
+
+int PointGrid::cellX(double x) const
+{
+	double cell = std::floor((x - _originX) / _cellSize);
+	return static_cast<int>(std::max(0.0, std::min(cell, _cellsX - 1.0)));
+}
+
+int PointGrid::cellY(double y) const
+{
+	double cell = std::floor((y - _originY) / _cellSize);
+	return static_cast<int>(std::max(0.0, std::min(cell, _cellsY - 1.0)));
+}
+} // Vegetation
+} // CloudTools
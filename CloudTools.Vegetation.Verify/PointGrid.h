@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <ogr_geometry.h>
+
+namespace CloudTools
+{
+namespace Vegetation
+{
+/// <summary>
+/// Represents a uniform grid index over a set of points for fixed radius queries.
+/// </summary>
+/// <remarks>
+/// The points are stored in cell order (compressed rows), so a query only visits
+/// the cells overlapping the bounding box of the search circle.
+/// The index is immutable after construction, therefore concurrent queries are safe.
+/// </remarks>
+class PointGrid
+{
+private:
+	double _originX, _originY;
+	double _cellSize;
+	int _cellsX, _cellsY;
+
+	std::vector<std::size_t> _cellStarts;
+	std::vector<double> _pointsX, _pointsY;
+
+public:
+	/// <summary>
+	/// Initializes a new instance of the class.
+	/// </summary>
+	/// <param name="points">The points to index.</param>
+	/// <param name="cellSize">The preferred size of a grid cell, usually the maximal search radius.</param>
+	PointGrid(const std::vector<OGRPoint>& points, double cellSize);
+
+	/// <summary>
+	/// Determines whether any indexed point is within the given distance of a location.
+	/// </summary>
+	/// <param name="x">The abcissa of the location.</param>
+	/// <param name="y">The ordinate of the location.</param>
+	/// <param name="radius">The maximal distance (inclusive).</param>
+	/// <returns><c>true</c> if a point was found; otherwise <c>false</c>.</returns>
+	bool hasPointWithin(double x, double y, double radius) const;
+
+private:
+	int cellX(double x) const;
+	int cellY(double y) const;
+};
+} // Vegetation
+} // CloudTools
@@ -3,6 +3,9 @@
 #include <string>
 #include <vector>
 #include <numeric>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 #include <chrono>
 #include <ctime>
 #include <stdexcept>
@@ -16,11 +19,14 @@
 #include <CloudTools.Common/IO/Reporter.h>
 #include <CloudTools.DEM/Metadata.h>
 
+#include "PointGrid.h"
+
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
 using namespace CloudTools::DEM;
 using namespace CloudTools::IO;
+using namespace CloudTools::Vegetation;
 
 struct Tree
 {
@@ -47,6 +53,7 @@ int main(int argc, char* argv[]) try
 	unsigned int maxYear = 9999;
 	unsigned int minRadius = 0;
 	unsigned int minTolerance = 3;
+	unsigned short maxJobs = std::thread::hardware_concurrency();
 
 	// Read console arguments
 	po::options_description desc("Allowed options");
@@ -67,6 +74,8 @@ int main(int argc, char* argv[]) try
 		 "minimum tree radius")
 		("min-tolerance", po::value<unsigned int>(&minTolerance)->default_value(minTolerance),
 		 "minimum distance tolerance for matching")
+		("jobs,j", po::value<unsigned short>(&maxJobs)->default_value(maxJobs),
+		 "number of threads used for matching")
 		("verbose,v", "verbose output")
 		("help,h", "produce help message");
 
@@ -106,6 +115,12 @@ int main(int argc, char* argv[]) try
 	}
 
 
+	if (maxJobs == 0)
+	{
+		std::cerr << "The number of jobs must be positive." << std::endl;
+		argumentError = true;
+	}
+
 	if (argumentError)
 	{
 		std::cerr << "Use the --help option for description." << std::endl;
@@ -196,7 +211,7 @@ int main(int argc, char* argv[]) try
 	OGRFeature* feature;
 	OGRGeometry* geometry;
 	OGRPoint* point;
-	OGRCoordinateTransformation* transformation;
+	OGRCoordinateTransformation* transformation = nullptr;
 
 	std::vector<OGRPoint> inputTrees;
 	inputTrees.reserve(inputLayer->GetFeatureCount());
@@ -271,29 +286,53 @@ int main(int argc, char* argv[]) try
 	reporter->report(0.f, "Verification");
 
 	// Verification: matching input and reference trees
-	bool found;
-	unsigned int counter = 0;
-	std::vector<Tree> matched, missed;
+	double searchRadius = minTolerance;
 	for (const auto& referenceTree : referenceTrees)
+		searchRadius = std::max(searchRadius, static_cast<double>(referenceTree.radius));
+	PointGrid inputIndex(inputTrees, searchRadius);
+
+	// Reference trees are matched in parallel by chunks, the results are collected in the original order.
+	const std::size_t chunkSize = 1024;
+	std::size_t chunkCount = (referenceTrees.size() + chunkSize - 1) / chunkSize;
+	std::vector<char> found(referenceTrees.size(), false);
+	std::atomic<std::size_t> nextChunk(0);
+	std::atomic<std::size_t> counter(0);
+
+	auto matchChunks = [&](bool reportProgress)
 	{
-		found = false;
-		for (const auto& inputTreeLocation : inputTrees)
+		std::size_t chunk;
+		while ((chunk = nextChunk++) < chunkCount)
 		{
-			if (referenceTree.location.Distance(&inputTreeLocation) <= std::max(referenceTree.radius, (int)minTolerance))
+			std::size_t from = chunk * chunkSize;
+			std::size_t to = std::min(from + chunkSize, referenceTrees.size());
+			for (std::size_t i = from; i < to; ++i)
 			{
-				found = true;
-				break;
+				const Tree& referenceTree = referenceTrees[i];
+				found[i] = inputIndex.hasPointWithin(referenceTree.location.getX(),
+				                                     referenceTree.location.getY(),
+				                                     std::max(referenceTree.radius, (int)minTolerance));
 			}
+
+			std::size_t processed = counter += to - from;
+			if (reportProgress)
+				reporter->report(processed * 1.f / referenceTrees.size(), "Verification");
 		}
+	};
 
-		if (found)
-			matched.push_back(referenceTree);
-		else
-			missed.push_back(referenceTree);
+	std::vector<std::thread> workers;
+	for (unsigned short i = 1; i < std::min<std::size_t>(maxJobs, chunkCount); ++i)
+		workers.emplace_back(matchChunks, false);
+	matchChunks(true);
+	for (std::thread& worker : workers)
+		worker.join();
 
-		++counter;
-		if ((counter) % 100 == 0)
-			reporter->report(counter * 1.f / referenceTrees.size(), "Verification");
+	std::vector<Tree> matched, missed;
+	for (std::size_t i = 0; i < referenceTrees.size(); ++i)
+	{
+		if (found[i])
+			matched.push_back(referenceTrees[i]);
+		else
+			missed.push_back(referenceTrees[i]);
 	}
 	reporter->report(1.f, "Verification");
 	delete reporter;
@@ -3,9 +3,9 @@
 #include <string>
 #include <vector>
 #include <cmath>
-#include <iostream>
+#include <numeric>
+#include <algorithm>
 #include <CloudTools.DEM/SweepLineCalculation.hpp>
-#include <CloudTools.DEM/DatasetCalculation.hpp>
 
 
 namespace CloudTools::DEM
@@ -13,8 +13,13 @@ namespace CloudTools::DEM
 /// <summary>
 /// Represents the removal of false positive seed points close to buildings
 /// </summary>
+/// <remarks>
+/// The terrain and surface models are read in a single sequential sweep. A sliding summed-area table
+/// of the "no terrain and surface above 10 meters" predicate is maintained over the last rows of the sweep,
+/// so that the window around each seed point is evaluated in constant time.
+/// </remarks>
 template <typename DataType = float>
-class BuildingFacadeSeedRemoval : public DatasetCalculation<DataType>
+class BuildingFacadeSeedRemoval : public SweepLineCalculation<DataType>
 {
 	std::vector<OGRPoint> &seedPoints;
 public:
@@ -28,7 +33,7 @@ public:
 	                          const std::vector<std::string>& sourcePaths,
 	                          Operation::ProgressType progress = nullptr,
 							  int threshold = 20)
-		: DatasetCalculation<DataType>(sourcePaths, nullptr, progress),
+		: SweepLineCalculation<DataType>(sourcePaths, nullptr, progress),
 		    seedPoints(seedPoints),
 			threshold(threshold)
 	{
@@ -38,41 +43,158 @@ public:
 	BuildingFacadeSeedRemoval(const BuildingFacadeSeedRemoval&) = delete;
 	BuildingFacadeSeedRemoval& operator=(const BuildingFacadeSeedRemoval&) = delete;
 
+protected:
+	/// <summary>
+	/// Sweeps the sources, evaluates the seed points and compacts the accepted ones.
+	/// </summary>
+	void onExecute() override;
+
 private:
+	/// <summary>
+	/// Range of the inspected window around a seed point (window size = range * 2 + 1).
+	/// </summary>
+	const int windowRange = 3;
+	/// <summary>
+	/// Surface height above which a missing terrain value is considered a building.
+	/// </summary>
+	const DataType surfaceThreshold = 10;
+
+	int _sizeX;
+	int _sizeY;
+	int _windowSize;
+	bool _outsideMatches;
+
+	std::vector<GByte> _rowFlags;
+	std::vector<int> _columnSums;
+	std::vector<int> _prefixSums;
+
+	std::vector<std::size_t> _seedOrder;
+	std::size_t _nextSeed;
+	std::vector<bool> _rejected;
+
 	/// <summary>
 	/// Initializes the new instance of the class.
 	/// </summary>
 	void initialize();
+
+	/// <summary>
+	/// Adds the predicate value of a pixel to the sliding table.
+	/// </summary>
+	void accumulate(int x, int y, bool flag);
+
+	/// <summary>
+	/// Evaluates the seed points centered in the given row.
+	/// </summary>
+	/// <remarks>
+	/// The sliding table must contain the rows of the window around <paramref name="centerY" />.
+	/// </remarks>
+	void evaluateRow(int centerY);
 };
 
 template <typename DataType>
 void BuildingFacadeSeedRemoval<DataType>::initialize()
 {
-	this->computation = [this](int x, int y)
+	this->computation = [this](int x, int y, const std::vector<Window<DataType>>& sources)
+	{
+		accumulate(x, y, !sources[0].hasData() && sources[1].data() > surfaceThreshold);
+		if (x == _sizeX - 1)
+			evaluateRow(y - windowRange);
+	};
+}
+
+template <typename DataType>
+void BuildingFacadeSeedRemoval<DataType>::onExecute()
+{
+	_sizeX = this->_targetMetadata.rasterSizeX();
+	_sizeY = this->_targetMetadata.rasterSizeY();
+	_windowSize = 2 * windowRange + 1;
+
+	// Pixels outside of the rasters have no terrain data and the surface nodata value.
+	int surfaceBand = this->bands.size() > 1 ? this->bands[1] : 1;
+	_outsideMatches = static_cast<DataType>(
+		this->_sourceDatasets[1]->GetRasterBand(surfaceBand)->GetNoDataValue()) > surfaceThreshold;
+
+	_rowFlags.assign(static_cast<std::size_t>(_sizeX) * _windowSize, 0);
+	_columnSums.assign(_sizeX, 0);
+	_prefixSums.assign(_sizeX + 1, 0);
+
+	_seedOrder.resize(seedPoints.size());
+	std::iota(_seedOrder.begin(), _seedOrder.end(), 0);
+	std::stable_sort(_seedOrder.begin(), _seedOrder.end(),
+		[this](std::size_t a, std::size_t b)
+		{
+			return seedPoints[a].getY() < seedPoints[b].getY();
+		});
+	_nextSeed = 0;
+	_rejected.assign(seedPoints.size(), false);
+
+	SweepLineCalculation<DataType>::onExecute();
+
+	// Flush the rows still pending at the bottom of the rasters.
+	for (int y = _sizeY; y < _sizeY + windowRange; ++y)
 	{
-		std::vector<int> idxs;
-		int c = 0;
-		for (auto& point: seedPoints)
+		for (int x = 0; x < _sizeX; ++x)
+			accumulate(x, y, false);
+		evaluateRow(y - windowRange);
+	}
+
+	std::size_t kept = 0;
+	for (std::size_t i = 0; i < seedPoints.size(); ++i)
+		if (!_rejected[i])
 		{
-			int counter = 0;
-			int ws = 3; // window size = ws*2 + 1
-			int px = point.getX();
-			int py = point.getY();
-			for(int i = px - ws; i <= px + ws; i++){
-				for(int j = py - ws; j <= py + ws; j++){
-					if(!this->hasSourceData(0,i,j) && this->sourceData(1,i,j) > 10){
-						counter++;
-					}
-				}
-			}
-			if(counter > threshold){
-				idxs.push_back(c);
-			}
-			c++;
+			if (kept != i)
+				seedPoints[kept] = seedPoints[i];
+			++kept;
 		}
-		for (int i = idxs.size() - 1; i >= 0; --i) {
-			seedPoints.erase(seedPoints.begin() + idxs[i]);
+	seedPoints.erase(seedPoints.begin() + kept, seedPoints.end());
+
+	_rowFlags.clear();
+	_columnSums.clear();
+	_prefixSums.clear();
+	_seedOrder.clear();
+	_rejected.clear();
+}
+
+template <typename DataType>
+void BuildingFacadeSeedRemoval<DataType>::accumulate(int x, int y, bool flag)
+{
+	GByte& cell = _rowFlags[static_cast<std::size_t>(y % _windowSize) * _sizeX + x];
+	_columnSums[x] += static_cast<int>(flag) - cell;
+	cell = flag;
+}
+
+template <typename DataType>
+void BuildingFacadeSeedRemoval<DataType>::evaluateRow(int centerY)
+{
+	// Seed points above the processed rows cannot be evaluated anymore.
+	while (_nextSeed < _seedOrder.size() && seedPoints[_seedOrder[_nextSeed]].getY() < centerY)
+		++_nextSeed;
+	if (_nextSeed == _seedOrder.size() || seedPoints[_seedOrder[_nextSeed]].getY() > centerY)
+		return;
+
+	std::partial_sum(_columnSums.begin(), _columnSums.end(), _prefixSums.begin() + 1);
+
+	int insideY = std::max(0,
+		std::min(_sizeY - 1, centerY + windowRange) - std::max(0, centerY - windowRange) + 1);
+	for (; _nextSeed < _seedOrder.size() && seedPoints[_seedOrder[_nextSeed]].getY() == centerY; ++_nextSeed)
+	{
+		const OGRPoint& point = seedPoints[_seedOrder[_nextSeed]];
+		int px = static_cast<int>(point.getX());
+		int fromX = std::max(0, px - windowRange);
+		int toX = std::min(_sizeX - 1, px + windowRange);
+
+		int counter = 0;
+		int insideCells = 0;
+		if (fromX <= toX)
+		{
+			counter = _prefixSums[toX + 1] - _prefixSums[fromX];
+			insideCells = (toX - fromX + 1) * insideY;
 		}
-	};
+		if (_outsideMatches)
+			counter += _windowSize * _windowSize - insideCells;
+
+		if (counter > threshold)
+			_rejected[_seedOrder[_nextSeed]] = true;
+	}
 }
 } // CloudTools
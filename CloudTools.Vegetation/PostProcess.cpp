@@ -1,10 +1,12 @@
 #include <numeric>
+#include <random>
 
 #include <gdal_priv.h>
 
 #include <CloudTools.DEM/SweepLineCalculation.hpp>
 #include <CloudTools.DEM/Comparers/Difference.hpp>
 #include <CloudTools.DEM/Algorithms/MatrixTransformation.h>
+#include <CloudTools.DEM/ClusterRenderer.hpp>
 
 #include "PostProcess.h"
 #include "HausdorffDistance.h"
@@ -19,36 +21,9 @@ namespace Vegetation
 {
 void PostProcess::writeClusterPairsToFile(const std::string& outPath, std::shared_ptr<DistanceCalculation> distance)
 {
-	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
-	if (driver == nullptr)
-		throw std::invalid_argument("Target output format unrecognized.");
-
-	if (fs::exists(outPath) &&
-	    driver->Delete(outPath.c_str()) == CE_Failure &&
-	    !fs::remove(outPath))
-		throw std::runtime_error("Cannot overwrite previously created target file.");
-
-	GDALDataset* target = driver->Create(outPath.c_str(),
-	                                     _rasterMetadata.rasterSizeX(),
-	                                     _rasterMetadata.rasterSizeY(), 1,
-	                                     gdalType<int>(), nullptr);
-	if (target == nullptr)
-		throw std::runtime_error("Target file creation failed.");
-
-	target->SetGeoTransform(&_rasterMetadata.geoTransform()[0]);
-	if (_rasterMetadata.reference().Validate() == OGRERR_NONE)
-	{
-		char *wkt;
-		_rasterMetadata.reference().exportToWkt(&wkt);
-		target->SetProjection(wkt);
-		CPLFree(wkt);
-	}
-
-	GDALRasterBand* targetBand = target->GetRasterBand(1);
-	targetBand->SetNoDataValue(-1);
-
-	int commonId;
-	std::vector<OGRPoint> points;
+	ClusterRenderer<int> renderer(_rasterMetadata, -1);
+	if (compress)
+		renderer.createOptions.insert(std::make_pair("COMPRESS", "DEFLATE"));
 
 	int numberOfClusters = distance->closest().size();
 	std::vector<int> ids(numberOfClusters);
@@ -56,90 +31,39 @@ void PostProcess::writeClusterPairsToFile(const std::string& outPath, std::share
 	std::shuffle(ids.begin(), ids.end(), std::default_random_engine(42));
 	// Fixed seed, so the random shuffling is reproducible.
 
-	for (auto elem : distance->closest())
+	std::vector<GUInt32> indexesA, indexesB;
+	std::vector<int> commonIds;
+	indexesA.reserve(numberOfClusters);
+	indexesB.reserve(numberOfClusters);
+	commonIds.reserve(numberOfClusters);
+	for (const auto& elem : distance->closest())
 	{
-		commonId = ids.back();
+		indexesA.push_back(elem.first.first);
+		indexesB.push_back(elem.first.second);
+		commonIds.push_back(ids.back());
 		ids.pop_back();
-
-		points = _clustersA.points(elem.first.first);
-		CPLErr ioResult = CE_None;
-		for (const auto& point : points)
-		{
-			ioResult = static_cast<CPLErr>(ioResult |
-			                               targetBand->RasterIO(GF_Write,
-			                                                    point.getX(), point.getY(),
-			                                                    1, 1,
-			                                                    &commonId,
-			                                                    1, 1,
-			                                                    gdalType<int>(),
-			                                                    0, 0));
-		}
-
-		points = _clustersB.points(elem.first.second);
-		for (const auto& point : points)
-		{
-			ioResult = static_cast<CPLErr>(ioResult |
-			                               targetBand->RasterIO(GF_Write,
-			                                                    point.getX(), point.getY(),
-			                                                    1, 1,
-			                                                    &commonId,
-			                                                    1, 1,
-			                                                    gdalType<int>(),
-			                                                    0, 0));
-		}
-
-		if (ioResult != CE_None)
-			throw std::runtime_error("Target write error occured.");
-	}
-
-	commonId = -2;
-	for (auto elem : distance->lonelyA())
-	{
-		points = _clustersA.points(elem);
-		CPLErr ioResult = CE_None;
-		for (const auto& point : points)
-		{
-			ioResult = static_cast<CPLErr>(ioResult |
-			                               targetBand->RasterIO(GF_Write,
-			                                                    point.getX(), point.getY(),
-			                                                    1, 1,
-			                                                    &commonId,
-			                                                    1, 1,
-			                                                    gdalType<int>(),
-			                                                    0, 0));
-		}
-
-		if (ioResult != CE_None)
-			throw std::runtime_error("Target write error occurred.");
 	}
 
-	commonId = -3;
-	for (auto elem : distance->lonelyB())
-	{
-		points = _clustersB.points(elem);
-		CPLErr ioResult = CE_None;
-		for (const auto& point : points)
-		{
-			ioResult = static_cast<CPLErr>(ioResult |
-			                               targetBand->RasterIO(GF_Write,
-			                                                    point.getX(), point.getY(),
-			                                                    1, 1,
-			                                                    &commonId,
-			                                                    1, 1,
-			                                                    gdalType<int>(),
-			                                                    0, 0));
-		}
-
-		if (ioResult != CE_None)
-			throw std::runtime_error("Target write error occurred.");
-	}
+	renderer.paint(_clustersA, indexesA, commonIds);
+	renderer.paint(_clustersB, indexesB, commonIds);
+	renderer.paint(_clustersA, distance->lonelyA(), std::vector<int>(distance->lonelyA().size(), -2));
+	renderer.paint(_clustersB, distance->lonelyB(), std::vector<int>(distance->lonelyB().size(), -3));
 
-	GDALClose(target);
+	renderer.write(outPath);
 }
 
 void PostProcess::writeClusterHeightsToFile(const std::string& outPath, std::shared_ptr<DistanceCalculation> distance)
 {
-	std::map<std::pair<int, int>, float> heightMap;
+	// The default nodata value of the transformations (Creation::nodataValue), as written before.
+	ClusterRenderer<float> renderer(_rasterMetadata, static_cast<float>(-1e10));
+	if (compress)
+		renderer.createOptions.insert(std::make_pair("COMPRESS", "DEFLATE"));
+
+	std::vector<GUInt32> indexesA, indexesB;
+	std::vector<float> heightDiffs;
+	indexesA.reserve(distance->closest().size());
+	indexesB.reserve(distance->closest().size());
+	heightDiffs.reserve(distance->closest().size());
 	for (const auto& elem : distance->closest())
 	{
 		float clusterHeightA = std::accumulate(
@@ -163,37 +87,27 @@ void PostProcess::writeClusterHeightsToFile(const std::string& outPath, std::sha
 		                      std::max(_clustersA.points(elem.first.first).size(),
 		                               _clustersB.points(elem.first.second).size());
 
-		for (const OGRPoint& point : _clustersA.points(elem.first.first))
-		{
-			heightMap[std::make_pair(point.getX(), point.getY())] = avgHeightDiff;
-		}
-
-		for (const OGRPoint& point : _clustersB.points(elem.first.second))
-		{
-			heightMap[std::make_pair(point.getX(), point.getY())] = avgHeightDiff;
-		}
+		indexesA.push_back(elem.first.first);
+		indexesB.push_back(elem.first.second);
+		heightDiffs.push_back(avgHeightDiff);
 	}
 
-	SweepLineTransformation<float> heightWriter(
-		{_dsmInputPathA, _dsmInputPathB}, outPath, 0, nullptr, _progress);
+	renderer.paint(_clustersA, indexesA, heightDiffs);
+	renderer.paint(_clustersB, indexesB, heightDiffs);
 
-	heightWriter.computation = [&heightWriter, &heightMap](int x, int y,
-	                                                        const std::vector<Window<float>>& sources)
+	// Heights are only defined where both surface models contain data.
+	for (const std::string& path : {_dsmInputPathA, _dsmInputPathB})
 	{
-		const Window<float>& windowA = sources[0];
-		const Window<float>& windowB = sources[1];
-
-		if (!windowA.hasData() || !windowB.hasData())
-			return static_cast<float>(heightWriter.nodataValue);
-
-		auto index = std::make_pair(x, y);
-		if (!heightMap.count(index))
-			return static_cast<float>(heightWriter.nodataValue);
-		else
-			return heightMap[index];
-	};
+		GDALDataset* dataset = static_cast<GDALDataset*>(GDALOpen(path.c_str(), GA_ReadOnly));
+		if (dataset == nullptr)
+			throw std::runtime_error("Error at opening the surface DEM file.");
+		renderer.mask(dataset);
+		GDALClose(dataset);
+	}
 
-	heightWriter.execute();
+	renderer.write(outPath);
+	if (_progress)
+		_progress(1.f, std::string());
 }
 
 void PostProcess::onPrepare()
@@ -23,6 +23,11 @@ public:
 	/// </summary>
 	ProgressType progress;
 
+	/// <summary>
+	/// Compress the output rasters (DEFLATE).
+	/// </summary>
+	bool compress = false;
+
 protected:
 	/// <summary>
 	/// Internal progress reporter piped to override message.
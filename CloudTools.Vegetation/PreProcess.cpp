@@ -1,5 +1,7 @@
 #include <numeric>
 #include <random>
+#include <algorithm>
+#include <fstream>
 
 #include <gdal_priv.h>
 #include <ogrsf_frmts.h>
@@ -7,6 +9,7 @@
 #include <CloudTools.DEM/SweepLineCalculation.hpp>
 #include <CloudTools.DEM/Comparers/Difference.hpp>
 #include <CloudTools.DEM/Algorithms/MatrixTransformation.h>
+#include <CloudTools.DEM/ClusterRenderer.hpp>
 
 #include "PreProcess.h"
 #include "EliminateNonTrees.h"
@@ -23,6 +26,17 @@ namespace CloudTools
 {
 namespace Vegetation
 {
+namespace
+{
+/// <summary>
+/// The version of the cached stage results.
+/// </summary>
+/// <remarks>
+/// Must be increased whenever the output of a stage changes, so stale cache entries are not reused.
+/// </remarks>
+const long long CacheVersion = 1;
+}
+
 void PreProcess::onPrepare()
 {
 	if (_dtmInputPath.empty() || _dsmInputPath.empty())
@@ -36,11 +50,65 @@ void PreProcess::onPrepare()
 		};
 	else
 		_progress = nullptr;
+
+	if (!cacheDir.empty())
+		_cache.reset(new ResultCache(cacheDir));
+	else
+		_cache.reset();
 }
 
 void PreProcess::onExecute()
 {
-	if(_processingMethod == PreProcess::SeedRemoval)
+	// Keys of the stage results, each stage chains the key of its predecessor.
+	CacheKey chmKey, antialiasKey, nosmallKey, interpolKey, segmentationKey, morphologyKey;
+	if (_cache)
+	{
+		chmKey.add("CHM").add(CacheVersion).add(_processingMethod).addFile(_dtmInputPath).addFile(_dsmInputPath);
+		antialiasKey.add(chmKey).add("antialias");
+		nosmallKey.add(antialiasKey).add("nosmall");
+		interpolKey.add(nosmallKey).add("interpol");
+		segmentationKey.add(interpolKey).add("segmentation");
+		morphologyKey.add(segmentationKey).add("morphology")
+		             .add(morphologyCounter).add(erosionThreshold).add(removalRadius);
+	}
+
+	// Determine the stages to produce, backwards from the cluster maps.
+	bool hasMorphology = isCached(morphologyKey, ".clusters");
+	bool hasSegmentation = isCached(segmentationKey, ".clusters");
+	bool needInterpol = !hasSegmentation;
+	bool needNosmall = !hasMorphology || (needInterpol && !isCached(interpolKey, ".tif"));
+	bool needAntialias = needNosmall && !isCached(nosmallKey, ".tif");
+	bool needCHM = needAntialias && !isCached(antialiasKey, ".tif");
+
+	bool hasCHM = needCHM && isCached(chmKey, ".tif");
+	if (!needCHM || hasCHM)
+	{
+		// The target grid is the union of the inputs, as computed by the CHM creation.
+		SweepLineCalculation<float> extent({_dtmInputPath, _dsmInputPath}, nullptr);
+		extent.prepare();
+		_targetMetadata = extent.targetMetadata();
+	}
+
+	if (hasCHM)
+	{
+		restoreResult("CHM", chmKey);
+
+		// The grid (and the spatial reference) of the outputs is taken from the restored CHM.
+		// A CHM not matching the grid of the inputs is considered a cache miss and recomputed.
+		RasterMetadata chmMetadata(result("CHM").dataset);
+		if (chmMetadata.rasterSizeX() != _targetMetadata.rasterSizeX() ||
+		    chmMetadata.rasterSizeY() != _targetMetadata.rasterSizeY() ||
+		    chmMetadata.originX() != _targetMetadata.originX() ||
+		    chmMetadata.originY() != _targetMetadata.originY())
+		{
+			deleteResult("CHM");
+			hasCHM = false;
+		}
+		else
+			_targetMetadata = chmMetadata;
+	}
+
+	if (needCHM && !hasCHM && _processingMethod == PreProcess::SeedRemoval)
 	{
 		_progressMessage = "Creating River Map (" + _prefix + ")";
 		newResult("RM");
@@ -61,7 +129,8 @@ void PreProcess::onExecute()
 			result("CHM").dataset = comparison.target();
 			_targetMetadata = comparison.targetMetadata();
 		}
-	} else {
+		storeResult("CHM", chmKey);
+	} else if (needCHM && !hasCHM) {
 		_progressMessage = "Creating CHM (" + _prefix + ")";
 		newResult("CHM");
 		{
@@ -70,88 +139,120 @@ void PreProcess::onExecute()
 			result("CHM").dataset = comparison.target();
 			_targetMetadata = comparison.targetMetadata();
 		}
+		storeResult("CHM", chmKey);
 	}
 
-	_progressMessage = "Matrix transformation (" + _prefix + ")";
-	newResult("antialias");
+	if (needAntialias && !needCHM)
+		restoreResult("antialias", antialiasKey);
+	else if (needAntialias)
 	{
-		result("antialias").dataset = this->blur3x3Middle4(result("CHM").dataset, result("antialias").path());
-		//result("antialias").dataset = this->blur3x3Middle12(result("CHM").dataset, result("antialias").path());
-		//result("antialias").dataset = this->blur5x5Middle36(result("CHM").dataset, result("antialias").path());
+		_progressMessage = "Matrix transformation (" + _prefix + ")";
+		newResult("antialias");
+		{
+			result("antialias").dataset = this->blur3x3Middle4(result("CHM").dataset, result("antialias").path());
+			//result("antialias").dataset = this->blur3x3Middle12(result("CHM").dataset, result("antialias").path());
+			//result("antialias").dataset = this->blur5x5Middle36(result("CHM").dataset, result("antialias").path());
+		}
+		deleteResult("CHM");
+		storeResult("antialias", antialiasKey);
 	}
-	deleteResult("CHM");
 
-	_progressMessage = "Small points elimination (" + _prefix + ")";
-	newResult("nosmall");
+	if (needNosmall && !needAntialias)
+		restoreResult("nosmall", nosmallKey);
+	else if (needNosmall)
 	{
-		EliminateNonTrees elimination({result("antialias").dataset}, result("nosmall").path(), _progress);
-		elimination.execute();
-		result("nosmall").dataset = elimination.target();
+		_progressMessage = "Small points elimination (" + _prefix + ")";
+		newResult("nosmall");
+		{
+			EliminateNonTrees elimination({result("antialias").dataset}, result("nosmall").path(), _progress);
+			elimination.execute();
+			result("nosmall").dataset = elimination.target();
+		}
+		deleteResult("antialias");
+		storeResult("nosmall", nosmallKey);
 	}
-	deleteResult("antialias");
 
-	newResult("interpol");
+	if (needInterpol && isCached(interpolKey, ".tif"))
+		restoreResult("interpol", interpolKey);
+	else if (needInterpol)
 	{
-		_progressMessage = "Interpolation (" + _prefix + ")";
-		InterpolateNoData interpolation({result("nosmall").dataset}, result("interpol").path(), _progress);
-		interpolation.execute();
-		result("interpol").dataset = interpolation.target();
+		newResult("interpol");
+		{
+			_progressMessage = "Interpolation (" + _prefix + ")";
+			InterpolateNoData interpolation({result("nosmall").dataset}, result("interpol").path(), _progress);
+			interpolation.execute();
+			result("interpol").dataset = interpolation.target();
+		}
+		storeResult("interpol", interpolKey);
 	}
 
-	_progressMessage = "Seed points collection (" + _prefix + ")";
-	std::vector<OGRPoint> seedPoints = collectSeedPoints(result("interpol").dataset);
-	if (debug)
+	if (hasSegmentation)
+		restoreClusterMap(segmentationKey);
+	else
 	{
-		writePointsToFile(seedPoints, (fs::path(_outputDir) / (_prefix + "_seedpoints.json")).string());
-	}
+		_progressMessage = "Seed points collection (" + _prefix + ")";
+		std::vector<OGRPoint> seedPoints = collectSeedPoints(result("interpol").dataset);
+		if (debug)
+		{
+			writePointsToFile(seedPoints, (fs::path(_outputDir) / (_prefix + "_seedpoints.json")).string());
+		}
 
-	if(_processingMethod == PreProcess::SeedRemoval)
-	{
-		_progressMessage = "Seed Removal(" + _prefix + ")";
-		::BuildingFacadeSeedRemoval<float> seedRemoval(seedPoints, {_dtmInputPath, _dsmInputPath}, _progress);
-		seedRemoval.execute();
-	}
+		if(_processingMethod == PreProcess::SeedRemoval)
+		{
+			_progressMessage = "Seed Removal(" + _prefix + ")";
+			::BuildingFacadeSeedRemoval<float> seedRemoval(seedPoints, {_dtmInputPath, _dsmInputPath}, _progress);
+			seedRemoval.execute();
+		}
 
-	_progressMessage = "Tree crown segmentation (" + _prefix + ")";
-	{
-		TreeCrownSegmentation segmentation(result("interpol").dataset, seedPoints, _progress);
-		segmentation.execute();
-		_targetCluster = segmentation.clusterMap();
+		_progressMessage = "Tree crown segmentation (" + _prefix + ")";
+		{
+			TreeCrownSegmentation segmentation(result("interpol").dataset, seedPoints, _progress);
+			segmentation.execute();
+			_targetCluster = segmentation.clusterMap();
+		}
+		deleteResult("interpol");
+		storeClusterMap(segmentationKey);
 	}
-	deleteResult("interpol");
 	writeClusterMapToFile((fs::path(_outputDir) / (_prefix + "_segmentation.tif")).string());
 
-	for (std::size_t i = 0; i < morphologyCounter; ++i)
+	if (hasMorphology)
+		restoreClusterMap(morphologyKey);
+	else
 	{
-		_progressMessage = "Morphological erosion "
-		                   + std::to_string(i + 1) + "/" + std::to_string(morphologyCounter)
-		                   + " (" + _prefix + ")";
-		MorphologyClusterFilter erosion(_targetCluster, {result("nosmall").dataset},
-		                                MorphologyClusterFilter::Method::Erosion, _progress);
-		erosion.threshold = erosionThreshold;
-		erosion.execute();
-
-		_progressMessage = "Morphological dilation "
-		                   + std::to_string(i + 1) + "/" + std::to_string(morphologyCounter)
-		                   + " (" + _prefix + ")";
-		MorphologyClusterFilter dilation(erosion.target(), {result("nosmall").dataset},
-		                                 MorphologyClusterFilter::Method::Dilation, _progress);
-		dilation.execute();
-
-		_targetCluster = dilation.target();
+		for (std::size_t i = 0; i < morphologyCounter; ++i)
+		{
+			_progressMessage = "Morphological erosion "
+			                   + std::to_string(i + 1) + "/" + std::to_string(morphologyCounter)
+			                   + " (" + _prefix + ")";
+			MorphologyClusterFilter erosion(_targetCluster, {result("nosmall").dataset},
+			                                MorphologyClusterFilter::Method::Erosion, _progress);
+			erosion.threshold = erosionThreshold;
+			erosion.execute();
+
+			_progressMessage = "Morphological dilation "
+			                   + std::to_string(i + 1) + "/" + std::to_string(morphologyCounter)
+			                   + " (" + _prefix + ")";
+			MorphologyClusterFilter dilation(erosion.target(), {result("nosmall").dataset},
+			                                 MorphologyClusterFilter::Method::Dilation, _progress);
+			dilation.execute();
+
+			_targetCluster = dilation.target();
+		}
+
+		_progressMessage = "Remove small and deformed trees (" + _prefix + ")";
+		if (_progress)
+			_progress(0, "Removing small and deformed trees.");
+		_targetCluster.removeSmallClusters(removalRadius);
+		if (_progress)
+			_progress(0.5, "Small clusters removed.");
+		removeDeformedClusters(_targetCluster);
+		if (_progress)
+			_progress(1.0, "Deformed clusters removed.");
+		storeClusterMap(morphologyKey);
 	}
-	deleteResult("nosmall");
+	if (needNosmall)
+		deleteResult("nosmall");
 
-	_progressMessage = "Remove small and deformed trees (" + _prefix + ")";
-	if (_progress)
-		_progress(0, "Removing small and deformed trees.");
-	_targetCluster.removeSmallClusters(removalRadius);
-	if (_progress)
-		_progress(0.5, "Small clusters removed.");
-	removeDeformedClusters(_targetCluster);
-	if (_progress)
-		_progress(1.0, "Deformed clusters removed.");
-	
 	writeClusterMapToFile((fs::path(_outputDir) / (_prefix + "_morphology.tif")).string());
 
 	if (debug)
@@ -166,6 +267,61 @@ void PreProcess::onExecute()
 	}
 }
 
+bool PreProcess::isCached(const CacheKey& key, const std::string& extension) const
+{
+	return _cache && _cache->contains(key, extension);
+}
+
+void PreProcess::restoreResult(const std::string& name, const CacheKey& key)
+{
+	_progressMessage = "Restoring " + name + " from cache (" + _prefix + ")";
+	if (_progress)
+		_progress(0, std::string());
+
+	// The restored result refers to the cache entry, which must not be removed with the result.
+	_restoredResults[name] = _cache->path(key, ".tif");
+	newResult(name);
+	_restoredResults.erase(name);
+
+	result(name).dataset = static_cast<GDALDataset*>(GDALOpen(result(name).path().c_str(), GA_ReadOnly));
+	if (result(name).dataset == nullptr)
+		throw std::runtime_error("Error at opening a cached result.");
+
+	if (_progress)
+		_progress(1, std::string());
+}
+
+void PreProcess::storeResult(const std::string& name, const CacheKey& key)
+{
+	if (!_cache)
+		return;
+
+	result(name).dataset->FlushCache();
+	_cache->store(result(name).path(), key, ".tif");
+}
+
+void PreProcess::restoreClusterMap(const CacheKey& key)
+{
+	std::ifstream stream(_cache->path(key, ".clusters"), std::ios::binary);
+	if (!stream)
+		throw std::runtime_error("Error at opening a cached cluster map.");
+	_targetCluster.read(stream);
+}
+
+void PreProcess::storeClusterMap(const CacheKey& key)
+{
+	if (!_cache)
+		return;
+
+	fs::path path = fs::path(_outputDir) / fs::unique_path(_prefix + "_%%%%-%%%%.clusters");
+	{
+		std::ofstream stream(path.string(), std::ios::binary);
+		_targetCluster.write(stream);
+	}
+	_cache->store(path.string(), key, ".clusters");
+	fs::remove(path);
+}
+
 GDALDataset* PreProcess::blur3x3Middle4(GDALDataset* sourceDataset, const std::string& targetPath)
 {
 	MatrixTransformation filter(sourceDataset, targetPath, 1, _progress);
@@ -314,71 +470,29 @@ void PreProcess::writePointsToFile(std::vector<OGRPoint> points, const std::stri
 
 void PreProcess::writeClusterMapToFile(const std::string& outPath)
 {
-	GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
-	if (driver == nullptr)
-		throw std::invalid_argument("Target output format unrecognized.");
+	ClusterRenderer<int> renderer(_targetMetadata, -1);
+	if (compress)
+		renderer.createOptions.insert(std::make_pair("COMPRESS", "DEFLATE"));
 
-	if (fs::exists(outPath) &&
-	    driver->Delete(outPath.c_str()) == CE_Failure &&
-	    !fs::remove(outPath))
-		throw std::runtime_error("Cannot overwrite previously created target file.");
-
-	GDALDataset* target = driver->Create(outPath.c_str(),
-	                                     _targetMetadata.rasterSizeX(),
-	                                     _targetMetadata.rasterSizeY(), 1,
-	                                     gdalType<int>(), nullptr);
-	if (target == nullptr)
-		throw std::runtime_error("Target file creation failed.");
-
-	target->SetGeoTransform(&_targetMetadata.geoTransform()[0]);
-	if (_targetMetadata.reference().Validate() == OGRERR_NONE)
-	{
-		char *wkt;
-		_targetMetadata.reference().exportToWkt(&wkt);
-		target->SetProjection(wkt);
-		CPLFree(wkt);
-	}
-
-	GDALRasterBand* targetBand = target->GetRasterBand(1);
-	targetBand->SetNoDataValue(-1);
-
-	int commonId;
-	std::vector<OGRPoint> points;
-
-	int numberOfClusters = _targetCluster.clusterIndexes().size();
-	std::vector<int> ids(numberOfClusters);
+	std::vector<GUInt32> indexes = _targetCluster.clusterIndexes();
+	std::vector<int> ids(indexes.size());
 	std::iota(ids.begin(), ids.end(), 0);
 	std::shuffle(ids.begin(), ids.end(), std::default_random_engine(42));
 	// Fixed seed, so the random shuffling is reproducible.
 
-	for (GUInt32 index : _targetCluster.clusterIndexes())
-	{
-		commonId = ids.back();
-		ids.pop_back();
-
-		points = _targetCluster.points(index);
-		CPLErr ioResult = CE_None;
-		for (const auto& point : points)
-		{
-			ioResult = static_cast<CPLErr>(ioResult |
-			                               targetBand->RasterIO(GF_Write,
-			                                                    point.getX(), point.getY(),
-			                                                    1, 1,
-			                                                    &commonId,
-			                                                    1, 1,
-			                                                    gdalType<int>(),
-			                                                    0, 0));
-		}
+	// Identifiers are assigned from the back of the shuffled sequence.
+	std::reverse(ids.begin(), ids.end());
 
-		if (ioResult != CE_None)
-			throw std::runtime_error("Target write error occured.");
-	}
-
-	GDALClose(target);
+	renderer.paint(_targetCluster, indexes, ids);
+	renderer.write(outPath);
 }
 
 Result* PreProcess::createResult(const std::string& name, bool isFinal)
 {
+	auto restored = _restoredResults.find(name);
+	if (restored != _restoredResults.end())
+		return new PermanentFileResult(restored->second);
+
 	std::string filename = _prefix + "_" + name + ".tif";
 
 	if (isFinal || debug)
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <map>
+#include <memory>
+
 #include <CloudTools.Common/Operation.h>
 #include <CloudTools.Common/IO/ResultCollection.h>
+#include <CloudTools.Common/IO/ResultCache.h>
 #include <CloudTools.DEM/Metadata.h>
 #include <CloudTools.DEM/ClusterMap.h>
 
@@ -42,6 +46,20 @@ public:
 	/// </summary>
 	bool debug = false;
 
+	/// <summary>
+	/// Compress the output rasters (DEFLATE).
+	/// </summary>
+	bool compress = false;
+
+	/// <summary>
+	/// Directory to cache the results of the stages in.
+	/// </summary>
+	/// <remarks>
+	/// The results are keyed by the input files and the parameters of the stages,
+	/// so unchanged stages are reused between executions. Caching is disabled when empty.
+	/// </remarks>
+	std::string cacheDir;
+
 protected:
 	/// <summary>
 	/// Internal progress reporter piped to override message.
@@ -106,6 +124,42 @@ private:
 	CloudTools::DEM::RasterMetadata _targetMetadata;
 	CloudTools::DEM::ClusterMap _targetCluster;
 
+	std::unique_ptr<CloudTools::IO::ResultCache> _cache;
+	std::map<std::string, std::string> _restoredResults;
+
+	/// <summary>
+	/// Determines whether a stage result is cached.
+	/// </summary>
+	/// <param name="key">The key of the stage.</param>
+	/// <param name="extension">The file extension of the result.</param>
+	bool isCached(const CloudTools::IO::CacheKey& key, const std::string& extension) const;
+
+	/// <summary>
+	/// Creates a raster result from the cache.
+	/// </summary>
+	/// <param name="name">The name of the result.</param>
+	/// <param name="key">The key of the stage.</param>
+	void restoreResult(const std::string& name, const CloudTools::IO::CacheKey& key);
+
+	/// <summary>
+	/// Stores a raster result in the cache (if enabled).
+	/// </summary>
+	/// <param name="name">The name of the result.</param>
+	/// <param name="key">The key of the stage.</param>
+	void storeResult(const std::string& name, const CloudTools::IO::CacheKey& key);
+
+	/// <summary>
+	/// Reads the target cluster map from the cache.
+	/// </summary>
+	/// <param name="key">The key of the stage.</param>
+	void restoreClusterMap(const CloudTools::IO::CacheKey& key);
+
+	/// <summary>
+	/// Stores the target cluster map in the cache (if enabled).
+	/// </summary>
+	/// <param name="key">The key of the stage.</param>
+	void storeClusterMap(const CloudTools::IO::CacheKey& key);
+
 	/// <summary>
 	/// Applies blurring convolution. 3x3 Gaussian kernel.
 	/// </summary>
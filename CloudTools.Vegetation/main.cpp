@@ -3,13 +3,15 @@
 #include <string>
 #include <ctime>
 #include <chrono>
-#include <future>
+#include <vector>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/algorithm/string/join.hpp>
 
 #include <CloudTools.Common/IO/IO.h>
 #include <CloudTools.Common/IO/Reporter.h>
+#include <CloudTools.Common/OperationGraph.h>
 
 #include "PreProcess.h"
 #include "PostProcess.h"
@@ -28,6 +30,7 @@ int main(int argc, char* argv[])
 	std::string dtmInputPathB;
 	std::string dsmInputPathB;
 	std::string outputDir = fs::current_path().string();
+	std::string cacheDir;
 
 	// Read console arguments
 	po::options_description desc("Allowed options");
@@ -37,10 +40,12 @@ int main(int argc, char* argv[])
 		("dsm-input-path-B,s", po::value<std::string>(&dsmInputPathB), "Epoch-B DSM input path")
 		("dtm-input-path-B,t", po::value<std::string>(&dtmInputPathB), "Epoch-B DTM input path")
 		("output-dir,o", po::value<std::string>(&outputDir)->default_value(outputDir), "result directory path")
+		("cache-dir", po::value<std::string>(&cacheDir), "directory to cache and reuse preprocessing results in")
 		("hausdorff-distance", "use Hausdorff-distance")
 		("srm", "removes trees possibly to close to buildings")
 		("parallel,p", "parallel execution for A & B epochs")
 		("debug,d", "keep intermediate results on disk after progress")
+		("compress", "compress the output rasters (DEFLATE)")
 		("verbose,v", "verbose output")
 		("quiet,q", "suppress progress output")
 		("help,h", "produce help message");
@@ -104,6 +109,17 @@ int main(int argc, char* argv[])
 		argumentError = true;
 	}
 
+	if (fs::exists(cacheDir) && !fs::is_directory(cacheDir))
+	{
+		std::cerr << "The given cache path exists but is not a directory." << std::endl;
+		argumentError = true;
+	}
+	else if (!cacheDir.empty() && !fs::exists(cacheDir) && !fs::create_directories(cacheDir))
+	{
+		std::cerr << "Failed to create cache directory." << std::endl;
+		argumentError = true;
+	}
+
 	if (argumentError)
 	{
 		std::cerr << "Use the --help option for description." << std::endl;
@@ -148,6 +164,8 @@ int main(int argc, char* argv[])
 
 	preProcessA.debug = vm.count("debug");
 	preProcessB.debug = vm.count("debug");
+	preProcessA.cacheDir = preProcessB.cacheDir = cacheDir;
+	preProcessA.compress = preProcessB.compress = vm.count("compress") > 0;
 
 	if (!vm.count("quiet"))
 	{
@@ -157,32 +175,37 @@ int main(int argc, char* argv[])
 			std::cout << "No progress display for preprocessors in parallel mode." << std::endl;
 	}
 
-	// Execute preprocess operations
-	auto futureA = std::async(
-		vm.count("parallel") ? std::launch::async : std::launch::deferred, &PreProcess::execute, &preProcessA, false);
-
-	auto futureB = std::async(
-		vm.count("parallel") ? std::launch::async : std::launch::deferred, &PreProcess::execute, &preProcessB, false);
-
-	futureA.wait();
-	futureB.wait();
-
-	// Create the postprocessor
-	PostProcess postProcess(
-		dsmInputPathA, dsmInputPathB,
-		preProcessA.target(), preProcessB.target(),
-		outputDir,
-		vm.count("hausdorff-distance")
-		? PostProcess::DifferenceMethod::Hausdorff
-		: PostProcess::DifferenceMethod::Centroid);
-
-	if (!vm.count("quiet"))
-	{
-		postProcess.progress = progress;
-	}
-
-	// Execute postprocess operations
-	postProcess.execute();
+	// The preprocessors are independent of each other, the postprocessor consumes both of their results.
+	// (Without parallel execution the epoch-B preprocessor is chained after the epoch-A one.)
+	bool isParallel = vm.count("parallel") > 0;
+	CloudTools::OperationGraph graph(isParallel ? 2 : 1);
+	graph.addNode("preprocess-a", { "sources" }, { "clusters-a" }, preProcessA);
+	graph.addNode("preprocess-b",
+		isParallel ? std::vector<std::string>{ "sources" } : std::vector<std::string>{ "sources", "clusters-a" },
+		{ "clusters-b" }, preProcessB);
+	graph.addNode("postprocess", { "clusters-a", "clusters-b" }, { "changes" },
+		[&]()
+		{
+			PostProcess postProcess(
+				dsmInputPathA, dsmInputPathB,
+				preProcessA.target(), preProcessB.target(),
+				outputDir,
+				vm.count("hausdorff-distance")
+				? PostProcess::DifferenceMethod::Hausdorff
+				: PostProcess::DifferenceMethod::Centroid);
+
+			postProcess.compress = vm.count("compress") > 0;
+
+			if (!vm.count("quiet"))
+			{
+				postProcess.progress = progress;
+			}
+
+			postProcess.execute();
+		});
+
+	// Execute the pre- and postprocess operations
+	graph.execute();
 	delete reporter;
 
 	// Execution time measurement
@@ -196,7 +219,9 @@ int main(int argc, char* argv[])
 		          << std::fixed << std::setprecision(2) << "CPU time used: "
 		          << 1.f * (clockEnd - clockStart) / CLOCKS_PER_SEC << "s" << std::endl
 		          << "Wall clock time passed: "
-		          << std::chrono::duration<float>(timeEnd - timeStart).count() << "s" << std::endl;
+		          << std::chrono::duration<float>(timeEnd - timeStart).count() << "s" << std::endl
+		          << "Critical path: " << boost::algorithm::join(graph.criticalPath(), " -> ")
+		          << " (" << graph.criticalPathDuration() << "s)" << std::endl;
 	}
 	return Success;
 }